@@ -0,0 +1,546 @@
+/* Calf DSP Library
+ * Spectrum analysis running outside of the audio thread.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman, Markus Schmidt and others
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include <calf/analyzer.h>
+#include <calf/primitives.h>
+#include <calf/utils.h>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace dsp;
+using namespace calf_utils;
+
+namespace {
+
+/// The FFTW planner is not thread safe, and every analyzer has its own worker
+ptmutex planner_mutex;
+
+inline float sinc(float x)
+{
+    return x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+}
+
+/// Selectable windowing functions, i = 0 .. n - 1
+float window_function(int type, int i, int n)
+{
+    double x = (double)i / n;
+    switch(type) {
+        case 0:
+        default:
+            // Rectangular
+            return 1.f;
+        case 1:
+            // Hamming
+            return 0.54 - 0.46 * cos(2 * M_PI * x);
+        case 2:
+            // von Hann
+            return 0.5 - 0.5 * cos(2 * M_PI * x);
+        case 3:
+            // Blackman
+            return 0.42 - 0.5 * cos(2 * M_PI * x) + 0.08 * cos(4 * M_PI * x);
+        case 4:
+            // Blackman-Harris
+            return 0.35875 - 0.48829 * cos(2 * M_PI * x) + \
+                0.14128 * cos(4 * M_PI * x) - 0.01168 * cos(6 * M_PI * x);
+        case 5:
+            // Blackman-Nuttall
+            return 0.3635819 - 0.4891775 * cos(2 * M_PI * x) + \
+                0.1365995 * cos(4 * M_PI * x) - 0.0106411 * cos(6 * M_PI * x);
+        case 6:
+            // Sine
+            return sin(M_PI * x);
+        case 7:
+            // Lanczos
+            return sinc(2 * x - 1);
+        case 8:
+            // Gauß
+            return exp(-0.5 * pow((x - 0.5) / 0.2, 2));
+        case 9:
+            // Bartlett
+            return 1 - fabs(2 * x - 1);
+        case 10:
+            // Triangular
+            return 1 - fabs((i - n / 2.0) / (n / 2.0 + 1));
+        case 11:
+            // Bartlett-Hann
+            return 0.62 - 0.48 * fabs(x - 0.5) - 0.38 * cos(2 * M_PI * x);
+        case 12:
+            // Flat Top - wide main lobe, but accurate peak amplitudes
+            return 0.21557895 - 0.41663158 * cos(2 * M_PI * x) + \
+                0.277263158 * cos(4 * M_PI * x) - 0.083578947 * cos(6 * M_PI * x) + \
+                0.006947368 * cos(8 * M_PI * x);
+    }
+}
+
+/// Create an FFT plan of size n. Plans are measured rather than estimated; the
+/// planner's findings (wisdom) are kept in the cache directory, so measuring
+/// only happens once per FFT size and machine.
+fftwf_plan create_plan(int n, float *in, float *out)
+{
+    ptlock lock(planner_mutex);
+    static bool wisdom_loaded = false;
+    std::string dir = get_cache_dir();
+    std::string filename = dir.empty() ? dir : dir + "/fftw-wisdom";
+    if (!wisdom_loaded)
+    {
+        if (!filename.empty())
+            fftwf_import_wisdom_from_filename(filename.c_str());
+        wisdom_loaded = true;
+    }
+    fftwf_plan plan = fftwf_plan_r2r_1d(n, in, out, FFTW_R2HC, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+    if (plan)
+        return plan;
+    plan = fftwf_plan_r2r_1d(n, in, out, FFTW_R2HC, FFTW_MEASURE);
+    if (plan && !filename.empty())
+    {
+        char *wisdom = fftwf_export_wisdom_to_string();
+        if (wisdom)
+        {
+            write_file_atomic(filename, wisdom, strlen(wisdom));
+            fftwf_free(wisdom);
+        }
+    }
+    return plan;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+stereo_sample_ring::stereo_sample_ring()
+{
+    data = (float *)calloc(2 * SIZE, sizeof(float));
+    head = 0;
+    tail = 0;
+}
+
+stereo_sample_ring::~stereo_sample_ring()
+{
+    free(data);
+}
+
+bool stereo_sample_ring::read(uint32_t end, int count, float *left, float *right) const
+{
+    uint32_t start = end - count;
+    for (int i = 0; i < count; i++)
+    {
+        const float *p = data + 2 * ((start + i) & MASK);
+        left[i] = p[0];
+        right[i] = p[1];
+    }
+    __sync_synchronize();
+    // the writer may already be filling up to GUARD pairs past what it published
+    return tail - start + GUARD <= SIZE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+spectrum_worker::spectrum_worker()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        spectrum_frame &f = frames.slot(i);
+        f.accuracy = 0;
+        f.mode = 0;
+        f.outL = (float *)calloc(MAX_ACCURACY, sizeof(float));
+        f.outR = (float *)calloc(MAX_ACCURACY, sizeof(float));
+        f.holdL = (float *)calloc(MAX_ACCURACY, sizeof(float));
+        f.holdR = (float *)calloc(MAX_ACCURACY, sizeof(float));
+    }
+    float **bufs[] = { &window, &inL, &inR, &fftL, &fftR, &magL, &magR, &accL, &accR, &smoothL, &smoothR, &deltaL, &deltaR, &holdL, &holdR };
+    for (unsigned int i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++)
+        *bufs[i] = (float *)calloc(MAX_ACCURACY, sizeof(float));
+    settings.accuracy = 0;
+    settings.mode = 0;
+    settings.smoothing = 0;
+    settings.speed = 1;
+    settings.windowing = 0;
+    settings.overlap = 0;
+    settings.accumulate = 0;
+    settings.reset_serial = 0;
+    settings_serial = 0;
+    cur = settings;
+    fetch_count = 0;
+    running = false;
+    thread_started = false;
+    plan = NULL;
+    plan_accuracy = 0;
+    last_reset_serial = -1;
+    window_type = window_accuracy = window_overlap = -1;
+    ticks = idle_ticks = last_fetch_count = 0;
+    stft_synced = false;
+    stft_end = 0;
+    acc_count = 0;
+}
+
+spectrum_worker::~spectrum_worker()
+{
+    stop();
+    if (plan)
+    {
+        ptlock lock(planner_mutex);
+        fftwf_destroy_plan(plan);
+    }
+    float *bufs[] = { window, inL, inR, fftL, fftR, magL, magR, accL, accR, smoothL, smoothR, deltaL, deltaR, holdL, holdR };
+    for (unsigned int i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++)
+        free(bufs[i]);
+    for (int i = 0; i < 3; i++)
+    {
+        spectrum_frame &f = frames.slot(i);
+        free(f.outL);
+        free(f.outR);
+        free(f.holdL);
+        free(f.holdR);
+    }
+}
+
+void spectrum_worker::start()
+{
+    if (thread_started)
+        return;
+    running = true;
+    thread_started = pthread_create(&thread, NULL, thread_func, this) == 0;
+}
+
+void spectrum_worker::stop()
+{
+    if (!thread_started)
+        return;
+    running = false;
+    pthread_join(thread, NULL);
+    thread_started = false;
+}
+
+void spectrum_worker::set_settings(const spectrum_settings &s)
+{
+    // odd serial = update in progress, the worker retries on its next tick
+    settings_serial++;
+    __sync_synchronize();
+    settings = s;
+    __sync_synchronize();
+    settings_serial++;
+}
+
+bool spectrum_worker::read_settings(spectrum_settings &s) const
+{
+    int serial = settings_serial;
+    __sync_synchronize();
+    s = settings;
+    __sync_synchronize();
+    return !(serial & 1) && serial == settings_serial;
+}
+
+void *spectrum_worker::thread_func(void *arg)
+{
+    spectrum_worker *self = (spectrum_worker *)arg;
+    while(self->running)
+    {
+        self->tick();
+        usleep(1000000 / TICKS_PER_SECOND);
+    }
+    return NULL;
+}
+
+void spectrum_worker::reset_state()
+{
+    dsp::zero(magL, MAX_ACCURACY);
+    dsp::zero(magR, MAX_ACCURACY);
+    dsp::zero(accL, MAX_ACCURACY);
+    dsp::zero(accR, MAX_ACCURACY);
+    dsp::zero(smoothL, MAX_ACCURACY);
+    dsp::zero(smoothR, MAX_ACCURACY);
+    dsp::zero(deltaL, MAX_ACCURACY);
+    dsp::zero(deltaR, MAX_ACCURACY);
+    dsp::zero(holdL, MAX_ACCURACY);
+    dsp::zero(holdR, MAX_ACCURACY);
+    acc_count = 0;
+    ticks = 0;
+}
+
+void spectrum_worker::build_window()
+{
+    int n = cur.accuracy, overlap = cur.overlap ? 1 : 0;
+    if (window_type == cur.windowing && window_accuracy == n && window_overlap == overlap)
+        return;
+    if (overlap)
+    {
+        // STFT: the selected window alone, scaled to unity coherent gain so
+        // that the peak of a sine reads the same with every window
+        double sum = 0;
+        for (int i = 0; i < n; i++)
+            sum += (window[i] = window_function(cur.windowing, i, n));
+        float scale = sum > 0 ? n / sum : 1;
+        for (int i = 0; i < n; i++)
+            window[i] *= scale;
+    }
+    else
+    {
+        // single FFT per display update: always on Hamming times the selected window
+        for (int i = 0; i < n; i++)
+            window[i] = window_function(1, i, n) * window_function(cur.windowing, i, n);
+    }
+    window_type = cur.windowing;
+    window_accuracy = n;
+    window_overlap = overlap;
+}
+
+void spectrum_worker::transform(bool stereo)
+{
+    int n = cur.accuracy;
+    for (int i = 0; i < n; i++)
+    {
+        float L = inL[i] * window[i];
+        float R = inR[i] * window[i];
+        switch(cur.mode) {
+            case 0:
+            case 6:
+                // average
+                inL[i] = inR[i] = (L + R) / 2;
+                break;
+            case 1:
+            default:
+                // left channel, or both channels
+                inL[i] = L;
+                inR[i] = R;
+                break;
+            case 2:
+            case 8:
+                // right channel
+                inL[i] = R;
+                inR[i] = L;
+                break;
+        }
+    }
+    fftwf_execute_r2r(plan, inL, fftL);
+    magnitudes(fftL);
+    if (stereo)
+    {
+        fftwf_execute_r2r(plan, inR, fftR);
+        magnitudes(fftR);
+    }
+    else
+        memcpy(fftR, fftL, n * sizeof(float));
+}
+
+void spectrum_worker::magnitudes(float *fft) const
+{
+    // half complex order: re(0) re(1) ... re(n/2) im(n/2-1) ... im(1),
+    // replaced by the magnitudes, mirrored around n/2
+    int n = cur.accuracy;
+    fft[0] = fabs(fft[0]);
+    fft[n / 2] = fabs(fft[n / 2]);
+    for (int k = 1; k < n / 2; k++)
+        fft[k] = fft[n - k] = sqrt(fft[k] * fft[k] + fft[n - k] * fft[n - k]);
+}
+
+void spectrum_worker::run_stft(bool stereo)
+{
+    int n = cur.accuracy;
+    int hop = std::max(1, n >> cur.overlap);
+    uint32_t tail = ring.get_tail();
+    // (re)start at the newest audio when not running yet, or when so far
+    // behind that the next window has been overwritten already
+    if (!stft_synced || (int32_t)(tail - stft_end) < 0 || tail - stft_end + n > (uint32_t)stereo_sample_ring::MAX_READ)
+    {
+        stft_end = tail;
+        stft_synced = true;
+    }
+    for (; (int32_t)(tail - stft_end) >= 0; stft_end += hop)
+    {
+        if (!ring.read(stft_end, n, inL, inR))
+        {
+            stft_synced = false;
+            return;
+        }
+        transform(stereo);
+        if (cur.accumulate)
+        {
+            // average - sum up the power
+            for (int i = 0; i < n; i++)
+            {
+                accL[i] += fftL[i] * fftL[i];
+                accR[i] += fftR[i] * fftR[i];
+            }
+        }
+        else
+        {
+            // peak
+            for (int i = 0; i < n; i++)
+            {
+                accL[i] = std::max(accL[i], fftL[i]);
+                accR[i] = std::max(accR[i], fftR[i]);
+            }
+        }
+        acc_count++;
+    }
+}
+
+void spectrum_worker::tick()
+{
+    spectrum_settings s;
+    if (!read_settings(s) || s.accuracy <= 0 || s.accuracy > MAX_ACCURACY)
+        return;
+    // nobody has been looking for a second - do not waste any CPU
+    if (fetch_count != last_fetch_count)
+    {
+        last_fetch_count = fetch_count;
+        idle_ticks = 0;
+    }
+    else if (idle_ticks < TICKS_PER_SECOND)
+        idle_ticks++;
+    else
+    {
+        stft_synced = false;
+        return;
+    }
+
+    cur = s;
+    if (cur.reset_serial != last_reset_serial)
+    {
+        if (cur.accuracy != plan_accuracy)
+        {
+            if (plan)
+            {
+                ptlock lock(planner_mutex);
+                fftwf_destroy_plan(plan);
+            }
+            plan = create_plan(cur.accuracy, inL, fftL);
+            plan_accuracy = cur.accuracy;
+        }
+        reset_state();
+        stft_synced = false;
+        last_reset_serial = cur.reset_serial;
+    }
+    if (!plan)
+        return;
+
+    int n = cur.accuracy;
+    int speed = std::max(1, cur.speed);
+    bool stereo = cur.mode >= 3 && cur.mode <= 5;
+    build_window();
+    // the STFT has to keep up with the audio on every tick, whatever the speed
+    if (cur.overlap)
+        run_stft(stereo);
+    else
+        stft_synced = false;
+    bool fftdone = false;
+    if (!(ticks % speed))
+    {
+        if (cur.overlap)
+        {
+            // sample the accumulator - every window since the last sample
+            // contributes, so no transient is missed
+            if (acc_count)
+            {
+                if (cur.accumulate)
+                {
+                    float norm = 1.f / acc_count;
+                    for (int i = 0; i < n; i++)
+                    {
+                        magL[i] = sqrt(accL[i] * norm);
+                        magR[i] = sqrt(accR[i] * norm);
+                    }
+                }
+                else
+                {
+                    memcpy(magL, accL, n * sizeof(float));
+                    memcpy(magR, accR, n * sizeof(float));
+                }
+                dsp::zero(accL, n);
+                dsp::zero(accR, n);
+                acc_count = 0;
+            }
+        }
+        else
+        {
+            // a window that got overwritten while copying is skipped, the next tick
+            // gets a fresh one
+            if (!ring.read(ring.get_tail(), n, inL, inR))
+                return;
+            transform(stereo);
+            memcpy(magL, fftL, n * sizeof(float));
+            memcpy(magR, fftR, n * sizeof(float));
+        }
+        fftdone = true;
+        ticks = 0;
+    }
+    ticks++;
+    // falling is slower in spectralizer modes
+    bool spectralizer = cur.mode > 5 && cur.mode < 9;
+    float fdelta = spectralizer ? .99f : 0.91f;
+    float fspeed = 1.f - (16.f - speed) / (spectralizer ? 50.f : 2000.f);
+    float *mags[2] = { magL, magR }, *smooths[2] = { smoothL, smoothR };
+    float *deltas[2] = { deltaL, deltaR }, *holds[2] = { holdL, holdR };
+    for (int c = 0; c < 2; c++)
+    {
+        float *mag = mags[c], *smooth = smooths[c], *delta = deltas[c], *hold = holds[c];
+        if (fftdone)
+        {
+            for (int i = 0; i < n; i++)
+                hold[i] = std::max(hold[i], mag[i]);
+        }
+        if (cur.smoothing == 2)
+        {
+            // smoothing - glide from the previous FFT result to the new one
+            // over the time until the next FFT
+            if (fftdone)
+            {
+                for (int i = 0; i < n; i++)
+                {
+                    if (smooth[i] < 1e-20f)
+                        smooth[i] = mag[i], delta[i] = 1.f;
+                    else
+                        delta[i] = pow(mag[i] / smooth[i], 1.f / speed);
+                }
+            }
+            for (int i = 0; i < n; i++)
+                smooth[i] *= delta[i];
+        }
+        else if (cur.smoothing == 1)
+        {
+            // falling - jump up to new peaks, then fall faster and faster
+            for (int i = 0; i < n; i++)
+            {
+                if (fftdone && smooth[i] < mag[i])
+                {
+                    smooth[i] = mag[i];
+                    delta[i] = 1.f;
+                }
+                smooth[i] *= delta[i];
+                if (delta[i] > fdelta)
+                    delta[i] *= fspeed;
+            }
+        }
+    }
+
+    spectrum_frame &f = frames.write_slot();
+    const float *srcL = cur.smoothing ? smoothL : magL;
+    const float *srcR = cur.smoothing ? smoothR : magR;
+    memcpy(f.outL, srcL, n * sizeof(float));
+    memcpy(f.outR, srcR, n * sizeof(float));
+    memcpy(f.holdL, holdL, n * sizeof(float));
+    memcpy(f.holdR, holdR, n * sizeof(float));
+    f.accuracy = n;
+    f.mode = cur.mode;
+    frames.publish();
+}
@@ -297,6 +297,22 @@ void reverb::update_times()
         ldec[i]=exp(-float(tl[i] >> 16) / fDec),
         rdec[i]=exp(-float(tr[i] >> 16) / fDec);
     }
+    // stages 0-5 are the left chain, 6-11 the right one
+    for (int s = 0; s < 6; s++) {
+        lane_time[s % 3][s / 3] = tl[s] * (1.0f / 65536.0f);
+        lane_dec[s % 3][s / 3] = ldec[s];
+    }
+    for (int s = 6; s < 12; s++) {
+        lane_time[s % 3][s / 3] = tr[s - 6] * (1.0f / 65536.0f);
+        lane_dec[s % 3][s / 3] = rdec[s - 6];
+    }
+}
+
+void reverb::clear_lanes()
+{
+    memset(lines, 0, sizeof(lines));
+    memset(lane_out, 0, sizeof(lane_out));
+    line_pos = 0;
 }
 
 void reverb::reset()
@@ -309,14 +325,12 @@ void reverb::reset()
     apL6.reset();apR6.reset();
     lp_left.reset();lp_right.reset();
     old_left = 0; old_right = 0;
+    clear_lanes();
 }
 
 void reverb::process(float &left, float &right)
 {
-    unsigned int ipart = phase.ipart();
-
-    // the interpolated LFO might be an overkill here
-    int lfo = phase.lerp_by_fract_int<int, 14, int>(sine.data[ipart], sine.data[ipart+1]) >> 2;
+    int lfo = get_lfo();
     phase += dphase;
 
     left += old_right;
@@ -344,6 +358,115 @@ void reverb::process(float &left, float &right)
     left = out_left, right = out_right;
 }
 
+template<bool Interpolate>
+void reverb::process_lanes(float *left, float *right, uint32_t len, float delay[3][4], const float ddelay[3][4])
+{
+#ifdef __SSE__
+    __m128 sign = _mm_set1_ps(-0.f), small = _mm_set1_ps(small_value<float>());
+    __m128 keep = _mm_cmpneq_ps(_mm_set_ps(1.f, 0.f, 1.f, 0.f), _mm_setzero_ps());
+    __m128 dec[3], y[3];
+    for (int g = 0; g < 3; g++) {
+        dec[g] = _mm_loadu_ps(lane_dec[g]);
+        y[g] = _mm_loadu_ps(lane_out[g]);
+    }
+#endif
+    for (uint32_t i = 0; i < len; i++) {
+        int wpos = line_pos;
+        float old[3][4];
+        for (int g = 0; g < 3; g++) {
+            for (int j = 0; j < 4; j++) {
+                float d = delay[g][j];
+                int di = (int)d;
+                const float *a = lines[g][(wpos - di) & LINE_MASK];
+                if (Interpolate)
+                    old[g][j] = lerp(a[j], lines[g][(wpos - di - 1) & LINE_MASK][j], d - di);
+                else
+                    old[g][j] = a[j];
+                delay[g][j] = d + ddelay[g][j];
+            }
+        }
+#ifdef __SSE__
+        // the first stage of each chain gets the damped output of the other one
+        float from_left = lp_left.process(_mm_cvtss_f32(_mm_shuffle_ps(y[2], y[2], _MM_SHUFFLE(1, 1, 1, 1))) * fb);
+        float from_right = lp_right.process(_mm_cvtss_f32(_mm_shuffle_ps(y[2], y[2], _MM_SHUFFLE(3, 3, 3, 3))) * fb);
+        sanitize(from_left);
+        sanitize(from_right);
+        // group 2 feeds group 0 one lane up: [R6, L3, L6, R3], the chain ends replaced by the inputs
+        __m128 in0 = _mm_or_ps(_mm_and_ps(keep, _mm_shuffle_ps(y[2], y[2], _MM_SHUFFLE(2, 1, 0, 3))),
+                               _mm_set_ps(0.f, right[i] + from_left, 0.f, left[i] + from_right));
+        __m128 in[3] = { in0, y[0], y[1] };
+        for (int g = 0; g < 3; g++) {
+            __m128 vold = _mm_set_ps(old[g][3], old[g][2], old[g][1], old[g][0]);
+            __m128 cur = _mm_add_ps(in[g], _mm_mul_ps(dec[g], vold));
+            cur = _mm_and_ps(cur, _mm_cmpge_ps(_mm_andnot_ps(sign, cur), small));
+            _mm_storeu_ps(lines[g][wpos], cur);
+            y[g] = _mm_sub_ps(vold, _mm_mul_ps(dec[g], cur));
+        }
+        // taps after the second stage of each chain
+        left[i] = _mm_cvtss_f32(y[1]);
+        right[i] = _mm_cvtss_f32(_mm_shuffle_ps(y[1], y[1], _MM_SHUFFLE(2, 2, 2, 2)));
+#else
+        float from_left = lp_left.process(lane_out[2][1] * fb);
+        float from_right = lp_right.process(lane_out[2][3] * fb);
+        sanitize(from_left);
+        sanitize(from_right);
+        float in[3][4] = {
+            { left[i] + from_right, lane_out[2][0], right[i] + from_left, lane_out[2][2] },
+            { lane_out[0][0], lane_out[0][1], lane_out[0][2], lane_out[0][3] },
+            { lane_out[1][0], lane_out[1][1], lane_out[1][2], lane_out[1][3] },
+        };
+        for (int g = 0; g < 3; g++) {
+            for (int j = 0; j < 4; j++) {
+                float cur = in[g][j] + lane_dec[g][j] * old[g][j];
+                sanitize(cur);
+                lines[g][wpos][j] = cur;
+                lane_out[g][j] = old[g][j] - lane_dec[g][j] * cur;
+            }
+        }
+        left[i] = lane_out[1][0];
+        right[i] = lane_out[1][2];
+#endif
+        line_pos = (wpos + 1) & LINE_MASK;
+    }
+#ifdef __SSE__
+    for (int g = 0; g < 3; g++)
+        _mm_storeu_ps(lane_out[g], y[g]);
+#endif
+}
+
+void reverb::process(float *left, float *right, uint32_t len)
+{
+    if (quality == QUALITY_HIGH) {
+        for (uint32_t i = 0; i < len; i++)
+            process(left[i], right[i]);
+        return;
+    }
+    // modulation depth of every stage, in samples per LFO unit (same as in the
+    // loop above, the LFO is scaled to 16.16 fixed point there)
+    static const float lane_mod[3][4] = {
+        { -45 / 65536.f, -69 / 65536.f, -45 / 65536.f, -69 / 65536.f },
+        {  47 / 65536.f,  69 / 65536.f,  47 / 65536.f,  69 / 65536.f },
+        {  54 / 65536.f, -46 / 65536.f,  54 / 65536.f, -46 / 65536.f },
+    };
+    float lfo0 = 0.f, lfo1 = 0.f;
+    if (quality != QUALITY_LOW) {
+        lfo0 = get_lfo();
+        lfo1 = get_lfo(len);
+    }
+    phase += dphase * (int)len;
+    float delay[3][4], ddelay[3][4];
+    for (int g = 0; g < 3; g++) {
+        for (int j = 0; j < 4; j++) {
+            delay[g][j] = lane_time[g][j] + lane_mod[g][j] * lfo0;
+            ddelay[g][j] = lane_mod[g][j] * (lfo1 - lfo0) / len;
+        }
+    }
+    if (quality == QUALITY_LOW)
+        process_lanes<false>(left, right, len, delay, ddelay);
+    else
+        process_lanes<true>(left, right, len, delay, ddelay);
+}
+
 /// Distortion Module by Tom Szilagyi
 ///
 /// This module provides a blendable saturation stage
@@ -395,6 +518,8 @@ void tap_distortion::set_params(float blend, float drive)
 void tap_distortion::set_sample_rate(uint32_t sr)
 {
     srate = sr;
+    // the coefficients depend on the sample rate, force recalculation on the next set_params
+    drive_old = blend_old = -1.f;
 }
 
 float tap_distortion::process(float in)
@@ -423,6 +548,109 @@ float tap_distortion::get_distortion_level()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+oversampler::oversampler()
+{
+    // ~80 dB of image rejection with the transition band just below the original Nyquist
+    first.set_window(8.0);
+    // later stages have a transition band that's a quarter of their rate wide, so they can afford more
+    for (int i = 0; i < MAX_STAGES - 1; i++)
+        next[i].set_window(10.0);
+    set_factor(1);
+}
+
+void oversampler::set_factor(int _factor)
+{
+    stages = 0;
+    while(stages < MAX_STAGES && (2 << stages) <= _factor)
+        stages++;
+    factor = 1 << stages;
+    // latency of all the stages, in samples at the highest rate
+    int total = 0;
+    for (int i = 0; i < stages; i++)
+        total += (i ? next[i - 1].get_latency() : first.get_latency()) << (stages - 1 - i);
+    pad = (factor - total % factor) % factor;
+    latency = (total + pad) / factor;
+    reset();
+}
+
+void oversampler::reset()
+{
+    first.reset();
+    for (int i = 0; i < MAX_STAGES - 1; i++)
+        next[i].reset();
+    dsp::zero(pad_buf, MAX_FACTOR);
+    pad_pos = 0;
+}
+
+void oversampler::upsample(const float *src, float *dst, uint32_t len)
+{
+    if (!stages)
+    {
+        if (dst != src)
+            memcpy(dst, src, len * sizeof(float));
+        return;
+    }
+    while(len)
+    {
+        uint32_t n = std::min<uint32_t>(len, MAX_BLOCK);
+        const float *cur = src;
+        for (int i = 0; i < stages; i++)
+        {
+            // alternate between two halves of the scratch buffer, the last stage writes straight to dst
+            float *out = (i == stages - 1) ? dst : scratch + (i & 1) * 2 * MAX_BLOCK;
+            if (i)
+                next[i - 1].upsample(cur, out, n << i);
+            else
+                first.upsample(cur, out, n);
+            cur = out;
+        }
+        src += n;
+        dst += n * factor;
+        len -= n;
+    }
+}
+
+void oversampler::downsample(const float *src, float *dst, uint32_t len)
+{
+    if (!stages)
+    {
+        if (dst != src)
+            memcpy(dst, src, len * sizeof(float));
+        return;
+    }
+    while(len)
+    {
+        uint32_t n = std::min<uint32_t>(len, MAX_BLOCK);
+        const float *cur = src;
+        if (pad)
+        {
+            for (uint32_t i = 0; i < n * factor; i++)
+            {
+                scratch[i] = pad_buf[pad_pos];
+                pad_buf[pad_pos] = src[i];
+                if (++pad_pos == pad)
+                    pad_pos = 0;
+            }
+            cur = scratch;
+        }
+        // decimation can be done in place, so the intermediate results stay in the scratch buffer
+        for (int i = stages - 1; i >= 0; i--)
+        {
+            float *out = i ? scratch : dst;
+            if (i)
+                next[i - 1].downsample(cur, out, n << i);
+            else
+                first.downsample(cur, out, n);
+            cur = out;
+        }
+        src += n * factor;
+        dst += n;
+        len -= n;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 simple_lfo::simple_lfo()
 {
     is_active       = false;
@@ -540,42 +768,54 @@ bool simple_lfo::get_dot(float &x, float &y, int &size, cairo_iface *context) co
 
 lookahead_limiter::lookahead_limiter() {
     is_active = false;
-    channels = 2;
-    id = 0;
-    buffer_size = 0;
-    overall_buffer_size = 0;
-    att = 1.f;
-    att_max = 1.0;
-    pos = 0;
-    delta = 0.f;
-    _delta = 0.f;
-    peak = 0.f;
-    over_s = 0;
-    over_c = 1.f;
+    srate = 0;
+    limit = 1.f;
     attack = 0.005;
-    use_multi = false;
+    release = 0.05;
     weight = 1.f;
-    _sanitize = false;
+    debug = false;
     auto_release = false;
     asc_active = false;
-    nextiter = 0;
-    nextlen = 0;
+    asc_coeff = 1.f;
+    att = 1.f;
+    att_max = 1.0;
+    buffer_size = 1;
+    overall_buffer_size = 0;
+    pos = 0;
+    bufferL = NULL;
+    bufferR = NULL;
+    asc_buffer = NULL;
+    env_buffer = NULL;
+    dq_gain = NULL;
+    dq_index = NULL;
+    env_sum = 0;
+    env = 1.f;
+    rdelta = 0.f;
+    releasing = false;
+    dq_head = 0;
+    dq_len = 0;
+    counter = 0;
     asc = 0.f;
     asc_c = 0;
-    asc_pos = -1;
-    asc_changed = false;
-    asc_coeff = 1.f;
+    asc_skip = 0;
+}
+
+lookahead_limiter::~lookahead_limiter()
+{
+    free(bufferL);
+    free(bufferR);
+    free(asc_buffer);
+    free(env_buffer);
+    free(dq_gain);
+    free(dq_index);
 }
 
 void lookahead_limiter::activate()
 {
     is_active = true;
-    pos = 0;
-
+    reset();
 }
 
-void lookahead_limiter::set_multi(bool set) { use_multi = set; }
-
 void lookahead_limiter::deactivate()
 {
     is_active = false;
@@ -591,15 +831,25 @@ float lookahead_limiter::get_attenuation()
 void lookahead_limiter::set_sample_rate(uint32_t sr)
 {
     srate = sr;
-    // rebuild buffer
-    overall_buffer_size = (int)(srate * (100.f / 1000.f) * channels) + channels; // buffer size attack rate multiplied by 2 channels
-    buffer = (float*) calloc(overall_buffer_size, sizeof(float));
-    memset(buffer, 0, overall_buffer_size * sizeof(float)); // reset buffer to zero
-    pos = 0;
-
-    nextpos = (int*) calloc(overall_buffer_size, sizeof(int));
-    nextdelta = (float*) calloc(overall_buffer_size, sizeof(float));
-    memset(nextpos, -1, overall_buffer_size * sizeof(int));
+    // rebuild buffers - they only ever grow, so that going back to a lower rate doesn't allocate
+    int size = (int)(srate * (100.f / 1000.f)) + 1; // maximum attack time
+    if (size > overall_buffer_size) {
+        free(bufferL);
+        free(bufferR);
+        free(asc_buffer);
+        free(env_buffer);
+        free(dq_gain);
+        free(dq_index);
+        overall_buffer_size = size;
+        bufferL = (float*) calloc(size, sizeof(float));
+        bufferR = (float*) calloc(size, sizeof(float));
+        asc_buffer = (float*) calloc(size, sizeof(float));
+        env_buffer = (float*) calloc(size, sizeof(float));
+        // the sliding window holds the lookahead time plus the current sample
+        dq_gain = (float*) calloc(size + 1, sizeof(float));
+        dq_index = (uint32_t*) calloc(size + 1, sizeof(uint32_t));
+    }
+    reset();
 }
 
 void lookahead_limiter::set_params(float l, float a, float r, float w, bool ar, float arc, bool d)
@@ -614,244 +864,178 @@ void lookahead_limiter::set_params(float l, float a, float r, float w, bool ar,
 }
 
 void lookahead_limiter::reset() {
-    int bs = (int)(srate * attack * channels);
-    buffer_size = bs - bs % channels; // buffer size attack rate
-    _sanitize = true;
+    if (!overall_buffer_size)
+        return;
+    buffer_size = std::max(1, std::min((int)(srate * attack), overall_buffer_size));
     pos = 0;
-    nextpos[0] = -1;
-    nextlen = 0;
-    nextiter = 0;
-    delta = 0.f;
+    memset(bufferL, 0, buffer_size * sizeof(float));
+    memset(bufferR, 0, buffer_size * sizeof(float));
+    memset(asc_buffer, 0, buffer_size * sizeof(float));
+    dsp::fill(env_buffer, 1.f, buffer_size);
+    env_sum = buffer_size;
+    env = 1.f;
     att = 1.f;
+    rdelta = 0.f;
+    releasing = false;
+    dq_head = 0;
+    dq_len = 0;
     reset_asc();
 }
 
 void lookahead_limiter::reset_asc() {
     asc = 0.f;
     asc_c = 0;
-    asc_pos = pos;
-    asc_changed = true;
+    // the peaks still in the delay line have not been counted
+    asc_skip = buffer_size;
 }
 
-float lookahead_limiter::get_rdelta(float peak, float _limit, float _att, bool _asc) {
+float lookahead_limiter::get_rdelta(float _att) {
     
     // calc the att for average input to walk to if we use asc (att of average signal)
     float _a_att = (limit * weight) / (asc_coeff * asc) * (float)asc_c;
 
     // calc a release delta from this attenuation
     float _rdelta = (1.0 - _att) / (srate * release);
-    if(_asc and auto_release and asc_c > 0 and _a_att > _att) {
+    if(auto_release and asc_c > 0 and _a_att > _att) {
         // check if releasing to average level of peaks is steeper than
         // releasing to 1.f
         float _delta = std::max((_a_att - _att) / (srate * release), _rdelta / 10);
         if(_delta < _rdelta) {
             asc_active = true;
-            _asc_used = true;
             _rdelta = _delta;
         }
     }
-    return _rdelta;
+    return std::max(_rdelta, 1e-9f);
 }
 
-void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
+void lookahead_limiter::process(float *left, float *right, const float *multi_coeff, uint32_t len)
 {
     // PROTIP: harming paying customers enough to make them develop a competing
     // product may be considered an example of a less than sound business practice.
-
-    // fill lookahead buffer
-    if(_sanitize) {
-        // if we're sanitizing (zeroing) the buffer on attack time change,
-        // don't write the samples to the buffer
-        buffer[pos] = 0.f;
-        buffer[pos + 1] = 0.f;
-    } else {
-        buffer[pos] = left;
-        buffer[pos + 1] = right;
+    for (uint32_t done = 0; done < len; done += BLOCK_SIZE)
+    {
+        int block = std::min((uint32_t)BLOCK_SIZE, len - done);
+        process_block(left + done, right + done, multi_coeff ? multi_coeff + done : NULL, block);
     }
-    
-    // are we using multiband? get the multiband coefficient or use 1.f
-    float multi_coeff = (use_multi) ? multi_buffer[pos] : 1.f;
-    
-    // calc the real limit including weight and multi coeff
-    float _limit = limit * multi_coeff * weight;
-    
-    // input peak - impact higher in left or right channel?
-    peak = fabs(left) > fabs(right) ? fabs(left) : fabs(right);
+}
 
-    // add an eventually appearing peak to the asc fake buffer if asc active
-    if(auto_release and peak > _limit) {
-        asc += peak;
-        asc_c ++;
+void lookahead_limiter::process_block(float *left, float *right, const float *multi_coeff, int len)
+{
+    // calc the gain each incoming sample needs (peaks) / allows (gains)
+    float _limit = limit * weight;
+    int i = 0;
+#ifdef __SSE__
+    __m128 sign = _mm_set1_ps(-0.f), one = _mm_set1_ps(1.f), tiny = _mm_set1_ps(1e-30f);
+    __m128 lim = _mm_set1_ps(_limit);
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128 peak = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(left + i)), _mm_andnot_ps(sign, _mm_loadu_ps(right + i)));
+        __m128 l = multi_coeff ? _mm_mul_ps(lim, _mm_loadu_ps(multi_coeff + i)) : lim;
+        _mm_storeu_ps(peaks + i, peak);
+        _mm_storeu_ps(gains + i, _mm_min_ps(one, _mm_div_ps(l, _mm_max_ps(peak, tiny))));
+    }
+#endif
+    for (; i < len; i++)
+    {
+        float peak = std::max(fabs(left[i]), fabs(right[i]));
+        float l = multi_coeff ? _limit * multi_coeff[i] : _limit;
+        peaks[i] = peak;
+        gains[i] = std::min(1.f, l / std::max(peak, 1e-30f));
     }
 
-    if(peak > _limit or multi_coeff < 1.0) {
-        float _multi_coeff = 1.f;
-        float _peak;
+    // envelope and delay line - sample by sample, but O(1) each
+    int cap = overall_buffer_size + 1;
+    for (i = 0; i < len; i++)
+    {
+        float g = gains[i];
+        uint32_t t = counter++;
+        // sliding minimum over the lookahead time: drop everything that is
+        // not lower than the new value from the back, outdated value from the front
+        while(dq_len and dq_gain[(dq_head + dq_len - 1) % cap] >= g)
+            dq_len--;
+        int back = (dq_head + dq_len) % cap;
+        dq_gain[back] = g;
+        dq_index[back] = t;
+        dq_len++;
+        if(t - dq_index[dq_head] > (uint32_t)buffer_size) {
+            dq_head = (dq_head + 1) % cap;
+            dq_len--;
+        }
+        float target = dq_gain[dq_head];
         
-        // calc the attenuation needed to reduce incoming peak
-        float _att = std::min(_limit / peak, 1.f);
-        // calc release without any asc to keep all relevant peaks
-        float _rdelta = get_rdelta(peak, _limit, _att, false);
-
-        // calc the delta for walking to incoming peak attenuation
-        float _delta = (_limit / peak - att) / buffer_size * channels;
-
-        if(_delta < delta) {
-            // is the delta more important than the actual one?
-            // if so, we can forget about all stored deltas (because they can't
-            // be more important - we already checked that earlier) and use this
-            // delta now. and we have to create a release delta in nextpos buffer
-            nextpos[0] = pos;
-            nextpos[1] = -1;
-            nextdelta[0] = _rdelta;
-            nextlen = 1;
-            nextiter = 0;
-            delta = _delta;
-        } else {
-            // we have a peak on input its delta is less important than the
-            // actual delta. But what about the stored deltas we're following?
-            bool _found = false;
-            int i = 0;
-            for(i = nextiter; i < nextiter + nextlen; i++) {
-                // walk through our nextpos buffer
-                int j = i % buffer_size;
-                // calculate a delta for the next stored peak
-                // are we using multiband? then get the multi_coeff for the
-                // stored position
-                _multi_coeff = (use_multi) ? multi_buffer[nextpos[j]] : 1.f;
-                // is the left or the right channel on this position more
-                // important?
-                _peak = fabs(buffer[nextpos[j]]) > fabs(buffer[nextpos[j] + 1]) ? fabs(buffer[nextpos[j]]) : fabs(buffer[nextpos[j] + 1]);
-                // calc a delta to use to reach our incoming peak from the
-                // stored position
-                _delta = (_limit / peak - (limit * _multi_coeff * weight) / _peak) / (((buffer_size - nextpos[j] + pos) % buffer_size) / channels);
-                if(_delta < nextdelta[j]) {
-                    // if the buffered delta is more important than the delta
-                    // used to reach our peak from the stored position, store
-                    // the new delta at that position and stop the loop
-                    nextdelta[j] = _delta;
-                    _found = true;
-                    break;
-                }
-            }
-            if(_found) {
-                // there was something more important in the next-buffer.
-                // throw away any position and delta after the important
-                // position and add a new release delta
-                nextlen = i - nextiter + 1;
-                nextpos[(nextiter + nextlen) % buffer_size] = pos;
-                nextdelta[(nextiter + nextlen) % buffer_size] = _rdelta;
-                // set the next following position value to -1 (cleaning up the
-                // nextpos buffer)
-                nextpos[(nextiter + nextlen + 1) % buffer_size] = -1;
-                // and raise the length of our nextpos buffer for keeping the
-                // release value
-                nextlen ++;
+        // attack immediately (the moving average below makes it a ramp over
+        // the lookahead time), release with the (asc) release delta
+        if(target < env) {
+            env = target;
+            releasing = false;
+        } else if(env < target) {
+            if(!releasing) {
+                rdelta = get_rdelta(env);
+                releasing = true;
             }
+            env = std::min(target, env + rdelta);
         }
-    }
-
-    // switch left and right pointers in buffer to output position
-    left = buffer[(pos + channels) % buffer_size];
-    right = buffer[(pos + channels + 1) % buffer_size];
-
-    // if a peak leaves the buffer, remove it from asc fake buffer
-    // but only if we're not sanitizing asc buffer
-    float _peak = fabs(left) > fabs(right) ? fabs(left) : fabs(right);
-    float _multi_coeff = (use_multi) ? multi_buffer[(pos + channels) % buffer_size] : 1.f;
-    if(pos == asc_pos and !asc_changed) {
-        asc_pos = -1;
-    }
-    if(auto_release and asc_pos == -1 and _peak > (limit * weight * _multi_coeff)) {
-        asc -= _peak;
-        asc_c --;
-    }
-
-    // change the attenuation level
-    att += delta;
-
-    // ...and calculate outpout from it
-    left *= att;
-    right *= att;
-    
-    if((pos + channels) % buffer_size == nextpos[nextiter]) {
-        // if we reach a buffered position, change the actual delta and erase
-        // this (the first) element from nextpos and nextdelta buffer
+        
+        // moving average over the lookahead time
+        env_sum += env - env_buffer[pos];
+        env_buffer[pos] = env;
+        gains[i] = env_sum / buffer_size;
+        
+        // keep track of the peaks in the lookahead buffer for asc
         if(auto_release) {
-            // set delta to asc influenced release delta
-            delta = get_rdelta(_peak, (limit * weight * _multi_coeff), att);
-            if(nextlen > 1) {
-                // if there are more positions to walk to, calc delta to next
-                // position in buffer and compare it to release delta (keep
-                // changes between peaks below asc steepness)
-                int _nextpos = nextpos[(nextiter + 1) % buffer_size];
-                float __peak = fabs(buffer[_nextpos]) > fabs(buffer[_nextpos + 1]) ? fabs(buffer[_nextpos]) : fabs(buffer[_nextpos + 1]);
-                float __multi_coeff = (use_multi) ? multi_buffer[_nextpos] : 1.f;
-                float __delta = ((limit * __multi_coeff * weight) / __peak - att) / (((buffer_size + _nextpos - ((pos + channels) % buffer_size)) % buffer_size) / channels);
-                if(__delta < delta) {
-                    delta = __delta;
-                }
+            if(asc_skip)
+                asc_skip--;
+            else if(asc_buffer[pos] > 0.f) {
+                asc -= asc_buffer[pos];
+                asc_c --;
+            }
+            asc_buffer[pos] = g < 1.f ? peaks[i] : 0.f;
+            if(g < 1.f) {
+                asc += peaks[i];
+                asc_c ++;
             }
-        } else {
-            // if no asc set delta from nextdelta buffer and fix the attenuation
-            delta = nextdelta[nextiter];
-            att = (limit * weight * _multi_coeff) / _peak;
         }
-        // remove first element from circular nextpos buffer
-        nextlen -= 1;
-        nextpos[nextiter] = -1;
-        nextiter = (nextiter + 1) % buffer_size;
-    }
-
-    if (att > 1.0f) {
-        // release time seems over, reset attenuation and delta
-        att = 1.0f;
-        delta = 0.0f;
-        nextiter = 0;
-        nextlen = 0;
-        nextpos[0] = -1;
-    }
-
-    // main limiting party is over, let's cleanup the puke
-
-    if(_sanitize) {
-        // we're sanitizing? then send 0.f as output
-        left = 0.f;
-        right = 0.f;
-    }
-
-    // security personnel pawing your values
-    if(att <= 0.f) {
-        // if this happens we're doomed!!
-        // may happen on manually lowering attack
-        att = 0.0000000000001;
-        delta = (1.0f - att) / (srate * release);
+        
+        // swap the incoming samples with the ones leaving the delay line
+        float l = bufferL[pos], r = bufferR[pos];
+        bufferL[pos] = left[i];
+        bufferR[pos] = right[i];
+        left[i] = l;
+        right[i] = r;
+        
+        if(++pos == buffer_size) {
+            pos = 0;
+            // get rid of the rounding errors accumulated in the running sum
+            env_sum = 0;
+            for(int j = 0; j < buffer_size; j++)
+                env_sum += env_buffer[j];
+        }
     }
-
-    if(att != 1.f and 1 - att < 0.0000000000001) {
-        // denormalize att
-        att = 1.f;
+    
+    // apply the gain
+    float _att_max = att_max;
+    i = 0;
+#ifdef __SSE__
+    __m128 amin = _mm_set1_ps(_att_max);
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128 g = _mm_loadu_ps(gains + i);
+        _mm_storeu_ps(left + i, _mm_mul_ps(_mm_loadu_ps(left + i), g));
+        _mm_storeu_ps(right + i, _mm_mul_ps(_mm_loadu_ps(right + i), g));
+        amin = _mm_min_ps(amin, g);
     }
-
-    if(delta != 0.f and fabs(delta) < 0.00000000000001) {
-        // denormalize delta
-        delta = 0.f;
+    float tmp[4];
+    _mm_storeu_ps(tmp, amin);
+    _att_max = std::min(std::min(tmp[0], tmp[1]), std::min(tmp[2], tmp[3]));
+#endif
+    for (; i < len; i++)
+    {
+        left[i] *= gains[i];
+        right[i] *= gains[i];
+        _att_max = std::min(_att_max, gains[i]);
     }
-
-    // post treatment (denormal, limit)
-    denormal(&left);
-    denormal(&right);
-
-    // store max attenuation for meter output
-    att_max = (att < att_max) ? att : att_max;
-
-    // step forward in our sample ring buffer
-    pos = (pos + channels) % buffer_size;
-
-    // sanitizing is always done after a full cycle through the lookahead buffer
-    if(_sanitize and pos == 0) _sanitize = false;
-
-    asc_changed = false;
+    att_max = _att_max;
+    att = gains[len - 1];
 }
 
 bool lookahead_limiter::get_asc() {
@@ -22,11 +22,6 @@
 
 #ifdef BENCHMARK_PLUGINS
 #include <calf/giface.h>
-#include <calf/modules.h>
-#include <calf/modules_comp.h>
-#include <calf/modules_dev.h>
-#include <calf/modules_eq.h>
-#include <calf/modules_mod.h>
 #else
 #include <config.h>
 #endif
@@ -34,6 +29,7 @@
 #include <calf/audio_fx.h>
 #include <calf/fft.h>
 #include <calf/loudness.h>
+#include <calf/osc.h>
 #include <calf/benchmark.h>
 #include <getopt.h>
 
@@ -149,6 +145,16 @@ struct filter_12dB_lp_d2: public filter_lp24dB_benchmark<biquad_d2<> >
     }
 };
 
+struct filter_24dB_lp_block_d2: public filter_lp24dB_benchmark<biquad_d2<> >
+{
+    void run()
+    {
+        dsp::denormal_guard guard;
+        biquad.process_block(buffer, buffer, BUF_SIZE);
+        biquad2.process_block(buffer, buffer, BUF_SIZE);
+    }
+};
+
 template<int N>
 struct fft_test_class
 {
@@ -171,6 +177,99 @@ struct fft_test_class
     double scaler() { return 1 << N; }
 };
 
+template<int N>
+struct fft_real_test_class
+{
+    typedef fft<float, N> fft_class;
+    fft_class ffter;
+    float result;
+    float data[1 << N];
+    complex<float> output[1 << N];
+    void prepare() {
+        for (int i = 0; i < (1 << N); i++)
+            data[i] = sin(i);
+        result = 0;
+    }
+    void cleanup()
+    {
+    }
+    void run()
+    {
+        ffter.calculate_real(data, output);
+    }
+    double scaler() { return 1 << N; }
+};
+
+/// Wavetable level lookup with wide and fast pitch modulation, so that the level changes often
+struct wavetable_lookup_benchmark: public empty_benchmark<4096>
+{
+    enum { BUF_SIZE = 4096 };
+    uint32_t deltas[BUF_SIZE];
+    float result;
+    
+    static waveform_family<12> &get_family()
+    {
+        static waveform_family<12> family;
+        if (family.empty())
+        {
+            static bandlimiter<12> bl;
+            float saw[1 << 12];
+            for (int i = 0; i < (1 << 12); i++)
+                saw[i] = -1 + i * 2.0 / (1 << 12);
+            family.make(bl, saw);
+        }
+        return family;
+    }
+    void prepare()
+    {
+        // 220 Hz at 44.1 kHz, +/- 3 octaves of pitch bend
+        for (int i = 0; i < BUF_SIZE; i++)
+            deltas[i] = (uint32_t)(4294967296.0 * 220 / 44100 * pow(2.0, 3 * sin(i * 2 * M_PI / 512)));
+        result = 0;
+    }
+};
+
+struct wavetable_lookup_map: public wavetable_lookup_benchmark
+{
+    std::map<uint32_t, float *> levels;
+    void prepare()
+    {
+        wavetable_lookup_benchmark::prepare();
+        waveform_family<12> &family = get_family();
+        levels.clear();
+        for (waveform_family<12>::iterator i = family.begin(); i != family.end(); i++)
+            levels[i->first] = i->second;
+    }
+    void run()
+    {
+        for (int i = 0; i < BUF_SIZE; i++)
+        {
+            std::map<uint32_t, float *>::iterator it = levels.upper_bound(deltas[i]);
+            if (it != levels.end())
+                result += it->second[i & 4095];
+        }
+    }
+};
+
+struct wavetable_lookup_flat: public wavetable_lookup_benchmark
+{
+    waveform_family<12> *family;
+    void prepare()
+    {
+        wavetable_lookup_benchmark::prepare();
+        family = &get_family();
+    }
+    void run()
+    {
+        for (int i = 0; i < BUF_SIZE; i++)
+        {
+            float *data = family->get_level(deltas[i]);
+            if (data)
+                result += data[i & 4095];
+        }
+    }
+};
+
 #define ALIGN_TEST_RUN 1024
 
 struct __attribute__((aligned(8))) alignment_test: public empty_benchmark<ALIGN_TEST_RUN>
@@ -217,11 +316,17 @@ struct __attribute__((aligned(8))) misaligned_double: public alignment_test
 };
 
 const char *unit = NULL;
+/// samples per block in the effects unit
+int effect_block_size = 256;
+/// print the effects results as a JSON document (and run nothing else)
+bool json_output = false;
 
 static struct option long_options[] = {
     {"help", 0, 0, 'h'},
     {"version", 0, 0, 'v'},
     {"unit", 1, 0, 'u'},
+    {"block-size", 1, 0, 'b'},
+    {"json", 0, 0, 'j'},
     {0,0,0,0},
 };
 
@@ -234,11 +339,19 @@ void biquad_test()
         do_simple_benchmark<filter_24dB_lp_onepass_d2>();
         do_simple_benchmark<filter_24dB_lp_onepass_d2_lp>();
         do_simple_benchmark<filter_12dB_lp_d2>();
+        do_simple_benchmark<filter_24dB_lp_block_d2>();
 }
 
 void fft_test()
 {
         do_simple_benchmark<fft_test_class<17> >(5, 10);
+        do_simple_benchmark<fft_real_test_class<17> >(5, 10);
+}
+
+void wavetable_test()
+{
+        do_simple_benchmark<wavetable_lookup_map>(5, 1000);
+        do_simple_benchmark<wavetable_lookup_flat>(5, 1000);
 }
 
 void alignment_test()
@@ -248,123 +361,190 @@ void alignment_test()
 }
 
 #ifdef BENCHMARK_PLUGINS
-template<class Effect>
-void get_default_effect_params(float params[Effect::param_count], uint32_t &sr);
-
-template<>
-void get_default_effect_params<calf_plugins::reverb_audio_module>(float params[3], uint32_t &sr)
-{
-    typedef calf_plugins::reverb_audio_module mod;
-    params[mod::par_decay] = 4;
-    params[mod::par_hfdamp] = 2000;
-    params[mod::par_amount] = 2;
-    sr = 4000;
-}
-
-template<>
-void get_default_effect_params<calf_plugins::filter_audio_module>(float params[4], uint32_t &sr)
-{
-    typedef calf_plugins::filter_audio_module mod;
-    params[mod::par_cutoff] = 500;
-    params[mod::par_resonance] = 3;
-    params[mod::par_mode] = 2;
-    params[mod::par_inertia] = 16;
-    sr = 4000;
-}
-
-template<>
-void get_default_effect_params<calf_plugins::flanger_audio_module>(float params[5], uint32_t &sr)
-{
-    typedef calf_plugins::flanger_audio_module mod;
-    params[mod::par_delay] = 1;
-    params[mod::par_depth] = 2;
-    params[mod::par_rate] = 1;
-    params[mod::par_fb] = 0.9;
-    params[mod::par_amount] = 0.9;
-    sr = 44100;
-}
-
-template<>
-void get_default_effect_params<calf_plugins::compressor_audio_module>(float params[], uint32_t &sr)
-{
-    typedef calf_plugins::compressor_audio_module mod;
-    params[mod::param_threshold] = 10;
-    params[mod::param_ratio] = 2;
-    params[mod::param_attack] = 0.1;
-    params[mod::param_release] = 100;
-    params[mod::param_makeup] = 1;
-    params[mod::param_stereo_link] = 1;
-    params[mod::param_detection] = 0;
-    params[mod::param_knee] = 40000;
-    params[mod::param_bypass] = 0;
-    sr = 44100;
-}
+extern "C" calf_plugins::audio_module_iface *create_calf_plugin_by_name(const char *effect_name);
 
-template<>
-void get_default_effect_params<calf_plugins::multichorus_audio_module>(float params[], uint32_t &sr)
+/// Per-plugin realtime benchmark: every plugin in the registry, run block by block
+/// the way a host would, with every block timed separately
+struct plugin_benchmark
 {
-    typedef calf_plugins::multichorus_audio_module mod;
-    params[mod::par_delay] = 10;
-    params[mod::par_depth] = 10;
-    params[mod::par_rate] = 1;
-    params[mod::par_voices] = 6;
-    params[mod::par_stereo] = 180;
-    params[mod::par_vphase] = 20;
-    params[mod::par_amount] = 0.9;
-    sr = 44100;
-}
-
-template<class Effect, unsigned int bufsize = 256>
-class effect_benchmark: public empty_benchmark<bufsize>
-{
-public:
-    Effect effect;
-    float inputs[Effect::in_count][bufsize];
-    float outputs[Effect::out_count][bufsize];
-    float result;
-    float params[Effect::param_count];
+    enum { SAMPLE_RATE = 44100, WARMUP_BLOCKS = 50, BLOCKS = 1000 };
+    enum preset_type { PRESET_DEFAULT, PRESET_MIN, PRESET_MAX, PRESET_COUNT };
     
-    void prepare()
+    const calf_plugins::plugin_metadata_iface *metadata;
+    calf_plugins::audio_module_iface *module;
+    std::vector<float> params;
+    std::vector<std::vector<float> > inputs, outputs;
+    std::vector<double> block_ns;
+    uint32_t noise;
+    
+    plugin_benchmark(const calf_plugins::plugin_metadata_iface *md)
+    : metadata(md)
+    , module(NULL)
+    , noise(12345)
     {
-        for (int b = 0; b < Effect::out_count; b++)
-        {
-            effect.outs[b] = outputs[b];
-            dsp::zero(outputs[b], bufsize);
-        }
-        for (int b = 0; b < Effect::in_count; b++)
+    }
+    ~plugin_benchmark()
+    {
+        delete module;
+    }
+    static const char *get_preset_name(int preset)
+    {
+        static const char *names[] = { "default", "min", "max" };
+        return names[preset];
+    }
+    static double now_ns()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return ts.tv_sec * 1e9 + ts.tv_nsec;
+    }
+    /// Set all the controls to defaults, or push the ones that matter for CPU load to one of the extremes
+    void set_params(int preset)
+    {
+        for (int i = 0; i < metadata->get_param_count(); i++)
         {
-            effect.ins[b] = inputs[b];
-            for (unsigned int i = 0; i < bufsize; i++)
-                inputs[b][i] = (float)(10 + i*0.3f*(b+1));
+            const calf_plugins::parameter_properties &props = *metadata->get_param_props(i);
+            float value = props.def_value;
+            // bypass and one-shot buttons would make the stress presets do less work, not more
+            bool skip = (props.flags & calf_plugins::PF_PROP_OUTPUT) || (props.flags & calf_plugins::PF_CTLMASK) == calf_plugins::PF_CTL_BUTTON || !strcmp(props.short_name, "bypass");
+            if (!skip && preset == PRESET_MIN)
+                value = props.min;
+            if (!skip && preset == PRESET_MAX)
+                value = props.max;
+            params[i] = value;
         }
-        for (int i = 0; i < Effect::param_count; i++)
-            effect.params[i] = &params[i];
-        ::get_default_effect_params<Effect>(params, effect.srate);
-        result = 0.f;
-        effect.activate();
     }
-    void run()
+    void fill_inputs()
     {
-        effect.params_changed();
-        effect.process(0, bufsize, 3, 3);
+        // -6 dB of noise with a low sine on top, so that dynamics processors have something to chew on
+        for (size_t c = 0; c < inputs.size(); c++)
+        {
+            for (int i = 0; i < effect_block_size; i++)
+            {
+                noise = noise * 1664525 + 1013904223;
+                inputs[c][i] = 0.25f * ((int32_t)noise * (1.0f / 2147483648.0f)) + 0.25f * sinf(i * (2 * M_PI / effect_block_size));
+            }
+        }
     }
-    void cleanup()
+    bool run(int preset)
     {
-        for (int b = 0; b < Effect::out_count; b++)
+        delete module;
+        module = create_calf_plugin_by_name(metadata->get_id());
+        if (!module)
+            return false;
+        
+        int in_count = metadata->get_input_count(), out_count = metadata->get_output_count();
+        params.assign(metadata->get_param_count(), 0.f);
+        inputs.assign(in_count, std::vector<float>(effect_block_size));
+        outputs.assign(out_count, std::vector<float>(effect_block_size));
+        float **ins, **outs, **param_ptrs;
+        module->get_port_arrays(ins, outs, param_ptrs);
+        for (int i = 0; i < in_count; i++)
+            ins[i] = &inputs[i][0];
+        for (int i = 0; i < out_count; i++)
+            outs[i] = &outputs[i][0];
+        for (int i = 0; i < metadata->get_param_count(); i++)
+            param_ptrs[i] = &params[i];
+        set_params(preset);
+        
+        module->post_instantiate();
+        module->set_sample_rate(SAMPLE_RATE);
+        module->activate();
+        module->params_changed();
+        // synths need something to play - a full chord keeps most of the voices busy
+        if (metadata->get_midi())
         {
-            for (unsigned int i = 0; i < bufsize; i++)
-                result += outputs[b][i];
+            for (int n = 0; n < 8; n++)
+                module->note_on(0, 48 + 5 * n, 100);
         }
+        
+        block_ns.clear();
+        for (int b = 0; b < WARMUP_BLOCKS + BLOCKS; b++)
+        {
+            fill_inputs();
+            double start = now_ns();
+            module->params_changed();
+            module->process_slice(0, effect_block_size);
+            double end = now_ns();
+            if (b >= WARMUP_BLOCKS)
+                block_ns.push_back(end - start);
+        }
+        module->deactivate();
+        std::sort(block_ns.begin(), block_ns.end());
+        return true;
+    }
+    double get_ns_per_sample() const
+    {
+        double total = 0;
+        for (size_t i = 0; i < block_ns.size(); i++)
+            total += block_ns[i];
+        return total / ((double)BLOCKS * effect_block_size);
+    }
+    void print_json(int preset, bool first)
+    {
+        double ns_per_sample = get_ns_per_sample();
+        printf("%s\n        { \"preset\": \"%s\", \"ns_per_sample\": %.3f, \"realtime_factor\": %.2f, \"block_ns\": { \"p50\": %.0f, \"p99\": %.0f, \"max\": %.0f } }",
+            first ? "" : ",",
+            get_preset_name(preset),
+            ns_per_sample,
+            1e9 / (SAMPLE_RATE * ns_per_sample),
+            block_ns[block_ns.size() / 2],
+            block_ns[block_ns.size() * 99 / 100],
+            block_ns.back());
+    }
+    void print_text(int preset)
+    {
+        double ns_per_sample = get_ns_per_sample();
+        printf("%-24s %-8s %9.3f ns/sample %9.2fx realtime, block p50 %.0f p99 %.0f max %.0f ns\n",
+            metadata->get_id(),
+            get_preset_name(preset),
+            ns_per_sample,
+            1e9 / (SAMPLE_RATE * ns_per_sample),
+            block_ns[block_ns.size() / 2],
+            block_ns[block_ns.size() * 99 / 100],
+            block_ns.back());
     }
 };
 
 void effect_test()
 {
-    dsp::do_simple_benchmark<effect_benchmark<calf_plugins::flanger_audio_module> >(5, 10000);
-    dsp::do_simple_benchmark<effect_benchmark<calf_plugins::reverb_audio_module> >(5, 1000);
-    dsp::do_simple_benchmark<effect_benchmark<calf_plugins::filter_audio_module> >(5, 10000);
-    dsp::do_simple_benchmark<effect_benchmark<calf_plugins::compressor_audio_module> >(5, 10000);
-    dsp::do_simple_benchmark<effect_benchmark<calf_plugins::multichorus_audio_module> >(5, 10000);
+    if (setpriority(PRIO_PROCESS, getpid(), -20) < 0)
+        fprintf(stderr, "Warning: could not set process priority, measurements can be worthless\n");
+    
+    const calf_plugins::plugin_registry::plugin_vector &plugins = calf_plugins::plugin_registry::instance().get_all();
+    if (json_output)
+        printf("{\n  \"version\": \"%s\",\n  \"sample_rate\": %d,\n  \"block_size\": %d,\n  \"blocks\": %d,\n  \"plugins\": [",
+            PACKAGE_STRING, (int)plugin_benchmark::SAMPLE_RATE, effect_block_size, (int)plugin_benchmark::BLOCKS);
+    else
+        printf("Effects, %d samples per block:\n", effect_block_size);
+    bool first_plugin = true;
+    for (size_t i = 0; i < plugins.size(); i++)
+    {
+        plugin_benchmark bench(plugins[i]);
+        bool first_preset = true;
+        for (int preset = 0; preset < plugin_benchmark::PRESET_COUNT; preset++)
+        {
+            if (!bench.run(preset))
+            {
+                fprintf(stderr, "Cannot instantiate plugin %s\n", plugins[i]->get_id());
+                break;
+            }
+            if (!json_output)
+            {
+                bench.print_text(preset);
+                continue;
+            }
+            if (first_preset)
+                printf("%s\n    { \"id\": \"%s\", \"name\": \"%s\", \"results\": [", first_plugin ? "" : ",", plugins[i]->get_id(), plugins[i]->get_label());
+            bench.print_json(preset, first_preset);
+            first_preset = first_plugin = false;
+        }
+        if (json_output && !first_preset)
+            printf("\n    ] }");
+        fflush(stdout);
+    }
+    if (json_output)
+        printf("\n  ]\n}\n");
 }
 
 #else
@@ -430,12 +610,12 @@ void aweighting_calc()
 
 #ifdef TEST_OSC
 
-struct my_sink: public osc_message_sink<osc_strstream>
+struct my_sink: public osc_message_sink<osc_rawstream>
 {
     GMainLoop *loop;
-    osc_message_dump<osc_strstream, ostream> dump;
+    osc_message_dump<osc_rawstream, ostream> dump;
     my_sink() : dump(cout) {}
-    virtual void receive_osc_message(std::string address, std::string type_tag, osc_strstream &buffer)
+    virtual void receive_osc_message(osc_string_ref address, osc_string_ref type_tag, osc_rawstream &buffer)
     {
         dump.receive_osc_message(address, type_tag, buffer);
         assert(address == "/blah");
@@ -497,13 +677,15 @@ int main(int argc, char *argv[])
 {
     while(1) {
         int option_index;
-        int c = getopt_long(argc, argv, "u:hv", long_options, &option_index);
+        int c = getopt_long(argc, argv, "u:b:jhv", long_options, &option_index);
         if (c == -1)
             break;
         switch(c) {
             case 'h':
             case '?':
-                printf("Benchmark suite Calf plugin pack\nSyntax: %s [--help] [--version] [--unit biquad|alignment|effects]\n", argv[0]);
+                printf("Benchmark suite Calf plugin pack\nSyntax: %s [--help] [--version] [--unit biquad|alignment|effects|fft|wavetable] [--block-size N] [--json]\n"
+                    "The effects unit runs every plugin with default and extreme settings, N samples (256 by default) per block\n"
+                    "--json runs the effects unit only and prints its results as a JSON document\n", argv[0]);
                 return 0;
             case 'v':
                 printf("%s\n", PACKAGE_STRING);
@@ -511,9 +693,21 @@ int main(int argc, char *argv[])
             case 'u':
                 unit = optarg;
                 break;
+            case 'b':
+                effect_block_size = std::max(1, atoi(optarg));
+                break;
+            case 'j':
+                json_output = true;
+                break;
         }
     }
     
+    if (json_output)
+    {
+        effect_test();
+        return 0;
+    }
+    
 #ifdef TEST_OSC
     if (unit && !strcmp(unit, "osc"))
         osctl_test();
@@ -539,6 +733,9 @@ int main(int argc, char *argv[])
 
     if (!unit || !strcmp(unit, "fft"))
         fft_test();
+
+    if (!unit || !strcmp(unit, "wavetable"))
+        wavetable_test();
     
     return 0;
 }
@@ -0,0 +1,177 @@
+/* Calf DSP Library
+ * Spectrum analysis running outside of the audio thread.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman, Markus Schmidt and others
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef CALF_ANALYZER_H
+#define CALF_ANALYZER_H
+
+#include <fftw3.h>
+#include <pthread.h>
+#include <stdint.h>
+#include "primitives.h"
+
+namespace dsp {
+
+/// Ring of stereo sample pairs with one writer (the audio thread) and one
+/// reader (the analysis thread). Sample pairs are numbered by a free running
+/// sequence number; the reader asks for the pairs ending at a given sequence
+/// number and is told if the writer lapped it while copying, so a torn window
+/// is dropped instead of being analysed.
+class stereo_sample_ring
+{
+public:
+    enum {
+        SIZE = 65536,
+        MASK = SIZE - 1,
+        /// The writer must publish at least every GUARD pairs
+        GUARD = 4096,
+        /// Longest window that can be read safely
+        MAX_READ = SIZE - GUARD,
+    };
+private:
+    float *data;
+    /// Sequence number of the next pair to be written (writer only)
+    uint32_t head;
+    /// Sequence number of the first pair not visible to the reader yet
+    volatile uint32_t tail;
+public:
+    stereo_sample_ring();
+    ~stereo_sample_ring();
+    /// Writer side: append one pair (not visible until publish is called)
+    inline void put(float left, float right)
+    {
+        float *p = data + 2 * (head & MASK);
+        p[0] = left;
+        p[1] = right;
+        head++;
+    }
+    /// Writer side: make everything put so far visible to the reader
+    inline void publish()
+    {
+        __sync_synchronize();
+        tail = head;
+    }
+    /// Reader side: sequence number one past the newest published pair
+    inline uint32_t get_tail() const
+    {
+        uint32_t t = tail;
+        __sync_synchronize();
+        return t;
+    }
+    /// Reader side: copy count pairs ending at sequence number end (not newer
+    /// than get_tail()), returns false if some of them got overwritten
+    bool read(uint32_t end, int count, float *left, float *right) const;
+};
+
+/// Analysis settings, written by the audio thread and read by the worker
+struct spectrum_settings
+{
+    /// FFT size
+    int accuracy;
+    /// Analyzer mode (see analyzer_audio_module::get_graph)
+    int mode;
+    /// 0 - off, 1 - falling, 2 - smoothing
+    int smoothing;
+    /// Number of worker ticks between two display updates
+    int speed;
+    /// Windowing function index
+    int windowing;
+    /// 0 - one FFT per display update, n - continuous STFT with a hop of accuracy / 2^n
+    int overlap;
+    /// STFT results shown per display update: 0 - peak, 1 - average (power)
+    int accumulate;
+    /// Incremented whenever the accumulated state (hold, smoothing) has to be cleared
+    int reset_serial;
+};
+
+/// Ready to draw magnitude spectra, one value per FFT bin
+struct spectrum_frame
+{
+    /// FFT size the values were computed with (0 = nothing computed yet)
+    int accuracy;
+    /// Analyzer mode the values were computed for
+    int mode;
+    /// Current values (smoothed or falling if enabled)
+    float *outL, *outR;
+    /// Peak hold values
+    float *holdL, *holdR;
+};
+
+/// Dedicated thread doing the windowing, FFT, smoothing and peak hold of the
+/// spectrum analyzer. The audio thread only feeds the sample ring, the GUI
+/// only picks up the newest finished frame. With overlap enabled, the worker
+/// runs a continuous STFT over all of the audio and accumulates the results
+/// (peak or average per bin) between display updates.
+class spectrum_worker
+{
+public:
+    enum { MAX_ACCURACY = 32768, TICKS_PER_SECOND = 30 };
+    /// Sample ring fed by the audio thread
+    stereo_sample_ring ring;
+private:
+    triple_buffer<spectrum_frame> frames;
+    spectrum_settings settings;
+    volatile int settings_serial;
+    /// Incremented by the consumer on every fetch - the worker idles when nobody watches
+    volatile int fetch_count;
+    volatile bool running;
+    bool thread_started;
+    pthread_t thread;
+
+    // worker thread state
+    spectrum_settings cur;
+    fftwf_plan plan;
+    int plan_accuracy;
+    int last_reset_serial, window_type, window_accuracy, window_overlap;
+    int ticks, idle_ticks, last_fetch_count;
+    /// STFT position - sequence number of the end of the next window
+    uint32_t stft_end;
+    bool stft_synced;
+    /// Number of STFT windows accumulated since the last display update
+    int acc_count;
+    float *window;
+    float *inL, *inR, *fftL, *fftR, *magL, *magR, *accL, *accR;
+    float *smoothL, *smoothR, *deltaL, *deltaR, *holdL, *holdR;
+
+    static void *thread_func(void *arg);
+    bool read_settings(spectrum_settings &s) const;
+    void reset_state();
+    void build_window();
+    void transform(bool stereo);
+    void magnitudes(float *fft) const;
+    void run_stft(bool stereo);
+    void tick();
+public:
+    spectrum_worker();
+    ~spectrum_worker();
+    /// Start the analysis thread
+    void start();
+    /// Stop the analysis thread and wait for it to finish
+    void stop();
+    /// Audio thread: change the analysis settings
+    void set_settings(const spectrum_settings &s);
+    /// GUI thread: pick up the newest frame if there is one, returns false otherwise
+    bool fetch() { fetch_count++; return frames.fetch(); }
+    /// GUI thread: the frame picked up by the last successful fetch
+    spectrum_frame &get_frame() { return frames.read_slot(); }
+};
+
+};
+
+#endif
@@ -339,21 +339,55 @@ public:
  * A classic allpass loop reverb with modulated allpass filter.
  * Just started implementing it, so there is no control over many
  * parameters.
+ *
+ * The block version of process runs the twelve allpass stages side by side,
+ * as three groups of four lanes, with every stage taking the output of the
+ * previous one from one sample ago (a pipeline, adding one sample of delay
+ * per stage). Stage 3 * j + g sits in lane j of group g, so a group always
+ * feeds the next one lane for lane. The LFO is evaluated at the block
+ * boundaries and the tap positions are interpolated in between.
  */
 class reverb: public audio_effect
 {
+public:
+    enum quality_type {
+        QUALITY_LOW,    ///< block engine, no modulation, no tap interpolation
+        QUALITY_MEDIUM, ///< block engine
+        QUALITY_HIGH,   ///< the original one sample at a time loop
+    };
+private:
     simple_delay<2048, float> apL1, apL2, apL3, apL4, apL5, apL6;
     simple_delay<2048, float> apR1, apR2, apR3, apR4, apR5, apR6;
     fixed_point<unsigned int, 25> phase, dphase;
     sine_table<int, 128, 10000> sine;
     onepole<float> lp_left, lp_right;
     float old_left, old_right;
-    int type;
+    int type, quality;
     float time, fb, cutoff, diffusion;
     int tl[6], tr[6];
     float ldec[6], rdec[6];
 
+    enum { LINE_SIZE = 2048, LINE_MASK = LINE_SIZE - 1 };
+    /// delay lines of the block engine, one four lane frame per sample
+    float lines[3][LINE_SIZE][4];
+    int line_pos;
+    /// output of every stage for the last sample
+    float lane_out[3][4];
+    /// delay (in samples) and allpass coefficient of every stage
+    float lane_time[3][4], lane_dec[3][4];
+
     int sr;
+    /// LFO value (scaled for 16.16 fixed point delays) the given number of samples from now
+    inline int get_lfo(uint32_t ahead = 0) const
+    {
+        fixed_point<unsigned int, 25> p = phase + dphase * (int)ahead;
+        unsigned int ipart = p.ipart();
+        // the interpolated LFO might be an overkill here
+        return p.lerp_by_fract_int<int, 14, int>(sine.data[ipart], sine.data[ipart+1]) >> 2;
+    }
+    void clear_lanes();
+    template<bool Interpolate>
+    void process_lanes(float *left, float *right, uint32_t len, float delay[3][4], const float ddelay[3][4]);
 public:
     reverb()
     {
@@ -361,8 +395,10 @@ public:
         time = 1.0;
         cutoff = 9000;
         type = 2;
+        quality = QUALITY_HIGH;
         diffusion = 1.f;
         setup(44100);
+        clear_lanes();
     }
     virtual void setup(int sample_rate) {
         sr = sample_rate;
@@ -416,8 +452,22 @@ public:
         lp_left.set_lp(cutoff,sr);
         lp_right.set_lp(cutoff,sr);
     }
+    int get_quality() const {
+        return quality;
+    }
+    /// Switch between the engines (one of quality_type), the one switched to starts silent
+    void set_quality(int quality) {
+        if (quality == this->quality)
+            return;
+        if ((quality == QUALITY_HIGH) != (this->quality == QUALITY_HIGH))
+            reset();
+        this->quality = quality;
+    }
     void reset();
+    /// Process a single sample, always with the original (high quality) loop
     void process(float &left, float &right);
+    /// Process len samples in place, with the engine selected by set_quality
+    void process(float *left, float *right, uint32_t len);
     void extra_sanitize()
     {
         lp_left.sanitize();
@@ -467,6 +517,13 @@ public:
     int process_channel(uint16_t channel_no, const float *in, float *out, uint32_t numsamples, int inmask);
     /// Determine gain (|H(z)|) for a given frequency
     float freq_gain(int subindex, float freq, float srate) const;
+    /// Add the sections of the current filter to a frequency response graph
+    template<class Response>
+    void add_to_response(Response &response) const
+    {
+        for (int j = 0; j < order; j++)
+            response.add(left[j]);
+    }
 };
 
 class two_band_eq
@@ -543,6 +600,144 @@ public:
     }
 };
 
+/**
+ * One 2x stage of the oversampler - a linear phase half-band FIR filter in
+ * polyphase form. Every other tap of a half-band filter is zero, except the
+ * centre one (which is 0.5), so the interpolator only has to compute every
+ * other output sample and the decimator only has to filter every other input
+ * sample - both with the same branch of 2 * Half coefficients.
+ */
+template<int Half>
+class halfband_resampler
+{
+public:
+    enum { BRANCH = 2 * Half, LENGTH = 4 * Half - 1 };
+protected:
+    /// nonzero off-centre coefficients (scaled so that they sum up to 1), order: oldest sample first
+    float coeffs[BRANCH];
+    /// doubled history buffers, so that a window of BRANCH samples is always contiguous
+    float up_hist[2 * BRANCH], down_hist[2 * BRANCH], down_centre[Half];
+    int up_pos, down_pos, centre_pos;
+
+    static inline float dot(const float *data, const float *coeffs)
+    {
+        int i = 0;
+        float sum = 0.f;
+#ifdef __SSE__
+        __m128 acc = _mm_setzero_ps();
+        for (; i + 4 <= BRANCH; i += 4)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(data + i), _mm_loadu_ps(coeffs + i)));
+        float part[4];
+        _mm_storeu_ps(part, acc);
+        sum = (part[0] + part[1]) + (part[2] + part[3]);
+#endif
+        for (; i < BRANCH; i++)
+            sum += data[i] * coeffs[i];
+        return sum;
+    }
+public:
+    halfband_resampler() { reset(); }
+    /// Design the filter (Kaiser windowed sinc with the specified window parameter)
+    void set_window(double beta)
+    {
+        double sum = 0;
+        for (int k = 0; k < BRANCH; k++)
+        {
+            // even taps of the full filter, odd distance from the centre
+            int i = 2 * k, dist = i - (2 * Half - 1);
+            double t = 2.0 * i / (LENGTH - 1) - 1.0;
+            double sinc = sin(M_PI * dist / 2) / (M_PI * dist);
+            coeffs[k] = sinc * bessel_i0(beta * sqrt(1.0 - t * t));
+            sum += coeffs[k];
+        }
+        for (int k = 0; k < BRANCH; k++)
+            coeffs[k] /= sum;
+    }
+    /// Modified Bessel function of the first kind, order 0 (for the Kaiser window)
+    static double bessel_i0(double x)
+    {
+        double sum = 1, term = 1;
+        for (int k = 1; k < 50 && term > sum * 1e-12; k++)
+        {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+        return sum;
+    }
+    void reset()
+    {
+        dsp::zero(up_hist, 2 * BRANCH);
+        dsp::zero(down_hist, 2 * BRANCH);
+        dsp::zero(down_centre, Half);
+        up_pos = down_pos = centre_pos = 0;
+    }
+    /// Latency of upsampling followed by downsampling, in samples of the higher rate
+    static int get_latency() { return LENGTH - 1; }
+    /// Interpolate len samples of src into 2 * len samples of dst
+    void upsample(const float *src, float *dst, uint32_t len)
+    {
+        for (uint32_t i = 0; i < len; i++)
+        {
+            up_hist[up_pos] = up_hist[up_pos + BRANCH] = src[i];
+            if (++up_pos == BRANCH)
+                up_pos = 0;
+            // the window starts at the oldest sample; the centre tap delays by Half - 1 input samples
+            dst[2 * i] = dot(up_hist + up_pos, coeffs);
+            dst[2 * i + 1] = up_hist[up_pos + Half];
+        }
+    }
+    /// Decimate 2 * len samples of src into len samples of dst (dst may be the same as src)
+    void downsample(const float *src, float *dst, uint32_t len)
+    {
+        for (uint32_t i = 0; i < len; i++)
+        {
+            float even = src[2 * i], odd = src[2 * i + 1];
+            down_hist[down_pos] = down_hist[down_pos + BRANCH] = even;
+            if (++down_pos == BRANCH)
+                down_pos = 0;
+            float centre = down_centre[centre_pos];
+            down_centre[centre_pos] = odd;
+            if (++centre_pos == Half)
+                centre_pos = 0;
+            dst[i] = 0.5f * (dot(down_hist + down_pos, coeffs) + centre);
+        }
+    }
+};
+
+/**
+ * Polyphase oversampler for nonlinear processing - 1x, 2x, 4x or 8x, done
+ * with a cascade of half-band stages. The first stage does all the hard work
+ * (the transition band around the original Nyquist frequency), the later ones
+ * only need to reject the images far above it, so they are much shorter.
+ * A short delay at the highest rate rounds the latency up to a whole number
+ * of samples, so that the dry signal can be aligned with a plain delay line.
+ */
+class oversampler
+{
+public:
+    enum { MAX_FACTOR = 8, MAX_STAGES = 3, MAX_BLOCK = 256 };
+protected:
+    halfband_resampler<16> first;
+    halfband_resampler<8> next[MAX_STAGES - 1];
+    int stages, factor, latency;
+    /// extra delay at the oversampled rate
+    float pad_buf[MAX_FACTOR];
+    int pad, pad_pos;
+    float scratch[MAX_FACTOR * MAX_BLOCK];
+public:
+    oversampler();
+    /// Set oversampling factor (1, 2, 4 or 8, other values are rounded down) and reset the state
+    void set_factor(int factor);
+    int get_factor() const { return factor; }
+    /// Latency of upsample + downsample, in samples at the original rate
+    int get_latency() const { return latency; }
+    void reset();
+    /// Convert len samples of src into len * factor samples of dst
+    void upsample(const float *src, float *dst, uint32_t len);
+    /// Convert len * factor samples of src into len samples of dst
+    void downsample(const float *src, float *dst, uint32_t len);
+};
+
 /// LFO module by Markus
 /// This module provides simple LFO's (sine=0, triangle=1, square=2, saw_up=3, saw_down=4)
 /// get_value() returns a value between -1 and 1
@@ -567,51 +762,58 @@ public:
 
 
 /// Lookahead Limiter by Markus Schmidt and Christian Holschuh
+///
+/// Processes blocks of samples. The gain each incoming sample needs is
+/// computed first, a monotonic deque tracks the minimum of it over the
+/// lookahead window (O(1) amortized per sample), the result gets the release
+/// applied and is smoothed by a moving average over the lookahead time, so
+/// the gain reaches the required value right when the peak leaves the delay
+/// line. The gain is then applied to the delayed samples in a SIMD loop.
 class lookahead_limiter {
-private:
 public:
+    enum { BLOCK_SIZE = 256 };
     float limit, attack, release, weight;
     uint32_t srate;
     float att; // a coefficient the output is multiplied with
     float att_max; // a memory for the highest attenuation - used for display
-    int pos; // where we are actually in our sample buffer
-    int buffer_size;
-    int overall_buffer_size;
     bool is_active;
     bool debug;
     bool auto_release;
     bool asc_active;
-    float *buffer;
-    int channels;
-    float delta;
-    float _delta;
-    float peak;
-    unsigned int over_s;
-    float over_c;
-    bool use_multi;
-    unsigned int id;
-    bool _sanitize;
-    int nextiter;
-    int nextlen;
-    int * nextpos;
-    float * nextdelta;
-    int asc_c;
-    float asc;
-    int asc_pos;
-    bool asc_changed;
     float asc_coeff;
-    bool _asc_used;
-    static inline void denormal(volatile float *f) {
-	    *f += 1e-18;
-	    *f -= 1e-18;
-    }
-    inline float get_rdelta(float peak, float _limit, float _att, bool _asc = true);
+private:
+    int buffer_size; // lookahead time in samples
+    int overall_buffer_size; // allocated size of the buffers
+    int pos; // where we are actually in our sample buffer
+    float *bufferL, *bufferR; // lookahead delay lines
+    float *asc_buffer; // peaks counted into asc, by delay line position
+    float *env_buffer; // envelope history for the moving average
+    double env_sum;
+    float env; // gain envelope before smoothing
+    float rdelta; // release step of the envelope
+    bool releasing;
+    // sliding minimum of the required gain - a ring of (sample index, gain)
+    // pairs with increasing gain
+    float *dq_gain;
+    uint32_t *dq_index;
+    int dq_head, dq_len;
+    uint32_t counter;
+    float asc;
+    int asc_c;
+    int asc_skip;
+    float peaks[BLOCK_SIZE], gains[BLOCK_SIZE];
+    inline float get_rdelta(float _att);
+    void process_block(float *left, float *right, const float *multi_coeff, int len);
+public:
     void reset();
     void reset_asc();
     bool get_asc();
     lookahead_limiter();
-    void set_multi(bool set);
-    void process(float &left, float &right, float *multi_buffer);
+    ~lookahead_limiter();
+    /// Limit a block of samples in place (delayed by the lookahead time).
+    /// multi_coeff - optional per sample coefficient of the limit (used by
+    /// the multiband limiter), may be NULL
+    void process(float *left, float *right, const float *multi_coeff, uint32_t len);
     void set_sample_rate(uint32_t sr);
     void set_params(float l, float a, float r, float weight = 1.f, bool ar = false, float arc = 1.f, bool d = false);
     float get_attenuation();
@@ -179,6 +179,39 @@ public:
         b1 =  (Coeff)(-2*cs*inv);
         b2 =  (Coeff)((1 - alpha)*inv);
     }
+
+    /** rbj's allpass (unity gain everywhere, -180 degrees at fc)
+     * @param fc     frequency of the -180 degrees point
+     * @param q      steepness of the phase transition
+     * @param sr     sample rate
+     */
+    inline void set_ap_rbj(double fc, double q, double esr)
+    {
+        float omega=(float)(2*M_PI*fc/esr);
+        float sn=sin(omega);
+        float cs=cos(omega);
+        float alpha=(float)(sn/(2*q));
+
+        float inv=(float)(1.0/(1.0+alpha));
+
+        a0 =  (Coeff)((1 - alpha)*inv);
+        a1 =  (Coeff)(-2*cs*inv);
+        a2 =  (Coeff)1.0;
+        b1 =  (Coeff)(-2*cs*inv);
+        b2 =  (Coeff)((1 - alpha)*inv);
+    }
+
+    /// First order allpass (-90 degrees at fc), bilinear transform of (1 - s) / (1 + s)
+    inline void set_ap_1st(double fc, double esr)
+    {
+        float k = (float)tan(M_PI * fc / esr);
+        float c = (k - 1) / (k + 1);
+        a0 = (Coeff)c;
+        a1 = (Coeff)1.0;
+        a2 = (Coeff)0.0;
+        b1 = (Coeff)c;
+        b2 = (Coeff)0.0;
+    }
     // this is mine (and, I guess, it sucks/doesn't work)
     void set_allpass(float freq, float pole_r, float sr)
     {
@@ -427,12 +460,16 @@ struct biquad_d2: public biquad_coeffs<Coeff>
         reset();
     }
     /// direct II form with two state variables
+    /// On SSE builds, denormals are flushed by the denormal_guard set up in
+    /// process_slice, so the per-sample sanitizing is only needed elsewhere.
     inline T process(T in)
     {
+#ifndef __SSE__
         dsp::sanitize_denormal(in);
         dsp::sanitize(in);
         dsp::sanitize(w1);
         dsp::sanitize(w2);
+#endif
 
         T tmp = in - w1 * b1 - w2 * b2;
         T out = tmp * a0 + w1 * a1 + w2 * a2;
@@ -441,6 +478,24 @@ struct biquad_d2: public biquad_coeffs<Coeff>
         return out;
     }
     
+    /// direct II form over a block of samples (in and out may be the same buffer)
+    /// The state is only sanitized once, at the end of the block.
+    inline void process_block(const T *in, T *out, uint32_t numsamples)
+    {
+        Coeff ca0 = a0, ca1 = a1, ca2 = a2, cb1 = b1, cb2 = b2;
+        T s1 = w1, s2 = w2;
+        for (uint32_t i = 0; i < numsamples; i++)
+        {
+            T tmp = in[i] - s1 * cb1 - s2 * cb2;
+            out[i] = tmp * ca0 + s1 * ca1 + s2 * ca2;
+            s2 = s1;
+            s1 = tmp;
+        }
+        w1 = s1;
+        w2 = s2;
+        sanitize();
+    }
+    
     // direct II form with two state variables, lowpass version
     // interesting fact: this is actually slower than the general version!
     inline T process_lp(T in)
@@ -473,6 +528,335 @@ struct biquad_d2: public biquad_coeffs<Coeff>
     }
 };
 
+/**
+ * A set of independent Direct II biquads evaluated side by side, one lane
+ * per channel (or per parallel section). Every lane has its own coefficients
+ * and state; the lanes are stored contiguously, so a single sample step for
+ * all lanes is done with SSE four lanes at a time where available.
+ * Use it for L/R pairs or for N filters running in parallel on different
+ * signals - serial cascades have nothing to gain from it.
+ */
+template<int Lanes>
+struct biquad_d2_multi
+{
+    enum { lanes = Lanes };
+    float a0[Lanes], a1[Lanes], a2[Lanes], b1[Lanes], b2[Lanes];
+    /// state[n-1]
+    float w1[Lanes];
+    /// state[n-2]
+    float w2[Lanes];
+    
+    biquad_d2_multi()
+    {
+        for (int i = 0; i < Lanes; i++)
+            set_coeffs(i, biquad_coeffs<float>());
+        reset();
+    }
+    /// set coefficients of a single lane
+    template<class U>
+    inline void set_coeffs(int lane, const biquad_coeffs<U> &src)
+    {
+        a0[lane] = src.a0;
+        a1[lane] = src.a1;
+        a2[lane] = src.a2;
+        b1[lane] = src.b1;
+        b2[lane] = src.b2;
+    }
+    /// set the same coefficients for all lanes
+    template<class U>
+    inline void copy_coeffs(const biquad_coeffs<U> &src)
+    {
+        for (int i = 0; i < Lanes; i++)
+            set_coeffs(i, src);
+    }
+    /// process one sample of every lane, in place (frame[i] is the sample for lane i)
+    inline void process_frame(float *frame)
+    {
+        int i = 0;
+#ifdef __SSE__
+        for (; i + 4 <= Lanes; i += 4)
+        {
+            __m128 s1 = _mm_loadu_ps(w1 + i), s2 = _mm_loadu_ps(w2 + i);
+            __m128 tmp = _mm_sub_ps(_mm_loadu_ps(frame + i), _mm_add_ps(_mm_mul_ps(s1, _mm_loadu_ps(b1 + i)), _mm_mul_ps(s2, _mm_loadu_ps(b2 + i))));
+            __m128 out = _mm_add_ps(_mm_mul_ps(tmp, _mm_loadu_ps(a0 + i)), _mm_add_ps(_mm_mul_ps(s1, _mm_loadu_ps(a1 + i)), _mm_mul_ps(s2, _mm_loadu_ps(a2 + i))));
+            _mm_storeu_ps(w2 + i, s1);
+            _mm_storeu_ps(w1 + i, tmp);
+            _mm_storeu_ps(frame + i, out);
+        }
+#endif
+        for (; i < Lanes; i++)
+        {
+            float tmp = frame[i] - w1[i] * b1[i] - w2[i] * b2[i];
+            frame[i] = tmp * a0[i] + w1[i] * a1[i] + w2[i] * a2[i];
+            w2[i] = w1[i];
+            w1[i] = tmp;
+        }
+    }
+    /// process a block of samples, lane i reads ins[i] and writes outs[i] (may be the same buffers)
+    inline void process_block(const float *const *ins, float *const *outs, uint32_t numsamples)
+    {
+#ifdef __SSE__
+        // groups of four lanes keep their coefficients and state in registers
+        // for the whole block instead of going through memory every sample
+        if (!(Lanes & 3))
+        {
+            for (int i = 0; i < Lanes; i += 4)
+            {
+                const float *in0 = ins[i], *in1 = ins[i + 1], *in2 = ins[i + 2], *in3 = ins[i + 3];
+                float *out0 = outs[i], *out1 = outs[i + 1], *out2 = outs[i + 2], *out3 = outs[i + 3];
+                __m128 ca0 = _mm_loadu_ps(a0 + i), ca1 = _mm_loadu_ps(a1 + i), ca2 = _mm_loadu_ps(a2 + i);
+                __m128 cb1 = _mm_loadu_ps(b1 + i), cb2 = _mm_loadu_ps(b2 + i);
+                __m128 s1 = _mm_loadu_ps(w1 + i), s2 = _mm_loadu_ps(w2 + i);
+                for (uint32_t n = 0; n < numsamples; n++)
+                {
+                    __m128 tmp = _mm_sub_ps(_mm_setr_ps(in0[n], in1[n], in2[n], in3[n]), _mm_add_ps(_mm_mul_ps(s1, cb1), _mm_mul_ps(s2, cb2)));
+                    __m128 out = _mm_add_ps(_mm_mul_ps(tmp, ca0), _mm_add_ps(_mm_mul_ps(s1, ca1), _mm_mul_ps(s2, ca2)));
+                    s2 = s1;
+                    s1 = tmp;
+                    out0[n] = _mm_cvtss_f32(out);
+                    out1[n] = _mm_cvtss_f32(_mm_shuffle_ps(out, out, _MM_SHUFFLE(1, 1, 1, 1)));
+                    out2[n] = _mm_cvtss_f32(_mm_shuffle_ps(out, out, _MM_SHUFFLE(2, 2, 2, 2)));
+                    out3[n] = _mm_cvtss_f32(_mm_shuffle_ps(out, out, _MM_SHUFFLE(3, 3, 3, 3)));
+                }
+                _mm_storeu_ps(w1 + i, s1);
+                _mm_storeu_ps(w2 + i, s2);
+            }
+            sanitize();
+            return;
+        }
+#endif
+        // lanes one after another, without gathering every sample into a frame
+        for (int i = 0; i < Lanes; i++)
+            process_lane(i, ins[i], outs[i], numsamples);
+        sanitize();
+    }
+    /// process a block through Count sets of lanes in series (sec[0] reads ins, every
+    /// following one the output of the previous one). All of them are done in a single
+    /// pass, so that the recursions of the different sections can overlap.
+    template<int Count>
+    static inline void process_cascade(biquad_d2_multi *sec, const float *const *ins, float *const *outs, uint32_t numsamples)
+    {
+#ifdef __SSE__
+        if (!(Lanes & 3))
+        {
+            for (int i = 0; i < Lanes; i += 4)
+            {
+                const float *in0 = ins[i], *in1 = ins[i + 1], *in2 = ins[i + 2], *in3 = ins[i + 3];
+                float *out0 = outs[i], *out1 = outs[i + 1], *out2 = outs[i + 2], *out3 = outs[i + 3];
+                __m128 ca0[Count], ca1[Count], ca2[Count], cb1[Count], cb2[Count], s1[Count], s2[Count];
+                for (int k = 0; k < Count; k++)
+                {
+                    ca0[k] = _mm_loadu_ps(sec[k].a0 + i);
+                    ca1[k] = _mm_loadu_ps(sec[k].a1 + i);
+                    ca2[k] = _mm_loadu_ps(sec[k].a2 + i);
+                    cb1[k] = _mm_loadu_ps(sec[k].b1 + i);
+                    cb2[k] = _mm_loadu_ps(sec[k].b2 + i);
+                    s1[k] = _mm_loadu_ps(sec[k].w1 + i);
+                    s2[k] = _mm_loadu_ps(sec[k].w2 + i);
+                }
+                for (uint32_t n = 0; n < numsamples; n++)
+                {
+                    __m128 x = _mm_setr_ps(in0[n], in1[n], in2[n], in3[n]);
+                    for (int k = 0; k < Count; k++)
+                    {
+                        __m128 tmp = _mm_sub_ps(x, _mm_add_ps(_mm_mul_ps(s1[k], cb1[k]), _mm_mul_ps(s2[k], cb2[k])));
+                        x = _mm_add_ps(_mm_mul_ps(tmp, ca0[k]), _mm_add_ps(_mm_mul_ps(s1[k], ca1[k]), _mm_mul_ps(s2[k], ca2[k])));
+                        s2[k] = s1[k];
+                        s1[k] = tmp;
+                    }
+                    out0[n] = _mm_cvtss_f32(x);
+                    out1[n] = _mm_cvtss_f32(_mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1)));
+                    out2[n] = _mm_cvtss_f32(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 2, 2)));
+                    out3[n] = _mm_cvtss_f32(_mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3)));
+                }
+                for (int k = 0; k < Count; k++)
+                {
+                    _mm_storeu_ps(sec[k].w1 + i, s1[k]);
+                    _mm_storeu_ps(sec[k].w2 + i, s2[k]);
+                }
+            }
+            for (int k = 0; k < Count; k++)
+                sec[k].sanitize();
+            return;
+        }
+#endif
+        sec[0].process_block(ins, outs, numsamples);
+        for (int k = 1; k < Count; k++)
+            sec[k].process_block(outs, outs, numsamples);
+    }
+    /// process the same input through every lane (parallel sections), lane i writes outs[i]
+    /// (only outs[0] may be the input buffer)
+    inline void process_block_split(const float *in, float *const *outs, uint32_t numsamples)
+    {
+        for (int i = Lanes - 1; i >= 0; i--)
+            process_lane(i, in, outs[i], numsamples);
+        sanitize();
+    }
+    /// process a block of samples through a single lane (in and out may be the same buffer)
+    inline void process_lane(int lane, const float *in, float *out, uint32_t numsamples)
+    {
+        float ca0 = a0[lane], ca1 = a1[lane], ca2 = a2[lane], cb1 = b1[lane], cb2 = b2[lane];
+        float s1 = w1[lane], s2 = w2[lane];
+        for (uint32_t n = 0; n < numsamples; n++)
+        {
+            float tmp = in[n] - s1 * cb1 - s2 * cb2;
+            out[n] = tmp * ca0 + s1 * ca1 + s2 * ca2;
+            s2 = s1;
+            s1 = tmp;
+        }
+        w1[lane] = s1;
+        w2[lane] = s2;
+    }
+    /// Sanitize (set to 0 if potentially denormal) filter state
+    inline void sanitize()
+    {
+        for (int i = 0; i < Lanes; i++)
+        {
+            dsp::sanitize(w1[i]);
+            dsp::sanitize(w2[i]);
+        }
+    }
+    /// Reset state variables
+    inline void reset()
+    {
+        for (int i = 0; i < Lanes; i++)
+        {
+            dsp::zero(w1[i]);
+            dsp::zero(w2[i]);
+        }
+    }
+    /// Is the state of every lane completely silent?
+    inline bool empty() const
+    {
+        for (int i = 0; i < Lanes; i++)
+            if (w1[i] != 0.f || w2[i] != 0.f)
+                return false;
+        return true;
+    }
+};
+
+/**
+ * Serial chain of Direct II biquad sections, for Channels channels sharing
+ * the same coefficients. Every section has a fixed slot number (its
+ * coefficients and per-channel state live there), but only the slots that
+ * were put into the chain with add_to_chain() are processed, packed in the
+ * order they were added. That way, switched off sections cost nothing and
+ * keep their state until they're switched on again.
+ * The chain is meant to be rebuilt when parameters change, not per sample.
+ */
+template<int MaxSections, int Channels = 2>
+class biquad_d2_cascade
+{
+    struct section
+    {
+        float a0, a1, a2, b1, b2;
+        int slot;
+    };
+    /// coefficients, by slot
+    biquad_coeffs<float> coeffs[MaxSections];
+    /// state[n-1], by slot
+    float w1[MaxSections][Channels];
+    /// state[n-2], by slot
+    float w2[MaxSections][Channels];
+    /// sections to process, in order
+    section chain[MaxSections];
+    int chain_length;
+public:
+    biquad_d2_cascade()
+    {
+        chain_length = 0;
+        reset();
+    }
+    /// set coefficients of a slot (also updates the chain if the slot is in it)
+    template<class U>
+    void set_coeffs(int slot, const biquad_coeffs<U> &src)
+    {
+        coeffs[slot].copy_coeffs(src);
+        for (int i = 0; i < chain_length; i++)
+            if (chain[i].slot == slot)
+                pack(chain[i], slot);
+    }
+    const biquad_coeffs<float> &get_coeffs(int slot) const
+    {
+        return coeffs[slot];
+    }
+    /// remove all sections from the chain (the state of the slots is kept)
+    void clear_chain()
+    {
+        chain_length = 0;
+    }
+    /// append a slot to the end of the chain
+    void add_to_chain(int slot)
+    {
+        assert(chain_length < MaxSections);
+        pack(chain[chain_length++], slot);
+    }
+    /// number of sections actually processed
+    int get_chain_length() const
+    {
+        return chain_length;
+    }
+    /// run the chain in place over a block of samples, one buffer per channel
+    void process_block(float *const *bufs, uint32_t numsamples)
+    {
+        for (int k = 0; k < chain_length; k++)
+        {
+            const section &sec = chain[k];
+            float *s1 = w1[sec.slot], *s2 = w2[sec.slot];
+            float v1[Channels], v2[Channels];
+            float *buf[Channels];
+            for (int c = 0; c < Channels; c++)
+            {
+                v1[c] = s1[c];
+                v2[c] = s2[c];
+                buf[c] = bufs[c];
+            }
+            // the channels are independent, so they run interleaved within
+            // a single pass over the block
+            for (uint32_t i = 0; i < numsamples; i++)
+            {
+                for (int c = 0; c < Channels; c++)
+                {
+                    float tmp = buf[c][i] - v1[c] * sec.b1 - v2[c] * sec.b2;
+                    buf[c][i] = tmp * sec.a0 + v1[c] * sec.a1 + v2[c] * sec.a2;
+                    v2[c] = v1[c];
+                    v1[c] = tmp;
+                }
+            }
+            for (int c = 0; c < Channels; c++)
+            {
+                s1[c] = v1[c];
+                s2[c] = v2[c];
+                dsp::sanitize(s1[c]);
+                dsp::sanitize(s2[c]);
+            }
+        }
+    }
+    /// Reset state variables of all slots
+    void reset()
+    {
+        for (int i = 0; i < MaxSections; i++)
+        {
+            for (int c = 0; c < Channels; c++)
+            {
+                dsp::zero(w1[i][c]);
+                dsp::zero(w2[i][c]);
+            }
+        }
+    }
+private:
+    inline void pack(section &sec, int slot)
+    {
+        const biquad_coeffs<float> &src = coeffs[slot];
+        sec.a0 = src.a0;
+        sec.a1 = src.a1;
+        sec.a2 = src.a2;
+        sec.b1 = src.b1;
+        sec.b2 = src.b2;
+        sec.slot = slot;
+    }
+};
+
 /**
  * Two-pole two-zero filter, for floating point values.
  * Uses "traditional" Direct I form (separate FIR and IIR halves).
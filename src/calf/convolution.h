@@ -0,0 +1,226 @@
+/* Calf DSP Library
+ * Partitioned convolution engine and impulse response loading.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman, Markus Schmidt and others
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef CALF_CONVOLUTION_H
+#define CALF_CONVOLUTION_H
+
+#include <assert.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "fft.h"
+
+namespace dsp {
+
+/// Read-only WAV file (PCM 8/16/24/32 bit or 32 bit float), mapped into memory
+/// instead of being read in one go, so that only the parts actually being
+/// converted have to be paged in.
+class wave_file
+{
+    void *map;
+    size_t map_size;
+    const uint8_t *samples;
+    int format, bits, channels, rate;
+    uint32_t frames;
+public:
+    wave_file();
+    ~wave_file();
+    /// Map and parse the file, returns false and sets error on failure
+    bool open(const char *name, std::string &error);
+    void close();
+    int get_channels() const { return channels; }
+    int get_rate() const { return rate; }
+    uint32_t get_frames() const { return frames; }
+    /// Convert count frames of channel ch (clipped to the available channels),
+    /// starting at frame start * ratio and stepping by ratio (linear
+    /// interpolation, ratio = file rate / wanted rate). Zero past the end.
+    void read(int ch, uint32_t start, uint32_t count, float *out, double ratio = 1.0) const;
+private:
+    float frame(int ch, uint32_t pos) const;
+};
+
+/**
+ * Uniformly partitioned overlap-save convolution with a frequency domain delay
+ * line. The filter is split into partitions of half the FFT size; every
+ * call takes the last two blocks of input (one FFT worth) and returns the
+ * output for the newer block.
+ */
+template<int O>
+class partitioned_convolution
+{
+public:
+    enum { SIZE = 1 << O, BLOCK = SIZE / 2, BINS = BLOCK + 1 };
+private:
+    typedef std::complex<float> complex;
+    fft<float, O> transform;
+    int partitions, fdl_pos;
+    /// spectra of the partitions and of the recent inputs, real and imaginary parts split
+    std::vector<float> filter_re, filter_im, fdl_re, fdl_im;
+    complex spectrum[SIZE];
+    float acc_re[BINS], acc_im[BINS], output[SIZE];
+public:
+    partitioned_convolution() : partitions(0), fdl_pos(0) {}
+    int get_partitions() const { return partitions; }
+    /// Set the filter of length samples, read one partition at a time by
+    /// calling read(start, count, out)
+    template<class Reader>
+    void set_filter(Reader &read, uint32_t length)
+    {
+        partitions = (length + BLOCK - 1) / BLOCK;
+        filter_re.assign(partitions * BINS, 0.f);
+        filter_im.assign(partitions * BINS, 0.f);
+        fdl_re.assign(partitions * BINS, 0.f);
+        fdl_im.assign(partitions * BINS, 0.f);
+        fdl_pos = 0;
+        float block[SIZE];
+        for (int p = 0; p < partitions; p++) {
+            read(p * BLOCK, BLOCK, block);
+            for (int i = BLOCK; i < SIZE; i++)
+                block[i] = 0.f;
+            transform.calculate_real(block, spectrum);
+            for (int k = 0; k < BINS; k++) {
+                filter_re[p * BINS + k] = spectrum[k].real();
+                filter_im[p * BINS + k] = spectrum[k].imag();
+            }
+        }
+    }
+    void reset()
+    {
+        std::fill(fdl_re.begin(), fdl_re.end(), 0.f);
+        std::fill(fdl_im.begin(), fdl_im.end(), 0.f);
+    }
+    /// Convolve, input = the last SIZE input samples, out = BLOCK samples of output
+    /// (for the newer half of the input)
+    void process(const float *input, float *out)
+    {
+        if (!partitions) {
+            for (int i = 0; i < BLOCK; i++)
+                out[i] = 0.f;
+            return;
+        }
+        transform.calculate_real(input, spectrum);
+        fdl_pos = fdl_pos ? fdl_pos - 1 : partitions - 1;
+        float *xr = &fdl_re[fdl_pos * BINS], *xi = &fdl_im[fdl_pos * BINS];
+        for (int k = 0; k < BINS; k++) {
+            xr[k] = spectrum[k].real();
+            xi[k] = spectrum[k].imag();
+            acc_re[k] = acc_im[k] = 0.f;
+        }
+        // the FDL is a ring, newest spectrum at fdl_pos: partition p meets the
+        // input from p blocks ago
+        for (int p = 0; p < partitions; p++) {
+            int x = fdl_pos + p;
+            if (x >= partitions)
+                x -= partitions;
+            mac(&fdl_re[x * BINS], &fdl_im[x * BINS], &filter_re[p * BINS], &filter_im[p * BINS]);
+        }
+        for (int k = 0; k < BINS; k++)
+            spectrum[k] = complex(acc_re[k], acc_im[k]);
+        for (int k = 1; k < BLOCK; k++)
+            spectrum[SIZE - k] = conj(spectrum[k]);
+        transform.calculate_real_inverse(spectrum, output);
+        // the first half is circular convolution garbage
+        for (int i = 0; i < BLOCK; i++)
+            out[i] = output[BLOCK + i];
+    }
+private:
+    inline void mac(const float *xr, const float *xi, const float *hr, const float *hi)
+    {
+        for (int k = 0; k < BINS; k++) {
+            acc_re[k] += xr[k] * hr[k] - xi[k] * hi[k];
+            acc_im[k] += xr[k] * hi[k] + xi[k] * hr[k];
+        }
+    }
+};
+
+/**
+ * Stereo convolution with an impulse response of any length, without
+ * latency. The response is split into three segments:
+ * - the first HEAD_BLOCK taps, applied directly (time domain FIR)
+ * - up to TAIL_START, a partitioned convolution with HEAD_BLOCK sized
+ *   partitions, computed in the audio thread every HEAD_BLOCK samples
+ * - the rest, a partitioned convolution with TAIL_BLOCK sized partitions,
+ *   computed in a worker thread. Its output is needed one TAIL_BLOCK after
+ *   the input block is complete, which is the time the worker has.
+ * The engine is built (and the response transformed) outside of the audio
+ * thread; the audio thread only calls process.
+ */
+class convolution_engine
+{
+public:
+    enum {
+        HEAD_ORDER = 7, HEAD_BLOCK = 1 << (HEAD_ORDER - 1),
+        TAIL_ORDER = 11, TAIL_BLOCK = 1 << (TAIL_ORDER - 1),
+        TAIL_START = 2 * TAIL_BLOCK,
+    };
+private:
+    struct channel
+    {
+        float fir[HEAD_BLOCK];
+        /// previous and current head block of input
+        float head_in[2 * HEAD_BLOCK];
+        /// head partitions' output for the current head block
+        float head_out[HEAD_BLOCK];
+        partitioned_convolution<HEAD_ORDER> head;
+        /// input of the last two tail blocks, ring of three so that the worker
+        /// can read two while the audio thread writes the third
+        float tail_in[3][TAIL_BLOCK];
+        /// tail output, one block being played, one being computed
+        float tail_out[2][TAIL_BLOCK];
+        partitioned_convolution<TAIL_ORDER> tail;
+    };
+    channel ch[2];
+    uint32_t length;
+    bool has_tail;
+    int head_fill, tail_fill;
+    /// number of the tail block being filled by the audio thread
+    uint32_t tail_block;
+    /// false if the tail output for the current block isn't there (worker late)
+    bool tail_valid;
+    /// tail blocks submitted to / finished by the worker
+    volatile uint32_t tail_submitted, tail_done;
+    volatile bool running;
+    bool thread_started, sched_copied;
+    volatile uint32_t late_count;
+    pthread_t thread;
+    sem_t job_sem;
+
+    static void *thread_func(void *arg);
+    void compute_tail(uint32_t block);
+    void submit_tail();
+public:
+    /// Transform the response of the file (channel 0 for left, 1 for right if
+    /// the file has it), resampled to srate, up to max_length samples
+    convolution_engine(const wave_file &ir, uint32_t srate, uint32_t max_length);
+    ~convolution_engine();
+    uint32_t get_length() const { return length; }
+    /// Number of tail blocks the worker didn't deliver in time
+    uint32_t get_late_count() const { return late_count; }
+    /// Clear the history, after waiting for the worker to finish the tail block it is on
+    void reset();
+    /// Process len samples (outputs may be the same buffers as the inputs)
+    void process(const float *in_left, const float *in_right, float *out_left, float *out_right, uint32_t len);
+};
+
+};
+
+#endif
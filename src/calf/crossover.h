@@ -0,0 +1,219 @@
+/* Calf DSP Library
+ * Linkwitz-Riley crossover network for the multiband modules.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman, Markus Schmidt and others
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef CALF_CROSSOVER_H
+#define CALF_CROSSOVER_H
+
+#include <string.h>
+#include "biquad.h"
+
+namespace dsp {
+
+/**
+ * Stereo Linkwitz-Riley crossover network splitting the signal into Bands
+ * bands. The splits are done one after another, lowest frequency first: the
+ * lowpass output of a split is a band, the highpass output is split further.
+ * Every band split off early also goes through the allpass equivalent of each
+ * later split, so that all the bands add up to an allpass filtered copy of
+ * the input, ie. the sum has a flat magnitude response.
+ *
+ * Lowpass and highpass of a split run as the four lanes (left/right times
+ * lowpass/highpass) of a single biquad_d2_multi. Coefficients are only
+ * computed when a split frequency, the mode or the sample rate changes.
+ */
+template<int Bands>
+class crossover
+{
+public:
+    enum { splits = Bands - 1, MAX_STAGES = 4, BLOCK_SIZE = 256 };
+    /// The first two keep the indices (and slopes) of the old 12dB and 36dB
+    /// modes, so that saved settings still load with the same slopes
+    enum mode_type {
+        LR2, ///< 12dB/oct, highpass inverted
+        LR6, ///< 36dB/oct, highpass inverted
+        LR4, ///< 24dB/oct
+        LR8, ///< 48dB/oct
+    };
+private:
+    enum { ap_lanes = Bands > 2 ? 2 * (Bands - 2) : 2 };
+    /// lanes 0/1 - lowpass left/right, lanes 2/3 - highpass left/right
+    biquad_d2_multi<4> xo[splits][MAX_STAGES];
+    /// allpass compensation of split s for the bands below it, lanes 2b/2b+1 - band b left/right
+    biquad_d2_multi<ap_lanes> ap[splits][MAX_STAGES / 2];
+    /// coefficients of the sections, kept for drawing the bands
+    biquad_coeffs<float> lp[splits][MAX_STAGES], hp[splits][MAX_STAGES];
+    float freq[splits];
+    int mode, stages, ap_stages;
+    uint32_t srate;
+    /// in/out of the allpass lanes of bands that don't need them
+    float scratch[BLOCK_SIZE];
+
+    void update(int s)
+    {
+        // Q of the sections of the squared Butterworth filter: 3rd order
+        // Butterworth is a 1st order section (two of them make a Q = 0.5
+        // biquad) and a Q = 1 one, 4th order is two sections used twice
+        static const float q_lr6[3] = { 0.5f, 1.f, 1.f };
+        static const float q_lr8[2] = { 0.54119610f, 1.30656296f };
+        float f = std::min(freq[s], srate * 0.49f);
+        bool invert = mode == LR2 || mode == LR6;
+        for (int k = 0; k < stages; k++) {
+            float q;
+            switch(mode) {
+                case LR2: q = 0.5f; break;
+                case LR6: q = q_lr6[k]; break;
+                case LR4: q = (float)M_SQRT1_2; break;
+                default: q = q_lr8[k & 1]; break;
+            }
+            lp[s][k].set_lp_rbj(f, q, (float)srate);
+            hp[s][k].set_hp_rbj(f, q, (float)srate, invert && !k ? -1.f : 1.f);
+            xo[s][k].set_coeffs(0, lp[s][k]);
+            xo[s][k].set_coeffs(1, lp[s][k]);
+            xo[s][k].set_coeffs(2, hp[s][k]);
+            xo[s][k].set_coeffs(3, hp[s][k]);
+        }
+        if (!s)
+            return;
+        for (int k = 0; k < ap_stages; k++) {
+            biquad_coeffs<float> c;
+            if (mode == LR2 || (mode == LR6 && !k))
+                c.set_ap_1st(f, srate);
+            else
+            if (mode == LR6)
+                c.set_ap_rbj(f, 1.0, srate);
+            else
+                c.set_ap_rbj(f, mode == LR4 ? M_SQRT1_2 : q_lr8[k], srate);
+            for (int l = 0; l < 2 * s; l++)
+                ap[s][k].set_coeffs(l, c);
+        }
+    }
+    template<int Lanes>
+    static inline void cascade(biquad_d2_multi<Lanes> *sec, int count, const float *const *ins, float *const *outs, uint32_t len)
+    {
+        switch(count) {
+            case 1: biquad_d2_multi<Lanes>::template process_cascade<1>(sec, ins, outs, len); break;
+            case 2: biquad_d2_multi<Lanes>::template process_cascade<2>(sec, ins, outs, len); break;
+            case 3: biquad_d2_multi<Lanes>::template process_cascade<3>(sec, ins, outs, len); break;
+            case 4: biquad_d2_multi<Lanes>::template process_cascade<4>(sec, ins, outs, len); break;
+        }
+    }
+    void process_chunk(const float *left, const float *right, float *const *outs, uint32_t len)
+    {
+        float *rest[2] = { outs[2 * splits], outs[2 * splits + 1] };
+        if (rest[0] != left)
+            memcpy(rest[0], left, len * sizeof(float));
+        if (rest[1] != right)
+            memcpy(rest[1], right, len * sizeof(float));
+        for (int s = 0; s < splits; s++) {
+            const float *ins[4] = { rest[0], rest[1], rest[0], rest[1] };
+            float *lanes[4] = { outs[2 * s], outs[2 * s + 1], rest[0], rest[1] };
+            cascade(xo[s], stages, ins, lanes, len);
+            if (s) {
+                float *bufs[ap_lanes];
+                for (int l = 0; l < ap_lanes; l++)
+                    bufs[l] = l < 2 * s ? outs[l] : scratch;
+                cascade(ap[s], ap_stages, bufs, bufs, len);
+            }
+        }
+    }
+public:
+    crossover()
+    {
+        mode = -1;
+        stages = ap_stages = 0;
+        srate = 44100;
+        for (int s = 0; s < splits; s++)
+            freq[s] = 1000.f;
+        memset(scratch, 0, sizeof(scratch));
+        set_mode(LR4);
+    }
+    /// Change the slopes (one of mode_type)
+    void set_mode(int m)
+    {
+        if (m == mode)
+            return;
+        mode = m;
+        int old_stages = stages, old_ap_stages = ap_stages;
+        stages = mode == LR2 ? 1 : (mode == LR4 ? 2 : (mode == LR6 ? 3 : 4));
+        ap_stages = mode == LR6 || mode == LR8 ? 2 : 1;
+        for (int s = 0; s < splits; s++) {
+            // sections coming back into use would otherwise resume from whatever they had then
+            for (int k = old_stages; k < stages; k++)
+                xo[s][k].reset();
+            for (int k = old_ap_stages; k < ap_stages; k++)
+                ap[s][k].reset();
+            update(s);
+        }
+    }
+    int get_mode() const { return mode; }
+    /// Change the frequency of split s (between band s and band s + 1)
+    void set_freq(int s, float f)
+    {
+        if (f == freq[s])
+            return;
+        freq[s] = f;
+        update(s);
+    }
+    void set_sample_rate(uint32_t sr)
+    {
+        srate = sr;
+        for (int s = 0; s < splits; s++)
+            update(s);
+    }
+    /// Clear the state of all filters
+    void reset()
+    {
+        for (int s = 0; s < splits; s++) {
+            for (int k = 0; k < MAX_STAGES; k++)
+                xo[s][k].reset();
+            for (int k = 0; k < MAX_STAGES / 2; k++)
+                ap[s][k].reset();
+        }
+    }
+    /// Split len samples of left/right into outs[2 * band] (left) and
+    /// outs[2 * band + 1] (right). The input may be the same buffers as the
+    /// ones of the last band, but not of any other band.
+    void process(const float *left, const float *right, float *const *outs, uint32_t len)
+    {
+        float *o[2 * Bands];
+        for (uint32_t done = 0; done < len; done += BLOCK_SIZE) {
+            for (int i = 0; i < 2 * Bands; i++)
+                o[i] = outs[i] + done;
+            process_chunk(left + done, right + done, o, std::min<uint32_t>(len - done, BLOCK_SIZE));
+        }
+    }
+    /// Magnitude response of a band (the allpass compensation doesn't change it)
+    float freq_gain(int band, float f) const
+    {
+        float ret = 1.f;
+        for (int k = 0; k < stages; k++) {
+            if (band > 0)
+                for (int s = 0; s < band; s++)
+                    ret *= hp[s][k].freq_gain(f, (float)srate);
+            if (band < splits)
+                ret *= lp[band][k].freq_gain(f, (float)srate);
+        }
+        return ret;
+    }
+};
+
+};
+
+#endif
@@ -26,9 +26,13 @@
 
 namespace dsp {
 
-/// FFT routine copied from my old OneSignal library, modified to 
-/// match Calf's style. It's not fast at all, just a straightforward
-/// implementation.
+/// Radix-4 FFT (with a single radix-2 pass for odd orders), using a cached
+/// table of twiddle factors and a precomputed bit reversal permutation.
+/// Besides the complex transform, it does real-input forward and
+/// real-output inverse transforms through a half-size complex FFT, which
+/// is what the bandlimiting code needs most of the time.
+/// Note that the sign convention is e^(+jwt) for the forward transform
+/// (and e^(-jwt) for the inverse one), as in the original OneSignal code.
 template<class T, int O>
 class fft
 {
@@ -59,10 +63,10 @@ public:
             sines[i + 2 * N90] = -(sines[i] = complex(c, s));
         }
     }
+    /// Complex transform of 2^O points (input and output must not overlap)
     void calculate(complex *input, complex *output, bool inverse)
     {
         int N=1<<O;
-        int N1=N-1;
         int i;
         // Scramble the input data
         if (inverse)
@@ -78,25 +82,8 @@ public:
             for (i=0; i<N; i++)
                 output[i]=input[scramble[i]];
 
-        // O butterfiles
-        for (i=0; i<O; i++)
-        {
-            int PO=1<<i, PNO=1<<(O-i-1);
-            int j,k;
-            for (j=0; j<PNO; j++)
-            {
-                int base=j<<(i+1);
-                for (k=0; k<PO; k++)
-                {
-                    int B1=base+k;
-                    int B2=base+k+(1<<i);
-                    complex r1=output[B1];
-                    complex r2=output[B2];
-                    output[B1]=r1+r2*sines[(B1<<(O-i-1))&N1];
-                    output[B2]=r1+r2*sines[(B2<<(O-i-1))&N1];
-                }
-            }
-        }
+        butterflies(output, O);
+        
         if (inverse)
         {
             for (i=0; i<N; i++)
@@ -106,6 +93,107 @@ public:
             }
         }
     }
+    /// Forward transform of 2^O real values, output is the complete
+    /// (conjugate-symmetric) spectrum of 2^O complex values
+    void calculate_real(const T *input, complex *output)
+    {
+        int N=1<<O, M=N>>1;
+        // even samples go to real, odd samples to imaginary parts of a half-size transform
+        for (int i=0; i<M; i++)
+        {
+            int s=scramble[i]>>1;
+            output[i]=complex(input[2*s],input[2*s+1]);
+        }
+        butterflies(output, O-1);
+        
+        // split the half-size spectrum into the spectra of even and odd samples and combine them
+        complex z0=output[0];
+        output[0]=complex(z0.real()+z0.imag(),0);
+        output[M]=complex(z0.real()-z0.imag(),0);
+        for (int k=1; k<=M/2; k++)
+        {
+            complex zk=output[k], zmk=conj(output[M-k]);
+            complex e=(zk+zmk)*T(0.5);
+            complex o=(zk-zmk)*complex(0,-0.5);
+            complex wo=sines[k]*o;
+            output[k]=e+wo;
+            output[M-k]=conj(e-wo);
+        }
+        for (int k=1; k<M; k++)
+            output[N-k]=conj(output[k]);
+    }
+    /// Inverse transform of a spectrum of 2^O complex values into 2^O real values.
+    /// The result is the real part of what the complex inverse transform would
+    /// return, so the spectrum doesn't need to be perfectly conjugate-symmetric.
+    void calculate_real_inverse(const complex *input, T *output)
+    {
+        int N=1<<O, M=N>>1;
+        T mf=T(0.5)/N;
+        // the output buffer is used as M complex values (even samples in real, odd in imaginary parts)
+        complex *data=reinterpret_cast<complex *>(output);
+        for (int i=0; i<M; i++)
+        {
+            int k=scramble[i]>>1;
+            // conjugate-symmetric parts of X[k] and X[k+M]
+            complex h1=input[k]+conj(input[(N-k)&(N-1)]);
+            complex h2=input[k+M]+conj(input[M-k]);
+            complex e=h1+h2;
+            complex o=(h1-h2)*conj(sines[k]);
+            complex z=e+complex(-o.imag(),o.real());
+            data[i]=mf*complex(z.imag(),z.real());
+        }
+        butterflies(data, O-1);
+        for (int i=0; i<M; i++)
+        {
+            const complex &c=data[i];
+            data[i]=complex(c.imag(),c.real());
+        }
+    }
+private:
+    /// In-place transform of 2^order points already in bit-reversed order.
+    /// Radix-4 passes, preceded by one radix-2 pass if the order is odd.
+    void butterflies(complex *data, int order) const
+    {
+        int N=1<<order;
+        // twiddle factor stride for 2^order point transform
+        int stride=1<<(O-order);
+        int q=1;
+        if (order&1)
+        {
+            for (int i=0; i<N; i+=2)
+            {
+                complex a=data[i], b=data[i+1];
+                data[i]=a+b;
+                data[i+1]=a-b;
+            }
+            q=2;
+        }
+        for (; q<N; q<<=2)
+        {
+            // combining 4 transforms of q points into transforms of 4q points
+            int tstep=stride*(N/(4*q));
+            for (int base=0; base<N; base+=4*q)
+            {
+                complex *d0=data+base, *d1=d0+q, *d2=d1+q, *d3=d2+q;
+                for (int k=0; k<q; k++)
+                {
+                    const complex &w1=sines[k*tstep], &w2=sines[2*k*tstep], &w3=sines[3*k*tstep];
+                    T ar=d0[k].real(), ai=d0[k].imag();
+                    // b, c and d multiplied by their twiddle factors
+                    T br=d1[k].real()*w2.real()-d1[k].imag()*w2.imag(), bi=d1[k].real()*w2.imag()+d1[k].imag()*w2.real();
+                    T cr=d2[k].real()*w1.real()-d2[k].imag()*w1.imag(), ci=d2[k].real()*w1.imag()+d2[k].imag()*w1.real();
+                    T dr=d3[k].real()*w3.real()-d3[k].imag()*w3.imag(), di=d3[k].real()*w3.imag()+d3[k].imag()*w3.real();
+                    T s0r=ar+br, s0i=ai+bi, s1r=ar-br, s1i=ai-bi;
+                    T s2r=cr+dr, s2i=ci+di, s3r=cr-dr, s3i=ci-di;
+                    d0[k]=complex(s0r+s2r, s0i+s2i);
+                    d2[k]=complex(s0r-s2r, s0i-s2i);
+                    // s1 +/- j*s3
+                    d1[k]=complex(s1r-s3i, s1i+s3r);
+                    d3[k]=complex(s1r+s3i, s1i-s3r);
+                }
+            }
+        }
+    }
 };
 
 };
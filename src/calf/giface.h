@@ -539,6 +539,8 @@ public:
     /// utility function: call process, and if it returned zeros in output masks, zero out the relevant output port buffers
     uint32_t process_slice(uint32_t offset, uint32_t end)
     {
+        // denormals are flushed by the FPU for the whole slice instead of being sanitized per sample
+        dsp::denormal_guard guard;
         uint32_t total_out_mask = 0;
         while(offset < end)
         {
@@ -558,21 +560,210 @@ public:
 
 #if USE_EXEC_GUI || USE_DSSI
 
-enum line_graph_item
+/// Items of a packed line graph frame, sent to an out-of-process GUI either as
+/// the blob of a /lineGraphPacked message or through a line_graph_shm segment.
+/// A frame is: varint frame number, varint base frame number (0 for a key frame,
+/// otherwise the frame the receiver must have applied last), then for every
+/// graph the varint parameter index + 1 followed by its items and LGP_END.
+/// A varint 0 in place of the parameter index ends the frame.
+enum line_graph_packed_item
 {
-    LGI_END = 0,
-    LGI_GRAPH,
-    LGI_SUBGRAPH,
-    LGI_LEGEND,
-    LGI_DOT,
-    LGI_END_ITEM,
-    LGI_SET_RGBA,
-    LGI_SET_WIDTH,
+    LGP_END = 0,
+    /// The next subgraph is the same as in the base frame
+    LGP_KEEP_SUBGRAPH,
+    /// The next subgraph: cairo params, varint mode, then LINE_GRAPH_POINTS
+    /// values, see line_graph_curve_codec
+    LGP_SUBGRAPH,
+    /// All the dots: varint count, then cairo params, x, y and varint size per dot;
+    /// dots are the same as in the base frame if the item isn't there
+    LGP_DOTS,
+    /// All the gridlines: varint count, then cairo params, pos, varint vertical
+    /// and the legend per gridline; same as in the base frame if the item isn't there
+    LGP_GRIDLINES,
+};
+
+enum { LINE_GRAPH_POINTS = 128 };
+
+/// Attributes set through cairo_iface for a single graph item
+struct cairo_params
+{
+    enum { HAS_COLOR = 1, HAS_WIDTH = 2 };
+    uint32_t flags;
+    float r, g, b, a;
+    float line_width;
+    
+    cairo_params()
+    : flags(0)
+    , r(0.f)
+    , g(0.f)
+    , b(0.f)
+    , a(1.f)
+    , line_width(1)
+    {
+    }
+    bool operator==(const cairo_params &p) const
+    {
+        return flags == p.flags && r == p.r && g == p.g && b == p.b && a == p.a && line_width == p.line_width;
+    }
+};
+
+/// Byte level writer for packed line graph frames
+struct line_graph_packet_writer
+{
+    std::vector<uint8_t> data;
+    
+    inline void clear() { data.clear(); }
+    inline void byte(uint8_t v) { data.push_back(v); }
+    /// LEB128 unsigned integer, 1 byte for values below 128
+    inline void varint(uint32_t v)
+    {
+        while(v >= 0x80)
+        {
+            data.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        data.push_back((uint8_t)v);
+    }
+    /// Signed integer, small magnitudes of both signs in few bytes
+    inline void zigzag(int32_t v) { varint((uint32_t)((v << 1) ^ (v >> 31))); }
+    inline void f32(float v)
+    {
+        union { float f; uint32_t i; } u;
+        u.f = v;
+        for (int i = 0; i < 4; i++)
+            data.push_back((uint8_t)(u.i >> (8 * i)));
+    }
+    inline void str(const std::string &v)
+    {
+        varint(v.length());
+        data.insert(data.end(), v.begin(), v.end());
+    }
+    void params(const cairo_params &p);
+};
+
+/// Byte level reader for packed line graph frames, sets error instead of
+/// reading past the end
+struct line_graph_packet_reader
+{
+    const uint8_t *ptr, *end;
+    bool error;
+    
+    line_graph_packet_reader(const uint8_t *data, uint32_t len) : ptr(data), end(data + len), error(false) {}
+    inline uint8_t byte()
+    {
+        if (ptr >= end)
+        {
+            error = true;
+            return 0;
+        }
+        return *ptr++;
+    }
+    inline uint32_t varint()
+    {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            uint8_t b = byte();
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        error = true;
+        return 0;
+    }
+    inline int32_t zigzag()
+    {
+        uint32_t v = varint();
+        return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    }
+    inline float f32()
+    {
+        union { float f; uint32_t i; } u;
+        u.i = 0;
+        for (int i = 0; i < 4; i++)
+            u.i |= (uint32_t)byte() << (8 * i);
+        return u.f;
+    }
+    inline void str(std::string &v)
+    {
+        uint32_t len = varint();
+        if (len > (uint32_t)(end - ptr))
+        {
+            error = true;
+            len = end - ptr;
+        }
+        v.assign((const char *)ptr, len);
+        ptr += len;
+    }
+    void params(cairo_params &p);
+};
+
+/// Graph values are sent quantized to 1/QUANT_SCALE (about 1/2000 of the graph
+/// height), as the change from the curve in the base frame (or from zero in
+/// a key frame), each point relative to the change of the previous point.
+/// A curve that only moved a little, or that moved as a whole, costs about
+/// one byte per point.
+struct line_graph_curve_codec
+{
+    enum { QUANT_SCALE = 4096 };
+    static inline int16_t quantize(float v)
+    {
+        // also catches NaN
+        if (!(v > -32767.f / QUANT_SCALE))
+            return -32767;
+        if (v > 32767.f / QUANT_SCALE)
+            return 32767;
+        return (int16_t)lrintf(v * QUANT_SCALE);
+    }
+    static inline float dequantize(int16_t q) { return q * (1.f / QUANT_SCALE); }
+    static void encode(line_graph_packet_writer &w, const int16_t *q, const int16_t *ref);
+    /// Decode into q, ref may be the same array as q
+    static void decode(line_graph_packet_reader &r, int16_t *q, const int16_t *ref);
+};
+
+/// Shared memory channel for line graph frames, for a GUI running on the same
+/// machine as the plugin. The GUI creates the segment and passes its name to
+/// the plugin, the plugin writes frames into it and sends /lineGraphShm.
+/// The name comes in over OSC, so the plugin only attaches to segments named
+/// like the GUI names them and starting with the header the GUI writes.
+struct line_graph_shm
+{
+    /// "CLG" + layout version
+    enum { SIZE = 65536, CAPACITY = SIZE - 12, MAGIC = 0x434c4701 };
+    static const char NAME_PREFIX[];
+    /// MAGIC, written by the creator
+    uint32_t magic;
+    /// incremented before and after writing a frame, odd while writing
+    volatile uint32_t sequence;
+    uint32_t length;
+    uint8_t data[CAPACITY];
+    
+    /// Map the segment called name, creating it if create is true; NULL on
+    /// failure, or if an existing segment has a wrong name or header
+    static line_graph_shm *map(const char *name, bool create);
+    static void unmap(line_graph_shm *shm);
+    void write(const uint8_t *src, uint32_t len);
+    /// Copy the current frame into dest, false if it was being written or there isn't one
+    bool read(std::vector<uint8_t> &dest) const;
 };
 
 /// A class to send status updates via OSC
 struct dssi_feedback_sender
 {
+    /// What the GUI has of a graph - the state after the last frame sent
+    struct graph_state
+    {
+        /// value returned by get_changed_offsets for the last frame
+        int generation;
+        std::vector<int> modes;
+        std::vector<cairo_params> params;
+        /// LINE_GRAPH_POINTS quantized values per subgraph
+        std::vector<int16_t> curves;
+        /// the last dots and gridlines items, encoded
+        std::vector<uint8_t> dots, gridlines;
+        graph_state() : generation(0) {}
+    };
+    
     /// OSC client object used to send updates
     osctl::osc_client *client;
     /// Is client shared with something else?
@@ -587,10 +778,23 @@ struct dssi_feedback_sender
     /// Source for the graph data (interface to marshal)
     const calf_plugins::phase_graph_iface *phase;
     
+    /// Number of the last frame sent
+    uint32_t frame;
+    /// Number of the last frame applied by the GUI, as reported by the GUI
+    uint32_t acked_frame;
+    /// One per element of indices
+    std::vector<graph_state> sent;
+    line_graph_packet_writer packet, items;
+    /// Shared memory channel, NULL if frames are sent via OSC
+    line_graph_shm *shm;
+    
     /// Create using a new client
     dssi_feedback_sender(const char *URI, const line_graph_iface *_graph);
     dssi_feedback_sender(osctl::osc_client *_client, const line_graph_iface *_graph);
     void add_graphs(const calf_plugins::parameter_properties *props, int num_params);
+    /// Use the shared memory segment created by the GUI, if it's on this machine
+    /// (an empty name or a failure to map it means frames are sent via OSC)
+    void attach_shm(const char *name);
     void update();
     ~dssi_feedback_sender();
     
@@ -655,15 +859,53 @@ static inline float dB_grid(float amp, float res = 256, float ofs = 0.4)
 template<class Fx>
 static bool get_graph(Fx &fx, int subindex, float *data, int points, float res = 256, float ofs = 0.4)
 {
-    for (int i = 0; i < points; i++)
-    {
-        typedef std::complex<double> cfloat;
-        double freq = 20.0 * pow (20000.0 / 20.0, i * 1.0 / points);
+    // 20 Hz to 20 kHz, log scale
+    double freq = 20.0, step = pow(20000.0 / 20.0, 1.0 / points);
+    for (int i = 0; i < points; i++, freq *= step)
         data[i] = dB_grid(fx.freq_gain(subindex, freq, fx.srate), res, ofs);
-    }
     return true;
 }
 
+/// Frequency response graph of a cascade of biquads. All points of the
+/// graph are evaluated at once, and the curve is cached: as long as the
+/// sections, the size and the scale don't change, get_graph only copies
+/// the last result. Meant to be a (mutable) member of the module, used by
+/// the module's get_graph.
+class biquad_response
+{
+public:
+    enum { MAX_SECTIONS = 32 };
+private:
+    /// everything the curve depends on
+    struct key_type {
+        int points, sections;
+        float srate, res, ofs;
+        float coeffs[MAX_SECTIONS][5];
+    };
+    key_type key, cached_key;
+    bool cached;
+    /// sin^2(w/2) of every point, the only function of the frequency
+    /// |H(e^jw)| of a biquad depends on (see add_section)
+    std::vector<float> grid, curve, power;
+    int grid_points;
+    float grid_srate;
+    bool same_as_cached() const;
+public:
+    biquad_response() : cached(false), grid_points(0), grid_srate(0) { key.sections = 0; }
+    /// Remove all sections, before adding the current ones
+    void clear() { key.sections = 0; }
+    /// Add a section (coefficients of a biquad_coeffs, biquad_d1 or biquad_d2), times times in a row
+    template<class Coeffs>
+    void add(const Coeffs &c, int times = 1)
+    {
+        for (int i = 0; i < times; i++)
+            add(c.a0, c.a1, c.a2, c.b1, c.b2);
+    }
+    void add(float a0, float a1, float a2, float b1, float b2);
+    /// Calculate the graph (same scale as dB_grid) of all sections added since clear
+    bool get_graph(float *data, int points, float srate, float res = 256, float ofs = 0.4);
+};
+
 /// convert normalized grid-ish value back to amplitude value
 static inline float dB_grid_inv(float pos)
 {
@@ -27,22 +27,132 @@
 
 #include "utils.h"
 #include "vumeter.h"
+#include "telemetry.h"
 #include <pthread.h>
+#include <semaphore.h>
 #include <jack/jack.h>
+#include <map>
 
 namespace calf_plugins {
 
 class jack_host;
+
+/// Dependency graph of the plugins of a client, used for processing independent plugins in parallel
+struct plugin_schedule
+{
+    struct node
+    {
+        jack_host *plugin;
+        /// number of plugins that have to be processed before this one
+        int dependencies;
+        /// dependencies not yet processed in the current period
+        volatile int remaining;
+        /// indexes of plugins that depend on this one
+        std::vector<int> successors;
+    };
+    std::vector<node> nodes;
+    /// jack_client::graph_version the schedule has been built for
+    int version;
+    
+    /// Lock-free list of nodes ready to run in the current period. Every node is added exactly
+    /// once per period, so it never wraps around. Free slots contain -1.
+    std::vector<int> ready;
+    volatile int ready_head, ready_tail;
+    /// number of nodes already processed in the current period
+    volatile int completed;
+    
+    plugin_schedule() : version(-1) {}
+    /// Prepare for a new period (called from the process thread)
+    void reset();
+    /// Add a node to the ready list
+    inline void push(int node)
+    {
+        int pos = __sync_fetch_and_add(&ready_tail, 1);
+        __sync_synchronize();
+        ready[pos] = node;
+    }
+    /// Take a node off the ready list, returns -1 if none is ready right now
+    inline int pop()
+    {
+        while(true)
+        {
+            int pos = ready_head;
+            if (pos >= ready_tail)
+                return -1;
+            int node = *(volatile int *)&ready[pos];
+            // added, but not written yet
+            if (node == -1)
+                return -1;
+            if (__sync_bool_compare_and_swap(&ready_head, pos, pos + 1))
+                return node;
+        }
+    }
+};
+
+/// Plugin list (in processing order) and schedule as seen by the process callback. It is never
+/// changed after being published - any edit publishes a new one - except for the per-period state
+/// of the schedule, which is only touched while processing.
+struct plugin_snapshot
+{
+    std::vector<jack_host *> plugins;
+    plugin_schedule schedule;
+};
+
+/// Runs the plugins of a schedule on the JACK process thread plus a pool of realtime worker threads
+class jack_executor
+{
+    jack_client_t *client;
+    std::vector<pthread_t> threads;
+    /// number of worker threads, fixed between start() and stop() - run() uses this and not threads
+    int worker_count;
+    sem_t start_sem;
+    /// worker threads that haven't finished the current period yet
+    volatile int active;
+    volatile bool quit;
+    /// schedule and buffer size of the current period
+    plugin_schedule *schedule;
+    jack_nframes_t nframes;
+    
+    static void *thread_func(void *arg);
+    void run_nodes();
+public:
+    jack_executor();
+    /// Create the worker threads (the client must be open, but not active yet)
+    void start(jack_client_t *_client, int thread_count);
+    /// Stop and join the worker threads (the client must not be active anymore)
+    void stop();
+    inline int get_thread_count() const { return worker_count; }
+    /// Process all plugins in the schedule, returns after all of them are done
+    void run(plugin_schedule &_schedule, jack_nframes_t _nframes);
+    ~jack_executor();
+};
     
 class jack_client {
 protected:
+    /// the master copy of the plugin list, never used by the process callback
     std::vector<jack_host *> plugins;
+    /// serializes the changes to the plugin list (and the buffer size callback), not used by the process callback
     calf_utils::ptmutex mutex;
+    /// the state used by the process callback
+    plugin_snapshot *volatile snapshot;
+    /// incremented by the process callback on entry and on exit (odd = processing)
+    volatile unsigned int process_epoch;
+    jack_executor executor;
+    /// incremented on every change of connections or the plugin list
+    volatile int graph_version;
+    
+    /// Find which plugins (indexes in the list) need to be processed before which - key = plugin, value = its dependency
+    void get_plugin_dependencies(const std::vector<jack_host *> &plugins, std::multimap<int, int> &run_before);
+    /// Make a new snapshot of the plugin list (with a rebuilt schedule) visible to the process callback,
+    /// and free the old one once the process callback can't be using it anymore. Must be called with mutex locked.
+    void publish_snapshot();
 public:
     jack_client_t *client;
     int input_nr, output_nr, midi_nr;
     std::string name, input_name, output_name, midi_name;
     int sample_rate;
+    /// Number of extra threads used to process independent plugins, -1 = one less than the number of CPUs
+    int thread_count;
 
     jack_client();
     void add(jack_host *plugin);
@@ -56,10 +166,15 @@ public:
     void close();
     void apply_plugin_order(const std::vector<int> &indices);
     void calculate_plugin_order(std::vector<int> &indices);
+    /// Rebuild the dependency graph used for parallel processing (not to be called from the process thread)
+    void update_schedule();
+    /// Check whether connections have changed since the last update_schedule
+    bool is_schedule_stale() { return snapshot->schedule.version != graph_version; }
     const char **get_ports(const char *name_re, const char *type_re, unsigned long flags);
     
     static int do_jack_process(jack_nframes_t nframes, void *p);
     static int do_jack_bufsize(jack_nframes_t numsamples, void *p);
+    static int do_jack_graph_order(void *p);
 };
     
 class jack_host: public plugin_ctl_iface {
@@ -78,6 +193,7 @@ public:
     float *param_values;
     float midi_meter;
     audio_module_iface *module;
+    telemetry_plane *telemetry;
     
 public:
     typedef int (*process_func)(jack_nframes_t nframes, void *p);
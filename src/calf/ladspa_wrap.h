@@ -30,6 +30,7 @@
 #endif
 #include "giface.h"
 #include "preset.h"
+#include "telemetry.h"
 
 namespace calf_plugins {
 
@@ -45,8 +46,10 @@ struct ladspa_instance: public plugin_ctl_iface
 #if USE_DSSI
     dssi_feedback_sender *feedback_sender;
 #endif
+    telemetry_plane *telemetry;
     
     ladspa_instance(audio_module_iface *_module, ladspa_plugin_metadata_set *_ladspa, int sample_rate);
+    ~ladspa_instance() { delete telemetry; }
     virtual const line_graph_iface *get_line_graph_iface() const { return module->get_line_graph_iface(); }
     virtual const phase_graph_iface *get_phase_graph_iface() const { return module->get_phase_graph_iface(); }
     virtual float get_param_value(int param_no);
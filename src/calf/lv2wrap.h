@@ -28,6 +28,7 @@
 #include <lv2.h>
 #include <calf/giface.h>
 #include <calf/preset.h>
+#include <calf/telemetry.h>
 #include <calf/lv2_event.h>
 #include <calf/lv2_state.h>
 #include <calf/lv2_programs.h>
@@ -51,6 +52,7 @@ struct lv2_instance: public plugin_ctl_iface, public progress_report_iface
     int real_param_count;
     std::vector<plugin_preset> *presets;
     std::vector<LV2_Program_Descriptor> *preset_descs;
+    telemetry_plane *telemetry;
 
     lv2_instance(audio_module_iface *_module)
     {
@@ -69,9 +71,11 @@ struct lv2_instance: public plugin_ctl_iface, public progress_report_iface
         
         presets = NULL;
         preset_descs = NULL;
+        telemetry = telemetry_plane::create(metadata);
     }
     ~lv2_instance()
     {
+        delete telemetry;
         if (presets)
         {
             presets->clear();
@@ -327,6 +331,8 @@ struct lv2_wrapper
             inst->process_events(offset);
         }
         inst->module->process_slice(offset, SampleCount);
+        if (inst->telemetry)
+            inst->telemetry->publish(inst->params, SampleCount);
     }
     static void cb_cleanup(LV2_Handle Instance)
     {
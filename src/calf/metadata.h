@@ -66,11 +66,22 @@ struct filterclavier_metadata: public plugin_metadata<filterclavier_metadata>
 
 struct reverb_metadata: public plugin_metadata<reverb_metadata>
 {
-    enum { par_clip, par_meter_wet, par_meter_out, par_decay, par_hfdamp, par_roomsize, par_diffusion, par_amount, par_dry, par_predelay, par_basscut, par_treblecut, param_count };
+    enum { par_clip, par_meter_wet, par_meter_out, par_decay, par_hfdamp, par_roomsize, par_diffusion, par_amount, par_dry, par_predelay, par_basscut, par_treblecut, par_quality, param_count };
     enum { in_count = 2, out_count = 2, ins_optional = 0, outs_optional = 0, support_midi = false, require_midi = false, rt_capable = true };
     PLUGIN_NAME_ID_LABEL("reverb", "reverb", "Reverb")
 };
 
+/// Convolver - metadata
+struct convolver_metadata: public plugin_metadata<convolver_metadata>
+{
+    enum { par_meter_wet, par_meter_out, par_dry, par_wet, param_count };
+    enum { in_count = 2, out_count = 2, ins_optional = 0, outs_optional = 0, support_midi = false, require_midi = false, rt_capable = true };
+    PLUGIN_NAME_ID_LABEL("convolver", "convolver", "Convolver")
+
+public:
+    const char *const *get_configure_vars() const;
+};
+
 struct vintage_delay_metadata: public plugin_metadata<vintage_delay_metadata>
 {
     enum { par_bpm, par_divide, par_time_l, par_time_r, par_feedback, par_amount, par_mixmode, par_medium, par_dryamount, par_width, par_tap, par_waiting, param_count };
@@ -262,6 +273,7 @@ struct limiter_metadata: public plugin_metadata<limiter_metadata>
            param_limit, param_attack, param_release,
            param_att,
            param_asc, param_asc_led, param_asc_coeff,
+           param_oversampling,
            param_count };
     PLUGIN_NAME_ID_LABEL("limiter", "limiter", "Limiter")
 };
@@ -360,7 +372,7 @@ struct saturator_metadata: public plugin_metadata<saturator_metadata>
     enum { in_count = 2, out_count = 2, ins_optional = 1, outs_optional = 1, support_midi = false, require_midi = false, rt_capable = true };
     enum { param_bypass, param_level_in, param_level_out, param_mix, MONO_VU_METER_PARAMS, param_drive, param_blend, param_meter_drive,
            param_lp_pre_freq, param_hp_pre_freq, param_lp_post_freq, param_hp_post_freq,
-           param_p_freq, param_p_level, param_p_q, param_count };
+           param_p_freq, param_p_level, param_p_q, param_oversampling, param_count };
     PLUGIN_NAME_ID_LABEL("saturator", "saturator", "Saturator")
 };
 /// Markus's Exciter - metadata
@@ -368,7 +380,7 @@ struct exciter_metadata: public plugin_metadata<exciter_metadata>
 {
     enum { in_count = 2, out_count = 2, ins_optional = 1, outs_optional = 1, support_midi = false, require_midi = false, rt_capable = true };
     enum { param_bypass, param_level_in, param_level_out, param_amount, MONO_VU_METER_PARAMS, param_drive, param_blend, param_meter_drive,
-           param_freq, param_listen, param_ceil_active, param_ceil, param_count };
+           param_freq, param_listen, param_ceil_active, param_ceil, param_oversampling, param_count };
     PLUGIN_NAME_ID_LABEL("exciter", "exciter", "Exciter")
 };
 /// Markus's Bass Enhancer - metadata
@@ -376,7 +388,7 @@ struct bassenhancer_metadata: public plugin_metadata<bassenhancer_metadata>
 {
     enum { in_count = 2, out_count = 2, ins_optional = 1, outs_optional = 1, support_midi = false, require_midi = false, rt_capable = true };
     enum { param_bypass, param_level_in, param_level_out, param_amount, MONO_VU_METER_PARAMS, param_drive, param_blend, param_meter_drive,
-           param_freq, param_listen, param_floor_active, param_floor, param_count };
+           param_freq, param_listen, param_floor_active, param_floor, param_oversampling, param_count };
     PLUGIN_NAME_ID_LABEL("bassenhancer", "bassenhancer", "Bass Enhancer")
 };
 /// Markus's Stereo Module - metadata
@@ -416,6 +428,7 @@ struct analyzer_metadata: public plugin_metadata<analyzer_metadata>
            param_analyzer_accuracy, param_analyzer_speed,
            param_analyzer_display, param_analyzer_hold, param_analyzer_freeze,
            param_gonio_level, param_gonio_mode, param_gonio_use_fade, param_gonio_fade, param_gonio_accuracy, param_gonio_display,
+           param_analyzer_overlap, param_analyzer_accumulate,
            param_count };
     PLUGIN_NAME_ID_LABEL("analyzer", "analyzer", "Analyzer")
 };
@@ -602,6 +615,7 @@ struct wavetable_metadata: public plugin_metadata<wavetable_metadata>
     wavetable_metadata();
     /// Lookup of table edit interface
     virtual const table_metadata_iface *get_table_metadata_iface(const char *key) const { if (!strcmp(key, "mod_matrix")) return &mm_metadata; else return NULL; }
+    const char *const *get_configure_vars() const;
 };
 
 };
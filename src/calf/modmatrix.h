@@ -22,7 +22,9 @@
 #define __CALF_MODMATRIX_H
  
 #include "giface.h"
+#include "primitives.h"
 #include <stdio.h>
+#include <vector>
 
 namespace dsp {
 
@@ -61,12 +63,31 @@ namespace calf_plugins {
 class mod_matrix_impl
 {
 protected:
+    /// Active row of the matrix, ready for evaluation: dest += (c0 + c1 * src1 + c2 * src1^2) * src2
+    struct compiled_row
+    {
+        int src1, src2, dest;
+        /// Mapping polynomial with the amount already applied
+        float c0, c1, c2;
+    };
     dsp::modulation_entry *matrix;
     mod_matrix_metadata *metadata;
     unsigned int matrix_rows;
+    /// Compiled form of the whole matrix
+    struct compiled_matrix
+    {
+        std::vector<compiled_row> rows;
+        unsigned int count;
+    };
+    /// configure() fills the producer slot and publishes it, the audio thread
+    /// switches to the newest one at the start of calculate_modmatrix; a slot
+    /// is never rewritten while the audio thread may still be reading it
+    dsp::triple_buffer<compiled_matrix> compiled;
     /// Polynomials for different scaling modes (1, x, x^2)
     static const float scaling_coeffs[calf_plugins::mod_matrix_metadata::map_type_count][3];
 
+    /// Rebuild the compiled form of the matrix after the rows have changed
+    void compile();
 public:
     mod_matrix_impl(dsp::modulation_entry *_matrix, calf_plugins::mod_matrix_metadata *_metadata);
 
@@ -75,17 +96,20 @@ public:
     {
         for (int i = 0; i < moddest_count; i++)
             moddest[i] = 0;
-        for (unsigned int i = 0; i < matrix_rows; i++)
+        compiled.fetch();
+        const compiled_matrix &cm = compiled.read_slot();
+        const compiled_row *rows = &cm.rows[0];
+        for (unsigned int i = 0; i < cm.count; i++)
         {
-            dsp::modulation_entry &slot = matrix[i];
-            if (slot.dest) {
-                float value = modsrc[slot.src1];
-                const float *c = scaling_coeffs[slot.mapping];
-                value = c[0] + c[1] * value + c[2] * value * value;
-                moddest[slot.dest] += value * modsrc[slot.src2] * slot.amount;
-            }
+            const compiled_row &row = rows[i];
+            float value = modsrc[row.src1];
+            moddest[row.dest] += (row.c0 + (row.c1 + row.c2 * value) * value) * modsrc[row.src2];
         }
     }
+    /// Process modulation matrix for nvoices voices at once. Sources and
+    /// destinations are stored one row per source/destination, with one
+    /// column per voice and stride floats between the rows.
+    void calculate_modmatrix(float *moddest, int moddest_count, const float *modsrc, int nvoices, int stride);
     void send_configures(send_configure_iface *);
     char *configure(const char *key, const char *value);
     
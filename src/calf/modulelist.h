@@ -3,6 +3,7 @@
     PER_MODULE_ITEM(filterclavier, false, "filterclavier")
     PER_MODULE_ITEM(flanger, false, "flanger")
     PER_MODULE_ITEM(reverb, false, "reverb")
+    PER_MODULE_ITEM(convolver, false, "convolver")
     PER_MODULE_ITEM(monosynth, true, "monosynth")
     PER_MODULE_ITEM(vintage_delay, false, "vintagedelay")
     PER_MODULE_ITEM(organ, true, "organ")
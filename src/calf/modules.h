@@ -22,14 +22,17 @@
 #define CALF_MODULES_H
 
 #include <assert.h>
-#include <fftw3.h>
 #include <limits.h>
+#include <vector>
+#include "analyzer.h"
 #include "biquad.h"
+#include "convolution.h"
 #include "inertia.h"
 #include "audio_fx.h"
 #include "giface.h"
 #include "metadata.h"
 #include "loudness.h"
+#include "osc.h"
 
 namespace calf_plugins {
 
@@ -54,15 +57,75 @@ public:
     void deactivate();
 };
 
+/// Stereo convolution reverb with an impulse response loaded from a WAV file
+class convolver_audio_module: public audio_module<convolver_metadata>
+{
+public:
+    /// longest impulse response used, in seconds (the rest is cut off)
+    enum { MAX_IR_SECONDS = 10 };
+    /// engine used by the audio thread
+    dsp::convolution_engine *engine;
+    /// engine built by configure, waiting to be picked up by the audio thread
+    dsp::convolution_engine *volatile pending;
+    /// engine replaced by the audio thread, to be deleted outside of it
+    dsp::convolution_engine *volatile retired;
+    std::string ir_file, ir_status;
+    int status_serial;
+    uint32_t srate;
+    dsp::gain_smoothing wet, dry;
+    float meter_wet, meter_out;
+
+    convolver_audio_module();
+    ~convolver_audio_module();
+    void params_changed();
+    void activate();
+    void deactivate();
+    void set_sample_rate(uint32_t sr);
+    uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
+    /// DSSI-style configure function, "ir" is the file name of the impulse response
+    char *configure(const char *key, const char *value);
+    void send_configures(send_configure_iface *sci);
+    int send_status_updates(send_updates_iface *sui, int last_serial);
+private:
+    /// Build an engine for the current file and sample rate and hand it over to the audio thread
+    bool load(std::string &error);
+};
+
 class vintage_delay_audio_module: public audio_module<vintage_delay_metadata>
 {
 public:    
-    // 1MB of delay memory per channel... uh, RAM is cheap
-    enum { MAX_DELAY = 262144, ADDR_MASK = MAX_DELAY - 1 };
+    /// smallest ring, so that the mask doesn't get silly for very short delays
+    enum { MIN_RING = 4096 };
+    /// longest delay line in seconds (the sum of both times in the L/R modes)
+    static const float MAX_DELAY_TIME;
     enum { MIXMODE_STEREO, MIXMODE_PINGPONG, MIXMODE_LR, MIXMODE_RL }; 
-    float buffers[2][MAX_DELAY];
+    /// Allocates a bigger ring when the settings need one, on the waveform builder
+    /// thread. The audio thread picks it up at the start of the next block.
+    struct ring_grower: public dsp::waveform_builder::job
+    {
+        /// ring size wanted by the audio thread (0 = none)
+        volatile int request;
+        /// set by the worker when fresh holds a ring of fresh_size samples, cleared by the audio thread when taking it
+        volatile int ready;
+        float *fresh[2];
+        int fresh_size;
+        /// ring replaced by the audio thread, to be freed by the worker
+        float *retired[2];
+        ring_grower();
+        virtual bool run();
+        /// Free whatever is still owned (the job must not be registered)
+        void release();
+    };
+    /// delay memory - a ring of buffer_size samples per channel, allocated in activate
+    /// for the current settings and replaced by a bigger one from grower when needed
+    float *buffers[2];
+    /// number of samples allocated per channel, a power of two
+    int buffer_size, ring_mask;
+    /// largest ring allowed at the current sample rate
+    int max_ring;
+    ring_grower grower;
     int bufptr, deltime_l, deltime_r, mixmode, medium, old_medium;
-    /// number of table entries written (value is only important when it is less than MAX_DELAY, which means that the buffer hasn't been totally filled yet)
+    /// number of ring entries behind bufptr holding valid data (written or cleared since activation, at most buffer_size)
     int age;
     
     dsp::gain_smoothing amt_left, amt_right, fb_left, fb_right, dry, chmix;
@@ -72,12 +135,16 @@ public:
     uint32_t srate;
     
     vintage_delay_audio_module();
+    ~vintage_delay_audio_module();
     
     void params_changed();
     void activate();
     void deactivate();
     void set_sample_rate(uint32_t sr);
     void calc_filters();
+    void clear_history(int max_delay);
+    /// Delay times (in samples) and ring size the current settings need
+    int wanted_times(int &time_l, int &time_r);
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
     
     long _tap_avg;
@@ -98,6 +165,8 @@ public:
     dsp::once_per_n timer;
     bool is_active;    
     mutable volatile int last_generation, last_calculated_generation;
+    /// response of the filter, for the graph
+    mutable biquad_response response;
     
     filter_module_with_inertia(float **ins, float **outs, float **params)
     : inertia_cutoff(dsp::exponential_ramp(128), 20)
@@ -337,25 +406,18 @@ protected:
     static const int max_phase_buffer_size = 8192;
     int phase_buffer_size;
     float *phase_buffer;
-    int fft_buffer_size;
-    float *fft_buffer;
     int *spline_buffer;
     int plength;
     int ppos;
-    int fpos;
-    mutable fftwf_plan fft_plan;
-    static const int max_fft_cache_size = 32768;
-    static const int max_fft_buffer_size = max_fft_cache_size * 2;
-    float *fft_inL, *fft_outL;
-    float *fft_inR, *fft_outR;
-    float *fft_smoothL, *fft_smoothR;
-    float *fft_deltaL, *fft_deltaR;
-    float *fft_holdL, *fft_holdR;
-    float *fft_fallingL, *fft_fallingR;
-    float *fft_freezeL, *fft_freezeR;
+    /// Windowing, FFT, smoothing and hold run here, away from the audio and GUI threads
+    mutable dsp::spectrum_worker worker;
+    dsp::spectrum_settings settings;
+    /// FFT bin shown at each pixel of the graph (drawn where it increases)
+    mutable std::vector<int> pixel_bins;
+    mutable int bins_points, bins_accuracy, bins_linear;
     mutable int lintrans;
-    mutable int ____analyzer_phase_was_drawn_here;
-    mutable int ____analyzer_sanitize;
+    void update_pixel_bins(int points, int accuracy) const;
+    void postprocess(float *outL, float *outR, int points, int accuracy) const;
 
 };
 
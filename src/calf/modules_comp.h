@@ -24,12 +24,14 @@
 #include <assert.h>
 #include <limits.h>
 #include "biquad.h"
+#include "crossover.h"
 #include "inertia.h"
 #include "audio_fx.h"
 #include "giface.h"
 #include "loudness.h"
 #include "metadata.h"
 #include "plugin_tools.h"
+#include "utils.h"
 
 namespace calf_plugins {
 
@@ -53,6 +55,8 @@ public:
     void set_params(float att, float rel, float thr, float rat, float kn, float mak, float det, float stl, float byp, float mu);
     void update_curve();
     void process(float &left, float &right, const float *det_left = NULL, const float *det_right = NULL);
+    /// process a block in place, each channel is its own detector input
+    void process_block(float *left, float *right, uint32_t len);
     void activate();
     void deactivate();
     int id;
@@ -83,6 +87,8 @@ public:
     void set_params(float att, float rel, float thr, float rat, float kn, float mak, float det, float stl, float byp, float mu, float ran);
     void update_curve();
     void process(float &left, float &right, const float *det_left = NULL, const float *det_right = NULL);
+    /// process a block in place, each channel is its own detector input
+    void process_block(float *left, float *right, uint32_t len);
     void activate();
     void deactivate();
     int id;
@@ -147,6 +153,9 @@ private:
     stereo_in_out_metering<sidechaincompressor_metadata> meters;
     gain_reduction_audio_module compressor;
     dsp::biquad_d2<float> f1L, f1R, f2L, f2R;
+    /// response of the sidechain filters, for the graph
+    mutable biquad_response response;
+    void build_response() const;
 public:
     typedef std::complex<double> cfloat;
     uint32_t srate;
@@ -176,17 +185,31 @@ private:
     uint32_t clip_inL, clip_inR, clip_outL, clip_outR;
     float meter_inL, meter_inR, meter_outL, meter_outR;
     gain_reduction_audio_module strip[strips];
-    dsp::biquad_d2<float> lpL[strips - 1][3], lpR[strips - 1][3], hpL[strips - 1][3], hpR[strips - 1][3];
-    float freq_old[strips - 1], sep_old[strips - 1], q_old[strips - 1];
-    int mode, mode_old;
+    dsp::crossover<strips> xover;
+    /// blocks at least this long are processed band by band, on the worker pool threads if there are any
+    enum { PARALLEL_MIN_RUN = 1024, PARALLEL_RUN = 4096 };
+    calf_utils::task_pool *pool;
+    /// output of the crossover, processed in place by the strips
+    float *band_buffer, *bands[strips * 2];
+    uint32_t band_buffer_size;
+    /// number of samples in bands the worker tasks process
+    uint32_t band_run;
+    void split(uint32_t offset, uint32_t pos, uint32_t len);
+    void process_band(int band, uint32_t pos, uint32_t len);
+    static void process_band_task(void *arg, int band);
+    void mix(uint32_t offset, uint32_t pos, uint32_t len);
+    void begin_meters(uint32_t numsamples);
+    void set_meters(bool bypass);
 public:
     uint32_t srate;
     bool is_active;
     multibandcompressor_audio_module();
+    ~multibandcompressor_audio_module();
     void activate();
     void deactivate();
     void params_changed();
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
+    uint32_t process_slice(uint32_t offset, uint32_t end);
     void set_sample_rate(uint32_t sr);
     const gain_reduction_audio_module *get_strip_by_param_index(int index) const;
     virtual bool get_graph(int index, int subindex, float *data, int points, cairo_iface *context, int *mode) const;
@@ -209,6 +232,7 @@ private:
     uint32_t clip_led;
     gain_reduction_audio_module compressor;
     dsp::biquad_d2<float> hpL, hpR, lpL, lpR, pL, pR;
+    mutable biquad_response response;
 public:
     uint32_t srate;
     bool is_active;
@@ -280,6 +304,9 @@ private:
     stereo_in_out_metering<sidechaingate_metadata> meters;
     expander_audio_module gate;
     dsp::biquad_d2<float> f1L, f1R, f2L, f2R;
+    /// response of the sidechain filters, for the graph
+    mutable biquad_response response;
+    void build_response() const;
 public:
     typedef std::complex<double> cfloat;
     uint32_t srate;
@@ -310,17 +337,31 @@ private:
     uint32_t clip_inL, clip_inR, clip_outL, clip_outR;
     float meter_inL, meter_inR, meter_outL, meter_outR;
     expander_audio_module gate[strips];
-    dsp::biquad_d2<float> lpL[strips - 1][3], lpR[strips - 1][3], hpL[strips - 1][3], hpR[strips - 1][3];
-    float freq_old[strips - 1], sep_old[strips - 1], q_old[strips - 1];
-    int mode, mode_old;
+    dsp::crossover<strips> xover;
+    /// blocks at least this long are processed band by band, on the worker pool threads if there are any
+    enum { PARALLEL_MIN_RUN = 1024, PARALLEL_RUN = 4096 };
+    calf_utils::task_pool *pool;
+    /// output of the crossover, processed in place by the strips
+    float *band_buffer, *bands[strips * 2];
+    uint32_t band_buffer_size;
+    /// number of samples in bands the worker tasks process
+    uint32_t band_run;
+    void split(uint32_t offset, uint32_t pos, uint32_t len);
+    void process_band(int band, uint32_t pos, uint32_t len);
+    static void process_band_task(void *arg, int band);
+    void mix(uint32_t offset, uint32_t pos, uint32_t len);
+    void begin_meters(uint32_t numsamples);
+    void set_meters(bool bypass);
 public:
     uint32_t srate;
     bool is_active;
     multibandgate_audio_module();
+    ~multibandgate_audio_module();
     void activate();
     void deactivate();
     void params_changed();
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
+    uint32_t process_slice(uint32_t offset, uint32_t end);
     void set_sample_rate(uint32_t sr);
     const expander_audio_module *get_strip_by_param_index(int index) const;
     virtual bool get_graph(int index, int subindex, float *data, int points, cairo_iface *context, int *mode) const;
@@ -43,6 +43,11 @@ private:
     dsp::biquad_d2<float> lp[2][4], hp[2][4];
     dsp::biquad_d2<float> p[2];
     dsp::tap_distortion dist[2];
+    dsp::oversampler os[2];
+    /// delay for the dry signal, to keep it aligned with the oversampled one
+    dsp::simple_delay<64, float> dry[2];
+    int oversampling;
+    void set_oversampling(int factor);
 public:
     uint32_t srate;
     bool is_active;
@@ -64,6 +69,11 @@ private:
     dsp::biquad_d2<float> hp[2][4];
     dsp::biquad_d2<float> lp[2][2];
     dsp::tap_distortion dist[2];
+    dsp::oversampler os[2];
+    /// delay for the dry signal, to keep it aligned with the oversampled one
+    dsp::simple_delay<64, float> dry[2];
+    int oversampling;
+    void set_oversampling(int factor);
 public:
     uint32_t srate;
     bool is_active;
@@ -85,6 +95,11 @@ private:
     dsp::biquad_d2<float> lp[2][4];
     dsp::biquad_d2<float> hp[2][2];
     dsp::tap_distortion dist[2];
+    dsp::oversampler os[2];
+    /// delay for the dry signal, to keep it aligned with the oversampled one
+    dsp::simple_delay<64, float> dry[2];
+    int oversampling;
+    void set_oversampling(int factor);
 public:
     uint32_t srate;
     bool is_active;
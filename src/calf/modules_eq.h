@@ -52,13 +52,15 @@ private:
     float hs_level_old, hs_freq_old;
     float p_level_old[PeakBands], p_freq_old[PeakBands], p_q_old[PeakBands];
     mutable float old_params_for_graph[graph_param_count];
+    /// slots of the filter cascade - up to 3 sections for each of HP and LP, then shelves and peaks
+    enum { slot_hp = 0, slot_lp = 3, slot_ls = 6, slot_hs, slot_p1, slot_count = slot_p1 + PeakBands };
     dual_in_out_metering<BaseClass> meters;
     CalfEqMode hp_mode, lp_mode;
-    dsp::biquad_d2<float> hp[3][2], lp[3][2];
-    dsp::biquad_d2<float> lsL, lsR, hsL, hsR;
-    dsp::biquad_d2<float> pL[PeakBands], pR[PeakBands];
+    dsp::biquad_d2_cascade<slot_count> filters;
+    /// response of the active sections, for the graph
+    mutable biquad_response response;
     
-    inline void process_hplp(float &left, float &right);
+    void build_chain();
 public:
     typedef std::complex<double> cfloat;
     uint32_t srate;
@@ -24,11 +24,13 @@
 #include <assert.h>
 #include <limits.h>
 #include "biquad.h"
+#include "crossover.h"
 #include "inertia.h"
 #include "audio_fx.h"
 #include "giface.h"
 #include "metadata.h"
 #include "plugin_tools.h"
+#include "utils.h"
 
 namespace calf_plugins {
 
@@ -40,6 +42,9 @@ private:
     int mode, mode_old;
     float meter_inL, meter_inR, meter_outL, meter_outR;
     dsp::lookahead_limiter limiter;
+    dsp::oversampler os[2];
+    int oversampling;
+    void set_oversampling(int factor);
 public:
     uint32_t srate;
     bool is_active;
@@ -60,37 +65,51 @@ private:
     typedef multibandlimiter_audio_module AM;
     static const int strips = 4;
     uint32_t clip_inL, clip_inR, clip_outL, clip_outR, asc_led;
-    int _mode, mode_old;
+    float mode_old;
     bool solo[strips];
     bool no_solo;
     float meter_inL, meter_inR, meter_outL, meter_outR;
     dsp::lookahead_limiter strip[strips];
     dsp::lookahead_limiter broadband;
-    dsp::biquad_d2<float> lpL[strips - 1][strips - 1], lpR[strips - 1][strips - 1], hpL[strips - 1][strips - 1], hpR[strips - 1][strips - 1];
-    float freq_old[strips - 1], sep_old[strips - 1], q_old[strips - 1];
-    unsigned int pos;
-    unsigned int buffer_size;
-    unsigned int overall_buffer_size;
-    float *buffer;
-    int channels;
+    dsp::crossover<strips> xover;
+    float freq_old[strips - 1];
     float striprel[strips];
     float weight[strips];
     float weight_old[strips];
     float limit_old;
     bool asc_old;
     float attack_old;
-    bool _sanitize;
     bool old_bypass;
     mutable volatile int last_generation;
     mutable bool redraw_graph;
+    /// blocks at least this long are processed band by band, on the worker pool threads if there are any
+    enum { PARALLEL_MIN_RUN = 1024, PARALLEL_RUN = 4096 };
+    calf_utils::task_pool *pool;
+    /// output of the crossover, processed in place by the strips
+    float *band_buffer, *bands[strips * 2];
+    /// multiband coefficient for every sample in bands
+    float *multi;
+    uint32_t band_buffer_size;
+    /// number of samples in bands the worker tasks process
+    uint32_t band_run;
+    /// attenuation of the broadband limiter
+    float batt;
+    void split(uint32_t offset, uint32_t pos, uint32_t len);
+    void process_band(int band, uint32_t pos, uint32_t len);
+    static void process_band_task(void *arg, int band);
+    void mix(uint32_t offset, uint32_t pos, uint32_t len);
+    void begin_meters(uint32_t numsamples);
+    void set_meters(bool bypass);
 public:
     uint32_t srate;
     bool is_active;
     multibandlimiter_audio_module();
+    ~multibandlimiter_audio_module();
     void activate();
     void deactivate();
     void params_changed();
     uint32_t process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask);
+    uint32_t process_slice(uint32_t offset, uint32_t end);
     void set_sample_rate(uint32_t sr);
     bool get_graph(int index, int subindex, float *data, int points, cairo_iface *context, int *mode) const;
     bool get_gridline(int index, int subindex, float &pos, bool &vertical, std::string &legend, cairo_iface *context) const;
@@ -231,6 +231,8 @@ protected:
     bool finishing;
     dsp::inertia<dsp::exponential_ramp> inertia_pitchbend;
 
+    template<int FracBits>
+    void render_drawbar(const float *data, uint32_t phase, uint32_t dphase, float ampl, float ampr, float (*out)[Channels]);
 public:
     organ_voice()
     : organ_voice_base(NULL, sample_rate, perc_released)
@@ -23,7 +23,9 @@
 #define CALF_OSC_H
 
 #include "fft.h"
+#include <algorithm>
 #include <map>
+#include <vector>
 
 namespace dsp
 {
@@ -81,23 +83,13 @@ struct bandlimiter
     /// Import time domain waveform and calculate spectrum from it
     void compute_spectrum(float input[SIZE])
     {
-        dsp::fft<float, SIZE_BITS> &fft = get_fft();
-        std::complex<float> *data = new std::complex<float>[SIZE];
-        for (int i = 0; i < SIZE; i++)
-            data[i] = input[i];
-        fft.calculate(data, spectrum, false);
-        delete []data;
+        get_fft().calculate_real(input, spectrum);
     }
     
     /// Generate the waveform from the contained spectrum.
     void compute_waveform(float output[SIZE])
     {
-        dsp::fft<float, SIZE_BITS> &fft = get_fft();
-        std::complex<float> *data = new std::complex<float>[SIZE];
-        fft.calculate(spectrum, data, true);
-        for (int i = 0; i < SIZE; i++)
-            output[i] = data[i].real();
-        delete []data;
+        get_fft().calculate_real_inverse(spectrum, output);
     }
     
     /// remove DC offset of the spectrum (it usually does more harm than good!)
@@ -111,9 +103,8 @@ struct bandlimiter
     void make_waveform(float output[SIZE], int cutoff, bool foldover = false)
     {
         dsp::fft<float, SIZE_BITS> &fft = get_fft();
-        std::vector<std::complex<float> > new_spec, iffted;
+        std::vector<std::complex<float> > new_spec;
         new_spec.resize(SIZE);
-        iffted.resize(SIZE);
         // Copy original harmonics up to cutoff point
         new_spec[0] = spectrum[0];
         for (int i = 1; i < cutoff; i++)
@@ -145,22 +136,104 @@ struct bandlimiter
                 new_spec[i] = 0.f,
                 new_spec[SIZE - i] = 0.f;
         }
-        // convert back to time domain (IFFT) and extract only real part
-        fft.calculate(&new_spec.front(), &iffted.front(), true);
-        for (int i = 0; i < SIZE; i++)
-            output[i] = iffted[i].real();
+        // convert back to time domain (IFFT), only the real part is needed
+        fft.calculate_real_inverse(&new_spec.front(), output);
     }
 };
 
-/// Set of bandlimited wavetables
+/**
+ * Background thread for calculating wavetables, so that the audio thread never has to wait for them.
+ * Jobs are run from a single worker thread; adding and removing jobs may block, waking the worker doesn't.
+ */
+class waveform_builder
+{
+public:
+    struct job
+    {
+        /// Do the pending work (called from the worker thread). Returns true when the job is
+        /// finished for good and can be dropped.
+        virtual bool run() = 0;
+        virtual ~job() {}
+    };
+    /// Register a job and wake the worker
+    static void add(job *j);
+    /// Unregister a job, waits if it is being run at the moment
+    static void remove(job *j);
+    /// Tell the worker there is work to do. Safe to call from the audio thread.
+    static void wake();
+};
+
+/// Set of bandlimited wavetables. Can be calculated upfront, or lazily - then only the dullest and
+/// the brightest levels are calculated immediately, and the other ones are calculated in the
+/// background the first time they're needed.
+/// The levels are kept in a flat array sorted by key (phase delta limit), with a small index
+/// on log2(phase delta), so that a lookup takes a couple of comparisons and no pointer chasing.
 template<int SIZE_BITS>
-struct waveform_family: public std::map<uint32_t, float *>
+struct waveform_family
 {
     enum { SIZE = 1 << SIZE_BITS };
-    using std::map<uint32_t, float *>::iterator;
-    using std::map<uint32_t, float *>::end;
-    using std::map<uint32_t, float *>::lower_bound;
+    /// resolution of the lookup index - the levels are further apart than that, so that a lookup
+    /// needs at most one or two steps from the position found in the index
+    enum { BUCKETS_PER_OCTAVE = 8, BUCKET_COUNT = 32 * BUCKETS_PER_OCTAVE };
+    /// first = the lowest phase delta the level is too bright for, second = wave data (SIZE + 1 values)
+    typedef std::pair<uint32_t, float *> level;
+    typedef typename std::vector<level>::iterator iterator;
+    typedef typename std::vector<level>::const_iterator const_iterator;
+    
     float original[SIZE];
+    /// false if the levels point into memory owned by someone else (e.g. a mapped cache file)
+    bool owns_levels;
+    
+    /// Levels not calculated yet, owned by the family. Their data pointers are NULL until ready.
+    struct lazy_levels: public waveform_builder::job
+    {
+        /// holds the spectrum, freed once all levels are done
+        bandlimiter<SIZE_BITS> *bl;
+        bool foldover;
+        /// cutoff of each level
+        std::vector<int> cutoffs;
+        /// data pointer of each level, written by the worker thread
+        std::vector<float **> slots;
+        /// set (by the audio thread, possibly) when a level is needed
+        std::vector<int> requested;
+        
+        lazy_levels() : bl(NULL) {}
+        void build(int level)
+        {
+            float *wf = new float[SIZE+1];
+            bl->make_waveform(wf, cutoffs[level], foldover);
+            wf[SIZE] = wf[0];
+            // make sure the contents are visible before the pointer is
+            __sync_synchronize();
+            *slots[level] = wf;
+        }
+        virtual bool run()
+        {
+            bool done = true;
+            for (size_t i = 0; i < slots.size(); i++)
+            {
+                if (*slots[i])
+                    continue;
+                if (requested[i])
+                    build(i);
+                else
+                    done = false;
+            }
+            if (done)
+            {
+                delete bl;
+                bl = NULL;
+            }
+            return done;
+        }
+        ~lazy_levels() { delete bl; }
+    };
+    lazy_levels *lazy;
+    
+    waveform_family() : owns_levels(true), lazy(NULL)
+    {
+        update_index();
+    }
     
     /// Fill the family using specified bandlimiter and original waveform. Optionally apply foldover. 
     /// Does not produce harmonics over specified limit (limit = (SIZE / 2) / min_number_of_harmonics)
@@ -171,9 +244,164 @@ struct waveform_family: public std::map<uint32_t, float *>
         make_from_spectrum(bl, foldover);
     }
     
+    /// Same as make, but only calculates the levels as they're needed
+    void make_lazy(bandlimiter<SIZE_BITS> &bl, float input[SIZE], bool foldover = false, uint32_t limit = SIZE / 2)
+    {
+        memcpy(original, input, sizeof(original));
+        bl.compute_spectrum(input);
+        make_from_spectrum_lazy(bl, foldover);
+    }
+    
     /// Fill the family using specified bandlimiter and spectrum contained within. Optionally apply foldover. 
     /// Does not produce harmonics over specified limit (limit = (SIZE / 2) / min_number_of_harmonics)
     void make_from_spectrum(bandlimiter<SIZE_BITS> &bl, bool foldover = false, uint32_t limit = SIZE / 2)
+    {
+        std::map<uint32_t, int> plan;
+        plan_levels(bl, foldover, limit, plan);
+        for (std::map<uint32_t, int>::iterator i = plan.begin(); i != plan.end(); i++)
+        {
+            float *wf = new float[SIZE+1];
+            bl.make_waveform(wf, i->second, foldover);
+            wf[SIZE] = wf[0];
+            levels.push_back(level(i->first, wf));
+        }
+        update_index();
+    }
+    
+    /// Same as make_from_spectrum, but only calculates the dullest and the brightest levels upfront.
+    /// The remaining ones are calculated in the background when first asked for, or when request_all is called.
+    void make_from_spectrum_lazy(bandlimiter<SIZE_BITS> &bl, bool foldover = false, uint32_t limit = SIZE / 2)
+    {
+        std::map<uint32_t, int> plan;
+        plan_levels(bl, foldover, limit, plan);
+        if (plan.empty())
+            return;
+        lazy = new lazy_levels;
+        lazy->bl = new bandlimiter<SIZE_BITS>;
+        memcpy(lazy->bl->spectrum, bl.spectrum, sizeof(bl.spectrum));
+        lazy->foldover = foldover;
+        for (std::map<uint32_t, int>::iterator i = plan.begin(); i != plan.end(); i++)
+        {
+            levels.push_back(level(i->first, (float *)NULL));
+            lazy->cutoffs.push_back(i->second);
+            lazy->requested.push_back(0);
+        }
+        // no more reallocations from now on, the slots may be used
+        for (size_t i = 0; i < levels.size(); i++)
+            lazy->slots.push_back(&levels[i].second);
+        update_index();
+        lazy->build(0);
+        lazy->build(levels.size() - 1);
+        waveform_builder::add(lazy);
+    }
+    
+    /// Calculate all the remaining levels in the background (doesn't wait for them)
+    void request_all()
+    {
+        if (!lazy)
+            return;
+        for (size_t i = 0; i < lazy->requested.size(); i++)
+            lazy->requested[i] = 1;
+        waveform_builder::wake();
+    }
+    
+    /// Check whether all the levels have been calculated
+    bool is_complete() const
+    {
+        for (const_iterator i = begin(); i != end(); i++)
+        {
+            if (!i->second)
+                return false;
+        }
+        return true;
+    }
+    
+    inline iterator begin() { return levels.begin(); }
+    inline iterator end() { return levels.end(); }
+    inline const_iterator begin() const { return levels.begin(); }
+    inline const_iterator end() const { return levels.end(); }
+    inline size_t size() const { return levels.size(); }
+    inline bool empty() const { return levels.empty(); }
+    
+    /// Retrieve waveform pointer suitable for specified phase_delta
+    inline float *get_level(uint32_t phase_delta)
+    {
+        const level *lv = level_data;
+        uint32_t i = bucket_first[bucket(phase_delta)];
+        while(i < level_count && lv[i].first <= phase_delta)
+            i++;
+        if (i == level_count)
+            return NULL;
+        // printf("Level = %08x\n", lv[i].first);
+        if (lv[i].second)
+            return lv[i].second;
+        return get_missing_level(i);
+    }
+    /// Add a level table (SIZE + 1 values) kept in externally owned, read-only memory that outlives
+    /// the family (like a mapped cache file). Families built this way don't free their levels.
+    void attach_level(uint32_t key, const float *data)
+    {
+        iterator i = std::lower_bound(levels.begin(), levels.end(), level(key, (float *)NULL));
+        if (i != levels.end() && i->first == key)
+            i->second = const_cast<float *>(data);
+        else
+            levels.insert(i, level(key, const_cast<float *>(data)));
+        owns_levels = false;
+        update_index();
+    }
+    /// Destructor, deletes the waveforms.
+    ~waveform_family()
+    {
+        if (lazy)
+        {
+            waveform_builder::remove(lazy);
+            delete lazy;
+        }
+        if (owns_levels)
+        {
+            for (iterator i = begin(); i != end(); i++)
+                delete []i->second;
+        }
+    }
+private:
+    std::vector<level> levels;
+    /// copies of levels.data() and levels.size() for the lookup
+    const level *level_data;
+    uint32_t level_count;
+    /// index of the first level with key above the lowest phase delta belonging to the bucket
+    uint16_t bucket_first[BUCKET_COUNT];
+    
+    /// Lookup index position, monotonic in phase_delta: integer part of log2 and 3 bits of the fraction
+    static inline uint32_t bucket(uint32_t phase_delta)
+    {
+        if (!phase_delta)
+            return 0;
+        int lz = __builtin_clz(phase_delta);
+        return (31 - lz) * BUCKETS_PER_OCTAVE + (((phase_delta << lz) >> 28) & (BUCKETS_PER_OCTAVE - 1));
+    }
+    /// Smallest phase delta that falls into a given bucket (or less, for buckets no phase delta falls into)
+    static inline uint32_t bucket_start(uint32_t b)
+    {
+        if (!b)
+            return 0;
+        uint32_t e = b / BUCKETS_PER_OCTAVE, f = b % BUCKETS_PER_OCTAVE;
+        return (1U << e) + (uint32_t)(((uint64_t)f << e) / BUCKETS_PER_OCTAVE);
+    }
+    void update_index()
+    {
+        level_data = levels.empty() ? NULL : &levels[0];
+        level_count = levels.size();
+        uint32_t pos = 0;
+        for (uint32_t b = 0; b < BUCKET_COUNT; b++)
+        {
+            uint32_t start = bucket_start(b);
+            while(pos < level_count && levels[pos].first <= start)
+                pos++;
+            bucket_first[b] = pos;
+        }
+    }
+    /// Find the cutoff point for each level, indexed by the lowest phase delta the level is too bright for
+    static void plan_levels(bandlimiter<SIZE_BITS> &bl, bool foldover, uint32_t limit, std::map<uint32_t, int> &plan)
     {
         bl.remove_dc();
         
@@ -197,30 +425,31 @@ struct waveform_family: public std::map<uint32_t, float *>
                     cutoff--;
                 }
             }
-            float *wf = new float[SIZE+1];
-            bl.make_waveform(wf, cutoff, foldover);
-            wf[SIZE] = wf[0];
-            (*this)[base * (top / cutoff)] = wf;
+            plan[base * (top / cutoff)] = cutoff;
             cutoff = (int)(0.75 * cutoff);
         }
     }
-    
-    /// Retrieve waveform pointer suitable for specified phase_delta
-    inline float *get_level(uint32_t phase_delta)
+    /// Slow path of get_level for a level that isn't there yet - ask for it, and meanwhile
+    /// use the nearest duller level (or, if there isn't any, the nearest brighter one)
+    float *get_missing_level(uint32_t i)
     {
-        iterator i = upper_bound(phase_delta);
-        if (i == end())
-            return NULL;
-        // printf("Level = %08x\n", i->first);
-        return i->second;
-    }
-    /// Destructor, deletes the waveforms and removes them from the map.
-    ~waveform_family()
-    {
-        for (iterator i = begin(); i != end(); i++)
-            delete []i->second;
-        clear();
+        if (lazy && __sync_lock_test_and_set(&lazy->requested[i], 1) == 0)
+            waveform_builder::wake();
+        for (uint32_t j = i; j < level_count; j++)
+        {
+            if (level_data[j].second)
+                return level_data[j].second;
+        }
+        while(i > 0)
+        {
+            --i;
+            if (level_data[i].second)
+                return level_data[i].second;
+        }
+        return NULL;
     }
+    waveform_family(const waveform_family &);
+    waveform_family &operator=(const waveform_family &);
 };
 
 #if 0
@@ -88,6 +88,55 @@ struct null_buffer
     }
 };
 
+/// A string inside a received packet, referenced rather than copied - only
+/// valid as long as the packet is. OSC strings are NUL-terminated in the
+/// packet, so c_str() can be used as well.
+struct osc_string_ref
+{
+    const char *ptr;
+    uint32_t len;
+    
+    osc_string_ref() : ptr(""), len(0) {}
+    osc_string_ref(const char *_ptr, uint32_t _len) : ptr(_ptr), len(_len) {}
+    inline const char *c_str() const { return ptr; }
+    inline uint32_t length() const { return len; }
+    inline uint32_t size() const { return len; }
+    inline bool empty() const { return len == 0; }
+    inline char operator[](uint32_t pos) const { return ptr[pos]; }
+    inline std::string str() const { return std::string(ptr, len); }
+    inline bool equals(const char *str, uint32_t str_len) const
+    {
+        return len == str_len && !memcmp(ptr, str, len);
+    }
+    inline bool operator==(const char *str) const { return equals(str, strlen(str)); }
+    inline bool operator==(const std::string &str) const { return equals(str.data(), str.length()); }
+    inline bool operator!=(const char *str) const { return !(*this == str); }
+    inline bool operator!=(const std::string &str) const { return !(*this == str); }
+    /// If the string starts with prefix, set rest to the part after it and return true
+    inline bool strip_prefix(const std::string &prefix, osc_string_ref &rest) const
+    {
+        if (len < prefix.length() || memcmp(ptr, prefix.data(), prefix.length()))
+            return false;
+        rest = osc_string_ref(ptr + prefix.length(), len - prefix.length());
+        return true;
+    }
+};
+
+inline std::ostream &operator <<(std::ostream &s, const osc_string_ref &str)
+{
+    return s.write(str.ptr, str.len);
+}
+
+/// Bundle time tag, NTP format (seconds since 1900 and fractions of a second
+/// in units of 2^-32). 0:1 means "immediately".
+struct osc_timetag
+{
+    uint32_t sec, frac;
+    
+    osc_timetag(uint32_t _sec = 0, uint32_t _frac = 1) : sec(_sec), frac(_frac) {}
+    inline bool is_immediate() const { return sec == 0 && frac == 1; }
+};
+
 struct raw_buffer
 {
     uint8_t *ptr;
@@ -125,6 +174,41 @@ struct raw_buffer
         count += bytes;
         return true;
     }
+    /// Reference a padded OSC string in place instead of copying it
+    bool read_string(osc_string_ref &str)
+    {
+        if (pos >= count)
+            return false;
+        const char *start = (const char *)ptr + pos;
+        const char *end = (const char *)memchr(start, 0, count - pos);
+        if (!end)
+            return false;
+        uint32_t len = end - start;
+        // string, NUL and padding to a multiple of 4
+        uint32_t padded = (len + 4) & ~3;
+        if (pos + padded > count)
+            return false;
+        str = osc_string_ref(start, len);
+        pos += padded;
+        return true;
+    }
+    /// Reference a length-prefixed, padded OSC blob in place
+    bool read_blob(const uint8_t *&data, uint32_t &len)
+    {
+        if (pos + 4 > count)
+            return false;
+        uint32_t nlen;
+        memcpy(&nlen, ptr + pos, 4);
+        len = ntohl(nlen);
+        uint32_t left = count - pos - 4;
+        if (len > left)
+            return false;
+        data = ptr + pos + 4;
+        // padded the same way as write_buffer_to_osc_stream does it, but
+        // a blob without padding at the end of the message is fine too
+        pos += 4 + std::min(left, len + 4 - (len & 3));
+        return true;
+    }
     int read_left()
     {
         return count - pos;
@@ -262,6 +346,7 @@ struct osc_stream
     }
 };
 
+typedef osc_stream<raw_buffer> osc_rawstream;
 typedef osc_stream<string_buffer> osc_strstream;
 typedef osc_stream<string_buffer, string_buffer> osc_typed_strstream;
 
@@ -367,6 +452,32 @@ operator >>(osc_stream<Buffer, TypeBuffer> &s, std::string &str)
     return s;
 }
 
+template<class TypeBuffer>
+inline osc_stream<raw_buffer, TypeBuffer> &
+operator >>(osc_stream<raw_buffer, TypeBuffer> &s, osc_string_ref &str)
+{
+    if (!s.buffer.read_string(str))
+        throw osc_read_exception();
+    return s;
+}
+
+template<class TypeBuffer>
+inline osc_stream<raw_buffer, TypeBuffer> &
+operator >>(osc_stream<raw_buffer, TypeBuffer> &s, std::string &str)
+{
+    osc_string_ref ref;
+    s >> ref;
+    str.assign(ref.ptr, ref.len);
+    return s;
+}
+
+template<class Buffer, class TypeBuffer>
+inline osc_stream<Buffer, TypeBuffer> &
+operator >>(osc_stream<Buffer, TypeBuffer> &s, osc_timetag &tt)
+{
+    return s >> tt.sec >> tt.frac;
+}
+
 template<class Buffer, class TypeBuffer, class DestBuffer>
 inline osc_stream<Buffer, TypeBuffer> &
 read_buffer_from_osc_stream(osc_stream<Buffer, TypeBuffer> &s, DestBuffer &buf)
@@ -480,7 +591,11 @@ struct osc_net_dns_exception: public std::exception
 template<class OscStream>
 struct osc_message_sink
 {
-    virtual void receive_osc_message(std::string address, std::string type_tag, OscStream &buffer)=0;
+    virtual void receive_osc_message(osc_string_ref address, osc_string_ref type_tag, OscStream &buffer)=0;
+    /// Called before the messages of a bundle (every nested bundle gets its own call)
+    virtual void receive_osc_bundle_start(const osc_timetag &timetag) {}
+    /// Called after the last message of a bundle
+    virtual void receive_osc_bundle_end() {}
     virtual ~osc_message_sink() {}
 };
 
@@ -490,7 +605,7 @@ struct osc_message_dump: public osc_message_sink<OscStream>
     DumpStream &stream;
     osc_message_dump(DumpStream &_stream) : stream(_stream) {}
         
-    virtual void receive_osc_message(std::string address, std::string type_tag, OscStream &buffer)
+    virtual void receive_osc_message(osc_string_ref address, osc_string_ref type_tag, OscStream &buffer)
     {
         int pos = buffer.buffer.tell();
         stream << "address: " << address << ", type tag: " << type_tag << std::endl;
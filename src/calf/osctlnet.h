@@ -56,13 +56,25 @@ struct osc_client: public osc_socket
 /// osc_glib_server that hooks into glib main loop.
 struct osc_server: public osc_socket
 {
-    osc_message_dump<osc_strstream, std::ostream> dump;
-    osc_message_sink<osc_strstream> *sink;
+    /// Largest datagram received, and number of datagrams per recvmmsg call
+    enum { RX_PACKET = 65536, RX_BATCH = 8 };
     
-    osc_server() : dump(std::cout), sink(&dump) {}
+    osc_message_dump<osc_rawstream, std::ostream> dump;
+    osc_message_sink<osc_rawstream> *sink;
+    /// Receive buffers, allocated on first read and reused after that;
+    /// messages are parsed in place
+    std::vector<char> rx_buffer;
+    /// false if the kernel turned out not to have recvmmsg
+    bool use_mmsg;
     
+    osc_server() : dump(std::cout), sink(&dump), use_mmsg(true) {}
+    
+    /// Read and dispatch all the datagrams waiting in the socket
     void read_from_socket();
-    void parse_message(const char *buffer, int len);    
+    /// Dispatch a datagram or a bundle element - a message or a nested bundle
+    void parse_packet(const char *buffer, int len);
+    void parse_message(const char *buffer, int len);
+    void parse_bundle(const char *buffer, int len);
     ~osc_server();
 };
 
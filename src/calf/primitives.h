@@ -28,6 +28,9 @@
 #include <cmath>
 #include <cstdlib>
 #include <map>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 namespace dsp {
 
@@ -443,6 +446,74 @@ inline void sanitize(stereo_sample<T> &value)
     sanitize(value.right);
 }
 
+/**
+ * Turns on flush-to-zero (and denormals-are-zero, where the instruction set
+ * guarantees it) for the lifetime of the object, restoring the previous
+ * floating point control state on destruction. Inside such a scope, SSE
+ * arithmetic never produces or consumes denormals, so inner loops don't
+ * need to sanitize their state on every sample. Does nothing on non-SSE builds.
+ */
+class denormal_guard
+{
+#ifdef __SSE__
+    unsigned int old_csr;
+public:
+    enum {
+        CSR_FTZ = 0x8000,
+        CSR_DAZ = 0x0040,
+    };
+    denormal_guard()
+    {
+        old_csr = _mm_getcsr();
+#ifdef __SSE2__
+        _mm_setcsr(old_csr | CSR_FTZ | CSR_DAZ);
+#else
+        // some SSE1-only CPUs fault on the DAZ bit
+        _mm_setcsr(old_csr | CSR_FTZ);
+#endif
+    }
+    ~denormal_guard()
+    {
+        _mm_setcsr(old_csr);
+    }
+#endif
+};
+
+/// Single producer, single consumer triple buffer. The producer always has
+/// a slot of its own to fill, the consumer picks up the newest complete slot,
+/// and neither of them ever waits for the other.
+template<class T>
+class triple_buffer
+{
+    enum { FRESH = 4 };
+    T slots[3];
+    int back, front;
+    /// Index of the slot in the middle, FRESH is set until the consumer takes it
+    volatile int ready;
+public:
+    triple_buffer() : back(0), front(1), ready(2) {}
+    /// Direct access to all slots, for setting up before any thread runs
+    T &slot(int i) { return slots[i]; }
+    /// Producer side: the slot to fill
+    T &write_slot() { return slots[back]; }
+    /// Producer side: hand the filled slot over and get a free one back
+    void publish()
+    {
+        __sync_synchronize();
+        back = __sync_lock_test_and_set(&ready, back | FRESH) & 3;
+    }
+    /// Consumer side: switch to the newest slot, returns false if there is nothing new
+    bool fetch()
+    {
+        if (!(ready & FRESH))
+            return false;
+        front = __sync_lock_test_and_set(&ready, front) & 3;
+        return true;
+    }
+    /// Consumer side: the slot picked up by the last successful fetch
+    T &read_slot() { return slots[front]; }
+};
+
 inline float fract16(unsigned int value)
 {
     return (value & 0xFFFF) * (1.0 / 65536.0);
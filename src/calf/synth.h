@@ -27,8 +27,6 @@
 #include <memory.h>
 #include <stdint.h>
 #include <bitset>
-#include <list>
-#include <stack>
 
 namespace dsp {
 
@@ -178,6 +176,62 @@ public:
     }
 };
 
+/// Fixed capacity set of playing voices, kept contiguous so that the
+/// synth can walk it without chasing list nodes. Removal moves the last
+/// voice into the freed slot, so the order of voices isn't preserved;
+/// every slot keeps the number of the note_on that started the voice
+/// instead, for the cases where age matters (stealing).
+class voice_array {
+public:
+    enum { MAX_VOICES = 64 };
+    typedef dsp::voice **iterator;
+private:
+    dsp::voice *voices[MAX_VOICES];
+    uint8_t notes[MAX_VOICES];
+    uint32_t serials[MAX_VOICES];
+    /// slots of voices started with a given note, bit n = slot n
+    uint64_t note_slots[128];
+    unsigned int count;
+    uint32_t serial;
+public:
+    voice_array() : count(0), serial(0) {
+        memset(note_slots, 0, sizeof(note_slots));
+    }
+    inline iterator begin() { return voices; }
+    inline iterator end() { return voices + count; }
+    inline unsigned int size() const { return count; }
+    inline bool empty() const { return count == 0; }
+    inline bool full() const { return count == MAX_VOICES; }
+    inline dsp::voice *operator[](unsigned int slot) const { return voices[slot]; }
+    /// note_on number of the voice in the slot, smaller = older
+    inline uint32_t get_serial(unsigned int slot) const { return serials[slot]; }
+    /// bit mask of slots playing the note
+    inline uint64_t get_note_slots(int note) const { return note_slots[note & 127]; }
+    void push(dsp::voice *v, int note) {
+        assert(count < MAX_VOICES);
+        voices[count] = v;
+        notes[count] = note & 127;
+        serials[count] = serial++;
+        note_slots[note & 127] |= (uint64_t)1 << count;
+        count++;
+    }
+    /// Remove the voice in the slot (moving the last voice into it) and return it
+    dsp::voice *remove(unsigned int slot) {
+        assert(slot < count);
+        dsp::voice *v = voices[slot];
+        unsigned int last = --count;
+        note_slots[notes[slot]] &= ~((uint64_t)1 << slot);
+        if (slot != last) {
+            voices[slot] = voices[last];
+            notes[slot] = notes[last];
+            serials[slot] = serials[last];
+            note_slots[notes[last]] &= ~((uint64_t)1 << last);
+            note_slots[notes[last]] |= (uint64_t)1 << slot;
+        }
+        return v;
+    }
+};
+
 /// Base class for all kinds of polyphonic instruments, provides
 /// somewhat reasonable voice management, pedal support - and 
 /// little else. It's implemented as a base class with virtual
@@ -193,16 +247,25 @@ protected:
     /// Sostenuto pedal state
     bool sostenuto;
     /// Voices currently playing
-    std::list<dsp::voice *> active_voices;
+    dsp::voice_array active_voices;
     /// Voices allocated, but not used
-    std::stack<dsp::voice *> unused_voices;
+    dsp::voice *unused_voices[voice_array::MAX_VOICES];
+    /// Number of entries in unused_voices
+    unsigned int unused_count;
+    /// Number of voices allocated so far (active or unused)
+    unsigned int allocated_count;
     /// Gate values for all 128 MIDI notes
     std::bitset<128> gate;
     /// Maximum allocated number of channels
     unsigned int polyphony_limit;
 
     void kill_note(int note, int vel, bool just_one);
+    /// Slot of the active voice to steal first: the lowest priority one,
+    /// the oldest of those if there's a tie. Voices with priority of
+    /// max_priority or more are not considered. Returns -1 if none.
+    int find_victim(float max_priority);
 public:
+    basic_synth() : unused_count(0), allocated_count(0) {}
     virtual void setup(int sr) {
         sample_rate = sr;
         hold = false;
@@ -0,0 +1,112 @@
+/* Calf DSP Library
+ * Shared memory telemetry of plugin instances.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman, Markus Schmidt and others
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef CALF_TELEMETRY_H
+#define CALF_TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace calf_plugins {
+
+struct plugin_metadata_iface;
+
+/**
+ * Header of a telemetry segment, followed by param_count values and
+ * param_count names of NAME_LEN characters. One segment per plugin
+ * instance, called /calf-telemetry-<pid>-<serial> (so /dev/shm/calf-telemetry-*
+ * on Linux), written by the audio thread, readable by any process.
+ */
+struct telemetry_header
+{
+    enum { MAGIC = 0x666C6163, LAYOUT_VERSION = 1, NAME_LEN = 32 };
+    uint32_t magic, version;
+    uint32_t pid, param_count;
+    char plugin_id[NAME_LEN];
+    /// incremented before and after every update, odd while one is in progress
+    volatile uint32_t sequence;
+    uint32_t reserved;
+    /// samples processed by the instance so far
+    uint64_t frames;
+    
+    float *values() { return (float *)(this + 1); }
+    const float *values() const { return (const float *)(this + 1); }
+    const char *param_name(int param) const { return (const char *)(values() + param_count) + param * NAME_LEN; }
+    static size_t size(uint32_t param_count) { return sizeof(telemetry_header) + param_count * (sizeof(float) + NAME_LEN); }
+};
+
+/// Writing side of a telemetry segment, owned by the plugin wrapper
+class telemetry_plane
+{
+    telemetry_header *header;
+    size_t size;
+    std::string name;
+    
+    telemetry_plane(telemetry_header *_header, size_t _size, const std::string &_name);
+public:
+    /// Create the segment for a new instance of a plugin, if telemetry is
+    /// enabled (CALF_TELEMETRY environment variable set to a non-zero value),
+    /// NULL otherwise
+    static telemetry_plane *create(const plugin_metadata_iface *metadata);
+    const std::string &get_name() const { return name; }
+    /// Store the current values of all the parameters (ports not connected
+    /// by the host are stored as 0), called by the audio thread after every
+    /// processed buffer of nsamples - wait-free, readers never block it
+    inline void publish(float *const *params, uint32_t nsamples)
+    {
+        uint32_t seq = header->sequence;
+        header->sequence = seq + 1;
+        __sync_synchronize();
+        float *values = header->values();
+        for (uint32_t i = 0; i < header->param_count; i++)
+            values[i] = params[i] ? *params[i] : 0.f;
+        header->frames += nsamples;
+        __sync_synchronize();
+        header->sequence = seq + 2;
+    }
+    /// Unmaps and removes the segment
+    ~telemetry_plane();
+};
+
+/// Read-only view of a telemetry segment, for GUIs and monitoring tools
+class telemetry_reader
+{
+    const telemetry_header *header;
+    size_t size;
+public:
+    telemetry_reader() : header(NULL), size(0) {}
+    ~telemetry_reader() { close(); }
+    /// Map the segment (name as in /calf-telemetry-1234-0), false if it doesn't
+    /// exist or isn't a telemetry segment of a known version
+    bool open(const char *name);
+    void close();
+    uint32_t get_param_count() const { return header->param_count; }
+    uint32_t get_pid() const { return header->pid; }
+    const char *get_plugin_id() const { return header->plugin_id; }
+    const char *get_param_name(int param) const { return header->param_name(param); }
+    /// Copy a consistent set of get_param_count() values and the sample count;
+    /// false if every attempt overlapped an update
+    bool read(float *values, uint64_t &frames, int attempts = 16) const;
+};
+
+};
+
+#endif
@@ -23,8 +23,10 @@
 
 #include <errno.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace calf_utils
 {
@@ -186,6 +188,91 @@ std::string load_file(const std::string &src);
 /// Indent a string by another string (prefix each line)
 std::string indent(const std::string &src, const std::string &indent);
 
+/// Per-user cache directory for Calf ($XDG_CACHE_HOME/calf or ~/.cache/calf), created if needed.
+/// Returns an empty string if no usable directory could be found or created.
+std::string get_cache_dir();
+
+/// Write a blob to a file atomically (via a temporary file in the same directory + rename),
+/// so that concurrent readers never see a partially written file. Returns false on failure.
+bool write_file_atomic(const std::string &filename, const void *data, size_t size);
+
+/// Read-only, shared memory mapping of a whole file. The pages are shared between
+/// all processes that map the same file.
+class mapped_file
+{
+    void *data;
+    size_t size;
+public:
+    mapped_file() : data(NULL), size(0) {}
+    /// Map the file, returns false if it cannot be opened or mapped
+    bool map(const std::string &filename);
+    /// Remove the mapping (if any)
+    void unmap();
+    inline const void *get_data() const { return data; }
+    inline size_t get_size() const { return size; }
+    ~mapped_file() { unmap(); }
+private:
+    mapped_file(const mapped_file &);
+    mapped_file &operator=(const mapped_file &);
+};
+
+/// A few worker threads that help a realtime thread with work that splits into
+/// independent tasks (like the bands of a multiband effect). run() hands the tasks
+/// out to the calling thread and the workers, and returns when all of them are
+/// done. Only one run() is served at a time: if another thread is already using
+/// the workers, the caller simply does all of its tasks by itself, it never waits
+/// for someone else's tasks.
+/// This is the plugin side counterpart of jack_executor (calfjackhost), which
+/// can't be used here, as plugins run in any host, not only on a JACK client.
+/// The workers are woken with a semaphore. The caller, after doing its own share,
+/// yields for a little while waiting for the workers that took part, as they
+/// usually finish about the same time; if they don't, it sleeps on a second
+/// semaphore the last worker posts, so that it never keeps the workers off the
+/// CPU (e.g. when they didn't get a realtime policy). The workers take over the
+/// realtime policy of the first realtime thread that calls run().
+class task_pool
+{
+public:
+    typedef void (*task_func)(void *arg, int index);
+private:
+    std::vector<pthread_t> threads;
+    sem_t start_sem, done_sem;
+    /// set while a run() is using the workers
+    volatile int busy;
+    /// set once the workers got the scheduling policy of a realtime thread
+    bool sched_copied;
+    volatile bool quit;
+    // the current job
+    task_func func;
+    void *arg;
+    int task_count;
+    /// index of the next task to hand out
+    volatile int next_task;
+    /// workers woken up for the current job that haven't finished yet
+    volatile int pending;
+
+    /// sched_yield() calls made by run() before going to sleep on done_sem
+    enum { SPIN_LIMIT = 64 };
+
+    static void *thread_func(void *arg);
+    void do_tasks();
+    void copy_sched();
+public:
+    /// Start the given number of worker threads (0 is fine, run() then works serially)
+    task_pool(int thread_count);
+    ~task_pool();
+    int get_thread_count() const { return threads.size(); }
+    /// Call func(arg, i) for every i in [0, count) and wait for all of them
+    void run(task_func func, void *arg, int count);
+    /// The pool shared by all plugins in the process, with as many threads as
+    /// CALF_WORKER_THREADS asks for, but no more than there are other CPUs
+    /// (none if that is unset, run() then does everything on the calling thread)
+    static task_pool *get_shared();
+private:
+    task_pool(const task_pool &);
+    task_pool &operator=(const task_pool &);
+};
+
 };
 
 #endif
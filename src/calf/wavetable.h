@@ -43,11 +43,13 @@ struct wavetable_oscillator: public dsp::simple_oscillator
     }
 };
 
+/// Voice of the wavetable synth. Control rate processing (envelopes, mod
+/// matrix) is driven by wavetable_audio_module::control_tick every BlockSize
+/// samples, for all voices at once; render_to only runs the oscillators.
 class wavetable_voice: public dsp::voice
 {
 public:
-    enum { Channels = 2, BlockSize = 64, EnvCount = 3, OscCount = 2 };
-    float output_buffer[BlockSize][Channels];
+    enum { BlockSize = 64, EnvCount = 3, OscCount = 2 };
 protected:
     int note;
     wavetable_audio_module *parent;
@@ -65,6 +67,8 @@ protected:
     float last_oscamp[OscCount];
     /// Current osc amplitude
     float cur_oscamp[OscCount];
+    /// Per-sample increments of last_oscshift and last_oscamp until the next control tick
+    float osstep[OscCount], oastep[OscCount];
 public:
     wavetable_voice();
     void set_params_ptr(wavetable_audio_module *_parent, int _srate);
@@ -73,7 +77,12 @@ public:
     void note_off(int /* vel */);
     void channel_pressure(int value);
     void steal();
-    void render_block();
+    /// Advance the envelopes and store the modulation sources in a column of
+    /// a source-major table with stride floats per row
+    void get_mod_sources(float *modsrc, int stride);
+    /// Apply the mod matrix outputs from a column of a destination-major table
+    void set_mod_dests(const float *dests, int stride);
+    void render_to(float (*buf)[2], int nsamples);
     virtual int get_current_note() {
         return note;
     }
@@ -99,6 +108,11 @@ public:
 protected:
     uint32_t crate;
     bool panic_flag;
+    /// Samples left until the next control tick
+    uint32_t tick_left;
+    /// Mod matrix inputs and outputs of all active voices, one column per voice
+    float tick_modsrc[modsrc_count][dsp::voice_array::MAX_VOICES];
+    float tick_moddest[moddest_count][dsp::voice_array::MAX_VOICES];
 
 public:
     int16_t tables[wt_count][129][256]; // one dummy level for interpolation
@@ -117,10 +131,15 @@ public:
     wavetable_audio_module();
 
     dsp::voice *alloc_voice() {
-        dsp::block_voice<wavetable_voice> *v = new dsp::block_voice<wavetable_voice>();
+        wavetable_voice *v = new wavetable_voice();
         v->set_params_ptr(this, sample_rate);
         return v;
     }
+    /// Control rate update of all the active voices
+    void control_tick();
+    /// Send all configure variables set within a plugin to given destination (which may be limited to only those that plugin understands)
+    virtual void send_configures(send_configure_iface *sci) { return mod_matrix_impl::send_configures(sci); }
+    virtual char *configure(const char *key, const char *value) { return mod_matrix_impl::configure(key, value); }
     
     /// process function copied from Organ (will probably need some adjustments as well as implementing the panic flag elsewhere
     uint32_t process(uint32_t offset, uint32_t nsamples, uint32_t inputs_mask, uint32_t outputs_mask) {
@@ -133,7 +152,18 @@ public:
         }
         float buf[4096][2];
         dsp::zero(&buf[0][0], 2 * nsamples);
-        basic_synth::render_to(buf, nsamples);
+        for (uint32_t pos = 0; pos < nsamples; )
+        {
+            if (!tick_left)
+            {
+                control_tick();
+                tick_left = wavetable_voice::BlockSize;
+            }
+            uint32_t len = std::min(tick_left, nsamples - pos);
+            basic_synth::render_to(buf + pos, len);
+            pos += len;
+            tick_left -= len;
+        }
         float gain = 1.0f;
         for (uint32_t i=0; i<nsamples; i++) {
             o[0][i] = gain*buf[i][0];
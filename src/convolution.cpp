@@ -0,0 +1,359 @@
+/* Calf DSP Library
+ * Partitioned convolution engine and impulse response loading.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman, Markus Schmidt and others
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include <calf/convolution.h>
+#include <calf/primitives.h>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace dsp;
+
+namespace {
+
+inline uint32_t get_le(const uint8_t *p, int bytes)
+{
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+/// One segment of one channel of an impulse response, as a reader for
+/// partitioned_convolution::set_filter
+struct ir_segment
+{
+    const wave_file &file;
+    int channel;
+    uint32_t offset, end;
+    double ratio;
+    ir_segment(const wave_file &f, int ch, uint32_t o, uint32_t e, double r)
+    : file(f), channel(ch), offset(o), end(e), ratio(r) {}
+    void operator()(uint32_t start, uint32_t count, float *out)
+    {
+        start += offset;
+        uint32_t avail = start < end ? std::min(count, end - start) : 0;
+        file.read(channel, start, avail, out, ratio);
+        for (uint32_t i = avail; i < count; i++)
+            out[i] = 0.f;
+    }
+};
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+wave_file::wave_file()
+{
+    map = NULL;
+    map_size = 0;
+    samples = NULL;
+    format = bits = channels = rate = 0;
+    frames = 0;
+}
+
+wave_file::~wave_file()
+{
+    close();
+}
+
+void wave_file::close()
+{
+    if (map)
+        munmap(map, map_size);
+    map = NULL;
+    samples = NULL;
+    frames = 0;
+}
+
+bool wave_file::open(const char *name, std::string &error)
+{
+    close();
+    int fd = ::open(name, O_RDONLY);
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < 12) {
+        ::close(fd);
+        error = "Not a WAV file";
+        return false;
+    }
+    map_size = st.st_size;
+    map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        map = NULL;
+        error = strerror(errno);
+        return false;
+    }
+    // the response is converted from start to end, once
+    madvise(map, map_size, MADV_SEQUENTIAL);
+
+    const uint8_t *data = (const uint8_t *)map, *end = data + map_size;
+    if (memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4)) {
+        close();
+        error = "Not a WAV file";
+        return false;
+    }
+    bool have_format = false;
+    for (const uint8_t *chunk = data + 12; chunk + 8 <= end; ) {
+        uint32_t size = get_le(chunk + 4, 4);
+        const uint8_t *body = chunk + 8;
+        if ((uint32_t)(end - body) < size)
+            size = end - body;
+        if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+            format = get_le(body, 2);
+            channels = get_le(body + 2, 2);
+            rate = get_le(body + 4, 4);
+            bits = get_le(body + 14, 2);
+            // WAVE_FORMAT_EXTENSIBLE, the actual format is in the sub-format GUID
+            if (format == 0xFFFE && size >= 26)
+                format = get_le(body + 24, 2);
+            have_format = true;
+        }
+        else if (!memcmp(chunk, "data", 4) && have_format) {
+            if (!((format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) || (format == 3 && bits == 32)) || channels < 1 || rate < 1) {
+                close();
+                error = "Unsupported WAV format (only 8/16/24/32 bit PCM and 32 bit float are)";
+                return false;
+            }
+            samples = body;
+            frames = size / (channels * (bits / 8));
+            return true;
+        }
+        chunk = body + size + (size & 1);
+    }
+    close();
+    error = "WAV file without audio data";
+    return false;
+}
+
+float wave_file::frame(int ch, uint32_t pos) const
+{
+    if (pos >= frames)
+        return 0.f;
+    int bytes = bits / 8;
+    const uint8_t *p = samples + (pos * channels + ch) * bytes;
+    switch(bits)
+    {
+    case 8:
+        return (p[0] - 128) * (1.0f / 128.0f);
+    case 16:
+        return (int16_t)get_le(p, 2) * (1.0f / 32768.0f);
+    case 24:
+        return ((int32_t)(get_le(p, 3) << 8) >> 8) * (1.0f / 8388608.0f);
+    default:
+        if (format == 3) {
+            union { uint32_t i; float f; } u;
+            u.i = get_le(p, 4);
+            return u.f;
+        }
+        return (int32_t)get_le(p, 4) * (1.0f / 2147483648.0f);
+    }
+}
+
+void wave_file::read(int ch, uint32_t start, uint32_t count, float *out, double ratio) const
+{
+    ch = std::min(ch, channels - 1);
+    if (ratio == 1.0) {
+        for (uint32_t i = 0; i < count; i++)
+            out[i] = frame(ch, start + i);
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        double pos = (start + i) * ratio;
+        uint32_t ipos = (uint32_t)pos;
+        out[i] = lerp(frame(ch, ipos), frame(ch, ipos + 1), (float)(pos - ipos));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+convolution_engine::convolution_engine(const wave_file &ir, uint32_t srate, uint32_t max_length)
+{
+    double ratio = (double)ir.get_rate() / srate;
+    length = std::min<uint32_t>((uint32_t)(ir.get_frames() / ratio), max_length);
+    has_tail = length > TAIL_START;
+    for (int c = 0; c < 2; c++) {
+        channel &C = ch[c];
+        ir_segment fir(ir, c, 0, length, ratio);
+        fir(0, HEAD_BLOCK, C.fir);
+        if (length > HEAD_BLOCK) {
+            ir_segment head(ir, c, HEAD_BLOCK, length, ratio);
+            C.head.set_filter(head, std::min<uint32_t>(length, TAIL_START) - HEAD_BLOCK);
+        }
+        if (has_tail) {
+            ir_segment tail(ir, c, TAIL_START, length, ratio);
+            C.tail.set_filter(tail, length - TAIL_START);
+        }
+    }
+    tail_submitted = tail_done = 0;
+    reset();
+    late_count = 0;
+    sched_copied = false;
+    running = true;
+    sem_init(&job_sem, 0, 0);
+    thread_started = has_tail && pthread_create(&thread, NULL, thread_func, this) == 0;
+    // without the worker, the tail is dropped rather than stalling the audio thread
+    has_tail = thread_started;
+}
+
+convolution_engine::~convolution_engine()
+{
+    if (thread_started) {
+        running = false;
+        sem_post(&job_sem);
+        pthread_join(thread, NULL);
+    }
+    sem_destroy(&job_sem);
+}
+
+void convolution_engine::reset()
+{
+    // let the worker finish the block it may be computing, or it would write
+    // into the cleared buffers and mark a block of the old run as done
+    while(tail_done != tail_submitted)
+        sched_yield();
+    for (int c = 0; c < 2; c++) {
+        channel &C = ch[c];
+        memset(C.head_in, 0, sizeof(C.head_in));
+        memset(C.head_out, 0, sizeof(C.head_out));
+        memset(C.tail_in, 0, sizeof(C.tail_in));
+        memset(C.tail_out, 0, sizeof(C.tail_out));
+        C.head.reset();
+        C.tail.reset();
+    }
+    head_fill = tail_fill = 0;
+    tail_block = 0;
+    tail_valid = false;
+    tail_submitted = tail_done = 0;
+}
+
+void *convolution_engine::thread_func(void *arg)
+{
+    convolution_engine *self = (convolution_engine *)arg;
+    dsp::denormal_guard guard;
+    while(true)
+    {
+        while(sem_wait(&self->job_sem) < 0 && errno == EINTR)
+            ;
+        if (!self->running)
+            break;
+        uint32_t block = self->tail_done;
+        if (block == self->tail_submitted)
+            continue;
+        __sync_synchronize();
+        self->compute_tail(block);
+        __sync_synchronize();
+        self->tail_done = block + 1;
+    }
+    return NULL;
+}
+
+void convolution_engine::compute_tail(uint32_t block)
+{
+    float window[2 * TAIL_BLOCK];
+    for (int c = 0; c < 2; c++) {
+        channel &C = ch[c];
+        memcpy(window, C.tail_in[(block + 2) % 3], sizeof(float) * TAIL_BLOCK);
+        memcpy(window + TAIL_BLOCK, C.tail_in[block % 3], sizeof(float) * TAIL_BLOCK);
+        C.tail.process(window, C.tail_out[block & 1]);
+    }
+}
+
+void convolution_engine::submit_tail()
+{
+    if (!sched_copied) {
+        // the worker has been started by a non-realtime thread; it is less
+        // urgent than the audio thread, but has a deadline all the same
+        int policy;
+        sched_param param;
+        if (!pthread_getschedparam(pthread_self(), &policy, &param) && policy != SCHED_OTHER) {
+            param.sched_priority = std::max(param.sched_priority - 1, sched_get_priority_min(policy));
+            pthread_setschedparam(thread, policy, &param);
+            sched_copied = true;
+        }
+    }
+    __sync_synchronize();
+    tail_submitted = tail_block + 1;
+    sem_post(&job_sem);
+}
+
+void convolution_engine::process(const float *in_left, const float *in_right, float *out_left, float *out_right, uint32_t len)
+{
+    const float *ins[2] = { in_left, in_right };
+    float *outs[2] = { out_left, out_right };
+    for (uint32_t done = 0; done < len; )
+    {
+        uint32_t run = std::min<uint32_t>(len - done, HEAD_BLOCK - head_fill);
+        for (int c = 0; c < 2; c++)
+        {
+            channel &C = ch[c];
+            float *x = C.head_in + HEAD_BLOCK + head_fill;
+            float *tail_in = C.tail_in[tail_block % 3] + tail_fill;
+            for (uint32_t i = 0; i < run; i++)
+                tail_in[i] = x[i] = ins[c][done + i];
+            float y[HEAD_BLOCK];
+            // the tail playing now is the output of the block before the previous one
+            const float *tail_out = C.tail_out[tail_block & 1] + tail_fill;
+            for (uint32_t i = 0; i < run; i++)
+                y[i] = C.head_out[head_fill + i] + (tail_valid ? tail_out[i] : 0.f);
+            // first taps directly, one tap at a time over the whole run
+            for (int k = 0; k < HEAD_BLOCK; k++) {
+                float h = C.fir[k];
+                const float *xk = x - k;
+                for (uint32_t i = 0; i < run; i++)
+                    y[i] += h * xk[i];
+            }
+            for (uint32_t i = 0; i < run; i++)
+                outs[c][done + i] = y[i];
+        }
+        done += run;
+        head_fill += run;
+        tail_fill += run;
+        if (head_fill == HEAD_BLOCK) {
+            for (int c = 0; c < 2; c++) {
+                channel &C = ch[c];
+                C.head.process(C.head_in, C.head_out);
+                memcpy(C.head_in, C.head_in + HEAD_BLOCK, sizeof(float) * HEAD_BLOCK);
+            }
+            head_fill = 0;
+        }
+        if (tail_fill == TAIL_BLOCK) {
+            if (has_tail)
+                submit_tail();
+            tail_block++;
+            tail_fill = 0;
+            if (has_tail && tail_block >= 2) {
+                tail_valid = tail_done >= tail_block - 1;
+                __sync_synchronize();
+                if (!tail_valid)
+                    late_count++;
+            }
+        }
+    }
+}
@@ -22,6 +22,9 @@
 #include <calf/osctl_glib.h>
 #include <calf/preset.h>
 #include <getopt.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace dsp;
@@ -30,27 +33,11 @@ using namespace osctl;
 
 #define debug_printf(...)
 
-struct cairo_params
-{
-    enum { HAS_COLOR = 1, HAS_WIDTH = 2 };
-    uint32_t flags;
-    float r, g, b, a;
-    float line_width;
-    
-    cairo_params()
-    : flags(0)
-    , r(0.f)
-    , g(0.f)
-    , b(0.f)
-    , a(1.f)
-    , line_width(1)
-    {
-    }
-};
-
 struct graph_item: public cairo_params
 {
-    float data[128];
+    float data[LINE_GRAPH_POINTS];
+    /// values as received, the reference for the next change
+    int16_t quantized[LINE_GRAPH_POINTS];
     int mode;
 
     graph_item(int mode_)
@@ -77,6 +64,10 @@ struct param_line_graphs
     vector<gridline_item *> gridlines;
     
     void clear();
+    /// Apply the items of one graph of a packed frame, false on a malformed frame
+    bool unpack(line_graph_packet_reader &r, bool key);
+    template<class Item>
+    static void resize(vector<Item *> &items, size_t count);
 };
 
 void param_line_graphs::clear()
@@ -95,6 +86,87 @@ void param_line_graphs::clear()
 
 }
 
+template<class Item>
+void param_line_graphs::resize(vector<Item *> &items, size_t count)
+{
+    for (size_t i = count; i < items.size(); i++)
+        delete items[i];
+    size_t old_count = items.size();
+    items.resize(count);
+    for (size_t i = old_count; i < count; i++)
+        items[i] = new Item;
+}
+
+bool param_line_graphs::unpack(line_graph_packet_reader &r, bool key)
+{
+    size_t subgraph = 0;
+    while(!r.error)
+    {
+        uint8_t item = r.byte();
+        if (item == LGP_END)
+            break;
+        else if (item == LGP_KEEP_SUBGRAPH)
+        {
+            if (subgraph >= graphs.size())
+                return false;
+            subgraph++;
+        }
+        else if (item == LGP_SUBGRAPH)
+        {
+            if (subgraph > graphs.size())
+                return false;
+            // values are sent as the change from the previous ones, except
+            // in key frames and for new subgraphs
+            bool is_new = key || subgraph == graphs.size();
+            if (subgraph == graphs.size())
+                graphs.push_back(new graph_item(0));
+            graph_item &gi = *graphs[subgraph++];
+            r.params(gi);
+            gi.mode = r.varint();
+            line_graph_curve_codec::decode(r, gi.quantized, is_new ? NULL : gi.quantized);
+            for (int i = 0; i < LINE_GRAPH_POINTS; i++)
+                gi.data[i] = line_graph_curve_codec::dequantize(gi.quantized[i]);
+        }
+        else if (item == LGP_DOTS)
+        {
+            uint32_t count = r.varint();
+            if (count > (uint32_t)(r.end - r.ptr))
+                return false;
+            resize(dots, count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                dot_item &di = *dots[i];
+                r.params(di);
+                di.x = r.f32();
+                di.y = r.f32();
+                di.size = r.varint();
+            }
+        }
+        else if (item == LGP_GRIDLINES)
+        {
+            uint32_t count = r.varint();
+            if (count > (uint32_t)(r.end - r.ptr))
+                return false;
+            resize(gridlines, count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                gridline_item &li = *gridlines[i];
+                r.params(li);
+                li.pos = r.f32();
+                li.vertical = r.varint();
+                r.str(li.text);
+            }
+        }
+        else
+            return false;
+    }
+    // subgraphs not mentioned are gone
+    for (size_t i = subgraph; i < graphs.size(); i++)
+        delete graphs[i];
+    graphs.resize(subgraph);
+    return !r.error;
+}
+
 struct plugin_proxy: public plugin_ctl_iface, public line_graph_iface, public phase_graph_iface
 {
     osc_client *client;
@@ -108,11 +180,14 @@ struct plugin_proxy: public plugin_ctl_iface, public line_graph_iface, public ph
     const plugin_metadata_iface *metadata;
     vector<string> new_status;
     uint32_t new_status_serial;
+    /// Last line graph frame applied, 0 if none (or the graphs are out of sync)
+    uint32_t graph_frame;
     bool is_lv2;
 
     plugin_proxy(const plugin_metadata_iface *md, bool _is_lv2)
     {
         new_status_serial = 0;
+        graph_frame = 0;
         metadata = md;
         client = NULL;
         send_osc = false;
@@ -285,7 +360,7 @@ GMainLoop *mainloop;
 
 static bool osc_debug = false;
 
-struct dssi_osc_server: public osc_glib_server, public osc_message_sink<osc_strstream>, public gui_environment
+struct dssi_osc_server: public osc_glib_server, public osc_message_sink<osc_rawstream>, public gui_environment
 {
     plugin_proxy *plugin;
     plugin_gui_window *window;
@@ -298,6 +373,11 @@ struct dssi_osc_server: public osc_glib_server, public osc_message_sink<osc_strs
     bool osc_link_active;
     /// If we're communicating with the LV2 external UI bridge, use a slightly different protocol
     bool is_lv2;
+    /// Shared memory for line graph frames, used if the plugin runs on the same machine
+    line_graph_shm *shm;
+    string shm_name;
+    /// Copy of the last frame read from shared memory
+    vector<uint8_t> shm_frame;
     
     dssi_osc_server()
     : plugin(NULL)
@@ -307,6 +387,15 @@ struct dssi_osc_server: public osc_glib_server, public osc_message_sink<osc_strs
         source_id = 0;
         osc_link_active = false;
         is_lv2 = false;
+        shm = NULL;
+    }
+    ~dssi_osc_server()
+    {
+        if (shm)
+        {
+            line_graph_shm::unmap(shm);
+            shm_unlink(shm_name.c_str());
+        }
     }
     
     void set_plugin(const char *arg)
@@ -365,17 +454,28 @@ struct dssi_osc_server: public osc_glib_server, public osc_message_sink<osc_strs
     void set_osc_update(bool enabled);
     void send_osc_update();
     
-    virtual void receive_osc_message(std::string address, std::string args, osc_strstream &buffer);
-    void unmarshal_line_graph(osc_strstream &buffer);
+    virtual void receive_osc_message(osc_string_ref address, osc_string_ref args, osc_rawstream &buffer);
+    void apply_line_graph(const uint8_t *data, uint32_t len);
 };
 
 void dssi_osc_server::set_osc_update(bool enabled)
 {
+    if (enabled && !shm)
+    {
+        shm_name = line_graph_shm::NAME_PREFIX + calf_utils::i2s(getpid()) + "-" + calf_utils::i2s(time(NULL));
+        shm = line_graph_shm::map(shm_name.c_str(), true);
+    }
     if (is_lv2)
     {
         osc_inline_typed_strstream data;
         data << ((uint32_t)(enabled ? 1 : 0));
         cli.send("/enable_updates", data);
+        if (enabled && shm)
+        {
+            data.clear();
+            data << shm_name;
+            cli.send("/graph_shm", data);
+        }
     }
     else
     {
@@ -384,6 +484,14 @@ void dssi_osc_server::set_osc_update(bool enabled)
         data << "OSC:FEEDBACK_URI";
         data << (enabled ? get_url() : "");
         cli.send("/configure", data);
+        // a new feedback sender starts with a key frame
+        plugin->graph_frame = 0;
+        if (enabled && shm)
+        {
+            data.clear();
+            data << "OSC:FEEDBACK_SHM" << shm_name;
+            cli.send("/configure", data);
+        }
     }
 }
 
@@ -393,87 +501,51 @@ void dssi_osc_server::send_osc_update()
     if (is_lv2)
         return;
     
-    static int serial_no = 0;
+    // tell the plugin which line graph frame the changes can be relative to
     osc_inline_typed_strstream data;
     data << "OSC:UPDATE";
-    data << calf_utils::i2s(serial_no++);
+    data << calf_utils::i2s(plugin->graph_frame);
     cli.send("/configure", data);
 }
 
-void dssi_osc_server::unmarshal_line_graph(osc_strstream &buffer)
+void dssi_osc_server::apply_line_graph(const uint8_t *data, uint32_t len)
 {
-    uint32_t cmd;
-    
-    do {
-        buffer >> cmd;
-        if (cmd == LGI_GRAPH)
+    line_graph_packet_reader r(data, len);
+    uint32_t frame = r.varint();
+    uint32_t base = r.varint();
+    // changes relative to a frame that was lost or skipped - wait for the
+    // key frame that the plugin sends when the acknowledgement doesn't match
+    if (r.error || (base && base != plugin->graph_frame))
+        return;
+    plugin->graph_frame = frame;
+    while(uint32_t param = r.varint())
+    {
+        if (r.error || !plugin->graphs[param - 1].unpack(r, !base))
         {
-            uint32_t param;
-            buffer >> param;
-            param_line_graphs &graphs = plugin->graphs[param];
-            
-            graphs.clear();
-            cairo_params params;
-
-            do {
-                buffer >> cmd;
-                if (cmd == LGI_SET_RGBA)
-                {
-                    params.flags |= cairo_params::HAS_COLOR;
-                    buffer >> params.r >> params.g >> params.b >> params.a;
-                }
-                else
-                if (cmd == LGI_SET_WIDTH)
-                {
-                    params.flags |= cairo_params::HAS_WIDTH;
-                    buffer >> params.line_width;
-                }
-                else
-                if (cmd == LGI_SUBGRAPH)
-                {
-                    uint32_t mode;
-                    buffer >> mode;
-                    buffer >> param; // ignore number of points
-                    graph_item *gi = new graph_item(mode);
-                    (cairo_params &)*gi = params;
-                    for (int i = 0; i < 128; i++)
-                        buffer >> gi->data[i];
-                    graphs.graphs.push_back(gi);
-                    params.flags = 0;
-                }
-                else
-                if (cmd == LGI_DOT)
-                {
-                    dot_item *di = new dot_item;
-                    (cairo_params &)*di = params;
-                    buffer >> di->x >> di->y >> di->size;
-                    graphs.dots.push_back(di);
-                    params.flags = 0;
-                }
-                else
-                if (cmd == LGI_LEGEND)
-                {
-                    gridline_item *li = new gridline_item;
-                    (cairo_params &)*li = params;
-                    buffer >> li->pos >> li->vertical >> li->text;
-                    graphs.gridlines.push_back(li);
-                    params.flags = 0;
-                }
-                else
-                    break;
-            } while(1);
-            
-        }
-        else
+            plugin->graph_frame = 0;
             break;
-    } while(1);
+        }
+    }
+    if (is_lv2)
+    {
+        osc_inline_typed_strstream ack;
+        ack << plugin->graph_frame;
+        cli.send("/graph_ack", ack);
+    }
 }
 
-void dssi_osc_server::receive_osc_message(std::string address, std::string args, osc_strstream &buffer)
+void dssi_osc_server::receive_osc_message(osc_string_ref address, osc_string_ref args, osc_rawstream &buffer)
 {
     if (osc_debug)
         dump.receive_osc_message(address, args, buffer);
-    if (address == prefix + "/update" && args == "s")
+    // match the part after the prefix, so that no strings are built per message
+    osc_string_ref cmd;
+    if (!address.strip_prefix(prefix, cmd))
+    {
+        printf("Unknown OSC address: %s\n", address.c_str());
+        return;
+    }
+    if (cmd == "/update" && args == "s")
     {
         string str;
         buffer >> str;
@@ -482,14 +554,14 @@ void dssi_osc_server::receive_osc_message(std::string address, std::string args,
         send_osc_update();
         return;
     }
-    else if (address == prefix + "/quit")
+    else if (cmd == "/quit")
     {
         set_osc_update(false);
         debug_printf("QUIT\n");
         g_main_loop_quit(mainloop);
         return;
     }
-    else if (address == prefix + "/configure"&& args == "ss")
+    else if (cmd == "/configure"&& args == "ss")
     {
         string key, value;
         buffer >> key >> value;
@@ -500,7 +572,7 @@ void dssi_osc_server::receive_osc_message(std::string address, std::string args,
         window->gui->refresh();
         return;
     }
-    else if (address == prefix + "/program"&& args == "ii")
+    else if (cmd == "/program"&& args == "ii")
     {
         uint32_t bank, program;
         
@@ -532,7 +604,7 @@ void dssi_osc_server::receive_osc_message(std::string address, std::string args,
         // cli.send("/update", data);
         return;
     }
-    else if (address == prefix + "/control" && args == "if")
+    else if (cmd == "/control" && args == "if")
     {
         uint32_t port;
         float val;
@@ -549,23 +621,36 @@ void dssi_osc_server::receive_osc_message(std::string address, std::string args,
             plugin->update_graphs = true;
         return;
     }
-    else if (address == prefix + "/show")
+    else if (cmd == "/show")
     {
         set_osc_update(true);
 
         gtk_widget_show(GTK_WIDGET(window->toplevel));
         return;
     }
-    else if (address == prefix + "/hide")
+    else if (cmd == "/hide")
     {
         set_osc_update(false);
 
         gtk_widget_hide(GTK_WIDGET(window->toplevel));
         return;
     }
-    else if (address == prefix + "/lineGraph")
+    else if ((cmd == "/lineGraphPacked" && args == "b") || cmd == "/lineGraphShm")
     {
-        unmarshal_line_graph(buffer);
+        if (cmd == "/lineGraphShm")
+        {
+            if (!shm || !shm->read(shm_frame) || shm_frame.empty())
+                return;
+            apply_line_graph(&shm_frame[0], shm_frame.size());
+        }
+        else
+        {
+            const uint8_t *data;
+            uint32_t len;
+            if (!buffer.buffer.read_blob(data, len))
+                return;
+            apply_line_graph(data, len);
+        }
         if (plugin->update_graphs) {
             // updates graphs that are only redrawn on startup and parameter changes
             // (the OSC message may come a while after the parameter has been changed,
@@ -575,7 +660,7 @@ void dssi_osc_server::receive_osc_message(std::string address, std::string args,
         }
         return;
     }
-    else if (address == prefix + "/status_data" && (args.length() & 1) && args[args.length() - 1] == 'i')
+    else if (cmd == "/status_data" && (args.length() & 1) && args[args.length() - 1] == 'i')
     {
         int len = (int)args.length();
         plugin->new_status.clear();
@@ -19,7 +19,11 @@
  * Boston, MA  02110-1301  USA
  */
 #include <config.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <calf/giface.h>
 #include <calf/osctlnet.h>
 #include <calf/utils.h>
@@ -212,6 +216,96 @@ const char *calf_plugins::load_gui_xml(const std::string &plugin_id)
     }
 }
 
+void biquad_response::add(float a0, float a1, float a2, float b1, float b2)
+{
+    assert(key.sections < MAX_SECTIONS);
+    float *c = key.coeffs[key.sections++];
+    c[0] = a0, c[1] = a1, c[2] = a2, c[3] = b1, c[4] = b2;
+}
+
+bool biquad_response::same_as_cached() const
+{
+    return cached && key.points == cached_key.points && key.sections == cached_key.sections
+        && key.srate == cached_key.srate && key.res == cached_key.res && key.ofs == cached_key.ofs
+        && !memcmp(key.coeffs, cached_key.coeffs, key.sections * sizeof(key.coeffs[0]));
+}
+
+/// With s = sin^2(w/2), |a0 + a1 z^-1 + a2 z^-2|^2 on the unit circle is
+/// (a0 + a1 + a2)^2 - 4s(a0a1 + a1a2 + 4a0a2) + 16a0a2 s^2. Unlike the
+/// direct evaluation, this doesn't lose precision near DC, where the
+/// poles of low frequency filters are.
+static inline void response_poly(double a0, double a1, double a2, float k[3])
+{
+    k[0] = (a0 + a1 + a2) * (a0 + a1 + a2);
+    k[1] = -4 * (a0 * a1 + a1 * a2 + 4 * a0 * a2);
+    k[2] = 16 * a0 * a2;
+}
+
+bool biquad_response::get_graph(float *data, int points, float srate, float res, float ofs)
+{
+    key.points = points;
+    key.srate = srate;
+    key.res = res;
+    key.ofs = ofs;
+    if (same_as_cached()) {
+        memcpy(data, &curve[0], points * sizeof(float));
+        return true;
+    }
+    // padded to a multiple of 4
+    int padded = (points + 3) & ~3;
+    if (points != grid_points || srate != grid_srate) {
+        grid.resize(padded);
+        double freq = 20.0, step = pow(20000.0 / 20.0, 1.0 / points);
+        for (int i = 0; i < padded; i++, freq *= step) {
+            double s = sin(M_PI * freq / srate);
+            grid[i] = s * s;
+        }
+        grid_points = points;
+        grid_srate = srate;
+        curve.resize(padded);
+        power.resize(padded);
+    }
+    // squared magnitude, section by section
+    float *p = &power[0];
+    const float *g = &grid[0];
+    for (int i = 0; i < padded; i++)
+        p[i] = 1.f;
+    for (int j = 0; j < key.sections; j++)
+    {
+        const float *c = key.coeffs[j];
+        float kn[3], kd[3];
+        response_poly(c[0], c[1], c[2], kn);
+        response_poly(1.0, c[3], c[4], kd);
+#ifdef __SSE__
+        __m128 n0 = _mm_set1_ps(kn[0]), n1 = _mm_set1_ps(kn[1]), n2 = _mm_set1_ps(kn[2]);
+        __m128 d0 = _mm_set1_ps(kd[0]), d1 = _mm_set1_ps(kd[1]), d2 = _mm_set1_ps(kd[2]);
+        for (int i = 0; i < padded; i += 4) {
+            __m128 s = _mm_loadu_ps(g + i);
+            __m128 vn = _mm_add_ps(n0, _mm_mul_ps(s, _mm_add_ps(n1, _mm_mul_ps(s, n2))));
+            __m128 vd = _mm_add_ps(d0, _mm_mul_ps(s, _mm_add_ps(d1, _mm_mul_ps(s, d2))));
+            _mm_storeu_ps(p + i, _mm_mul_ps(_mm_loadu_ps(p + i), _mm_div_ps(vn, vd)));
+        }
+#else
+        for (int i = 0; i < padded; i++) {
+            float s = g[i];
+            p[i] *= (kn[0] + s * (kn[1] + s * kn[2])) / (kd[0] + s * (kd[1] + s * kd[2]));
+        }
+#endif
+    }
+    // dB_grid of the magnitude, from the squared magnitude
+    float scale = 0.5 / log(res);
+    for (int i = 0; i < points; i++)
+        data[i] = curve[i] = log(p[i]) * scale + ofs;
+    cached_key.points = key.points;
+    cached_key.sections = key.sections;
+    cached_key.srate = key.srate;
+    cached_key.res = key.res;
+    cached_key.ofs = key.ofs;
+    memcpy(cached_key.coeffs, key.coeffs, key.sections * sizeof(key.coeffs[0]));
+    cached = true;
+    return true;
+}
+
 bool calf_plugins::get_freq_gridline(int subindex, float &pos, bool &vertical, std::string &legend, cairo_iface *context, bool use_frequencies, float res, float ofs)
 {
     if (subindex < 0 )
@@ -382,68 +476,145 @@ uint32_t mod_matrix_metadata::get_table_rows() const
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
-#if USE_EXEC_GUI
-struct osc_cairo_control: public cairo_iface
+#if USE_EXEC_GUI || USE_DSSI
+
+void line_graph_packet_writer::params(const cairo_params &p)
 {
-    osctl::osc_inline_typed_strstream os;
-    
-    osc_cairo_control() {}
-    virtual void set_source_rgba(float r, float g, float b, float a = 1.f)
+    byte(p.flags);
+    if (p.flags & cairo_params::HAS_COLOR)
     {
-        os << (uint32_t)LGI_SET_RGBA << r << g << b << a;
+        f32(p.r);
+        f32(p.g);
+        f32(p.b);
+        f32(p.a);
     }
-    virtual void set_line_width(float width)
+    if (p.flags & cairo_params::HAS_WIDTH)
+        f32(p.line_width);
+}
+
+void line_graph_packet_reader::params(cairo_params &p)
+{
+    p = cairo_params();
+    p.flags = byte() & (cairo_params::HAS_COLOR | cairo_params::HAS_WIDTH);
+    if (p.flags & cairo_params::HAS_COLOR)
     {
-        os << (uint32_t)LGI_SET_WIDTH << width;
+        p.r = f32();
+        p.g = f32();
+        p.b = f32();
+        p.a = f32();
     }
-};
+    if (p.flags & cairo_params::HAS_WIDTH)
+        p.line_width = f32();
+}
 
-static void serialize_graphs(osc_cairo_control *cairoctl, osctl::osc_inline_typed_strstream &os, const line_graph_iface *graph, std::vector<int> &params)
+void line_graph_curve_codec::encode(line_graph_packet_writer &w, const int16_t *q, const int16_t *ref)
 {
-    for (size_t i = 0; i < params.size(); i++)
+    int32_t last = 0;
+    for (int i = 0; i < LINE_GRAPH_POINTS; i++)
     {
-        int index = params[i];
-        os << (uint32_t)LGI_GRAPH;
-        os << (uint32_t)index;
-        for (int j = 0; ; j++)
-        {
-            int mode = 0;
-            float data[128];
-            if (graph->get_graph(index, j, data, 128, cairoctl, &mode))
-            {
-                os << (uint32_t)LGI_SUBGRAPH;
-                os << (uint32_t)mode;
-                os << (uint32_t)128;
-                for (int p = 0; p < 128; p++)
-                    os << data[p];
-            }
-            else
-                break;
-        }
-        for (int j = 0; ; j++)
-        {
-            float x, y;
-            int size = 3;
-            if (graph->get_dot(index, j, x, y, size, cairoctl))
-                os << (uint32_t)LGI_DOT << x << y << (uint32_t)size;
-            else
-                break;
-        }
-        for (int j = 0; ; j++)
-        {
-            float pos = 0;
-            bool vertical = false;
-            string legend;
-            if (graph->get_gridline(index, j, pos, vertical, legend, cairoctl))
-                os << (uint32_t)LGI_LEGEND << pos << (uint32_t)(vertical ? 1 : 0) << legend;
-            else
-                break;
-        }
-        os << (uint32_t)LGI_END_ITEM;
+        int32_t change = q[i] - (ref ? ref[i] : 0);
+        w.zigzag(change - last);
+        last = change;
+    }
+}
+
+void line_graph_curve_codec::decode(line_graph_packet_reader &r, int16_t *q, const int16_t *ref)
+{
+    int32_t change = 0;
+    for (int i = 0; i < LINE_GRAPH_POINTS; i++)
+    {
+        change += r.zigzag();
+        q[i] = (int16_t)((ref ? ref[i] : 0) + change);
     }
-    os << (uint32_t)LGI_END;
 }
 
+const char line_graph_shm::NAME_PREFIX[] = "/calf-graphs-";
+
+line_graph_shm *line_graph_shm::map(const char *name, bool create)
+{
+    if (strncmp(name, NAME_PREFIX, sizeof(NAME_PREFIX) - 1) || strchr(name + 1, '/'))
+        return NULL;
+    int fd = shm_open(name, create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (create ? ftruncate(fd, sizeof(line_graph_shm)) < 0 : (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(line_graph_shm)))
+    {
+        close(fd);
+        if (create)
+            shm_unlink(name);
+        return NULL;
+    }
+    void *ptr = mmap(NULL, sizeof(line_graph_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        if (create)
+            shm_unlink(name);
+        return NULL;
+    }
+    line_graph_shm *shm = (line_graph_shm *)ptr;
+    if (create)
+        shm->magic = MAGIC;
+    else
+    if (shm->magic != MAGIC)
+    {
+        unmap(shm);
+        return NULL;
+    }
+    return shm;
+}
+
+void line_graph_shm::unmap(line_graph_shm *shm)
+{
+    munmap(shm, sizeof(line_graph_shm));
+}
+
+void line_graph_shm::write(const uint8_t *src, uint32_t len)
+{
+    sequence++;
+    __sync_synchronize();
+    memcpy(data, src, len);
+    length = len;
+    __sync_synchronize();
+    sequence++;
+}
+
+bool line_graph_shm::read(std::vector<uint8_t> &dest) const
+{
+    uint32_t seq = sequence;
+    if (!seq || (seq & 1))
+        return false;
+    __sync_synchronize();
+    uint32_t len = std::min<uint32_t>(length, CAPACITY);
+    dest.assign(data, data + len);
+    __sync_synchronize();
+    return sequence == seq;
+}
+
+#endif
+
+#if USE_EXEC_GUI
+/// Collects the attributes set while a graph item is being obtained
+struct cairo_params_recorder: public cairo_iface
+{
+    cairo_params params;
+    
+    virtual void set_source_rgba(float r, float g, float b, float a = 1.f)
+    {
+        params.flags |= cairo_params::HAS_COLOR;
+        params.r = r;
+        params.g = g;
+        params.b = b;
+        params.a = a;
+    }
+    virtual void set_line_width(float width)
+    {
+        params.flags |= cairo_params::HAS_WIDTH;
+        params.line_width = width;
+    }
+};
+
 calf_plugins::dssi_feedback_sender::dssi_feedback_sender(const char *URI, const line_graph_iface *_graph)
 {
     graph = _graph;
@@ -451,7 +622,9 @@ calf_plugins::dssi_feedback_sender::dssi_feedback_sender(const char *URI, const
     client = new osctl::osc_client;
     client->bind("0.0.0.0", 0);
     client->set_url(URI);
-    _context = NULL;
+    frame = acked_frame = 0;
+    shm = NULL;
+    _context = new cairo_params_recorder;
 }
 
 calf_plugins::dssi_feedback_sender::dssi_feedback_sender(osctl::osc_client *_client, const line_graph_iface *_graph)
@@ -459,7 +632,9 @@ calf_plugins::dssi_feedback_sender::dssi_feedback_sender(osctl::osc_client *_cli
     graph = _graph;
     client = _client;
     is_client_shared = true;
-    _context = NULL;
+    frame = acked_frame = 0;
+    shm = NULL;
+    _context = new cairo_params_recorder;
 }
 
 void calf_plugins::dssi_feedback_sender::add_graphs(const calf_plugins::parameter_properties *props, int num_params)
@@ -469,29 +644,158 @@ void calf_plugins::dssi_feedback_sender::add_graphs(const calf_plugins::paramete
         if (props[i].flags & PF_PROP_GRAPH)
             indices.push_back(i);
     }
+    sent.resize(indices.size());
+}
+
+void calf_plugins::dssi_feedback_sender::attach_shm(const char *name)
+{
+    if (shm)
+        line_graph_shm::unmap(shm);
+    shm = (name && *name) ? line_graph_shm::map(name, false) : NULL;
 }
 
 void calf_plugins::dssi_feedback_sender::update()
 {
-    if (graph)
+    if (!graph)
+        return;
+    cairo_params_recorder *recorder = (cairo_params_recorder *)_context;
+    // changes can only be sent relative to what the GUI has applied
+    bool key = !frame || acked_frame != frame;
+    bool changed = key;
+    packet.clear();
+    packet.varint(frame + 1);
+    packet.varint(key ? 0 : frame);
+    float data[LINE_GRAPH_POINTS];
+    int16_t q[LINE_GRAPH_POINTS];
+    string legend;
+    for (size_t i = 0; i < indices.size(); i++)
     {
-        osc_cairo_control* cairoctl;
-        if (_context)
+        int index = indices[i];
+        graph_state &gs = sent[i];
+        int changed_graph, changed_dot, changed_gridline;
+        int generation = graph->get_changed_offsets(index, gs.generation, changed_graph, changed_dot, changed_gridline);
+        // subgraphs before changed_graph are the same as for the previous
+        // generation, there's no need to even obtain them
+        if (key || generation != gs.generation)
+            changed_graph = 0;
+        gs.generation = generation;
+        packet.varint(index + 1);
+        
+        int count = key ? 0 : (int)gs.modes.size(), j;
+        for (j = 0; ; j++)
+        {
+            if (j < changed_graph && j < count)
+            {
+                packet.byte(LGP_KEEP_SUBGRAPH);
+                continue;
+            }
+            int mode = 0;
+            recorder->params = cairo_params();
+            if (!graph->get_graph(index, j, data, LINE_GRAPH_POINTS, recorder, &mode))
+                break;
+            for (int p = 0; p < LINE_GRAPH_POINTS; p++)
+                q[p] = line_graph_curve_codec::quantize(data[p]);
+            if (j >= (int)gs.modes.size())
+            {
+                gs.modes.push_back(-1);
+                gs.params.push_back(cairo_params());
+                gs.curves.resize(gs.curves.size() + LINE_GRAPH_POINTS);
+            }
+            int16_t *last = &gs.curves[j * LINE_GRAPH_POINTS];
+            if (j < count && gs.modes[j] == mode && gs.params[j] == recorder->params && !memcmp(last, q, sizeof(q)))
+            {
+                packet.byte(LGP_KEEP_SUBGRAPH);
+                continue;
+            }
+            packet.byte(LGP_SUBGRAPH);
+            packet.params(recorder->params);
+            packet.varint(mode);
+            line_graph_curve_codec::encode(packet, q, j < count ? last : NULL);
+            gs.modes[j] = mode;
+            gs.params[j] = recorder->params;
+            memcpy(last, q, sizeof(q));
+            changed = true;
+        }
+        if (j != (int)gs.modes.size())
         {
-            cairoctl = (osc_cairo_control*)_context;
-            cairoctl->os.clear();
+            gs.modes.resize(j);
+            gs.params.resize(j);
+            gs.curves.resize(j * LINE_GRAPH_POINTS);
+            changed = true;
         }
-        else
-            cairoctl = new osc_cairo_control();
-        serialize_graphs(cairoctl, cairoctl->os, graph, indices);
-        client->send("/lineGraph", cairoctl->os);
+        
+        items.clear();
+        for (j = 0; ; j++)
+        {
+            float x, y;
+            int size = 3;
+            recorder->params = cairo_params();
+            if (!graph->get_dot(index, j, x, y, size, recorder))
+                break;
+            items.params(recorder->params);
+            items.f32(x);
+            items.f32(y);
+            items.varint(size);
+        }
+        if (key || items.data != gs.dots)
+        {
+            packet.byte(LGP_DOTS);
+            packet.varint(j);
+            packet.data.insert(packet.data.end(), items.data.begin(), items.data.end());
+            gs.dots = items.data;
+            changed = true;
+        }
+        
+        items.clear();
+        for (j = 0; ; j++)
+        {
+            float pos = 0;
+            bool vertical = false;
+            legend.clear();
+            recorder->params = cairo_params();
+            if (!graph->get_gridline(index, j, pos, vertical, legend, recorder))
+                break;
+            items.params(recorder->params);
+            items.f32(pos);
+            items.varint(vertical ? 1 : 0);
+            items.str(legend);
+        }
+        if (key || items.data != gs.gridlines)
+        {
+            packet.byte(LGP_GRIDLINES);
+            packet.varint(j);
+            packet.data.insert(packet.data.end(), items.data.begin(), items.data.end());
+            gs.gridlines = items.data;
+            changed = true;
+        }
+        packet.byte(LGP_END);
+    }
+    packet.varint(0);
+    // nothing to tell the GUI - don't use up a frame number either, so that
+    // its acknowledgement of the last frame stays valid
+    if (!changed)
+        return;
+    frame++;
+    
+    if (shm && packet.data.size() <= line_graph_shm::CAPACITY)
+    {
+        shm->write(&packet.data[0], packet.data.size());
+        client->send("/lineGraphShm");
+    }
+    else
+    {
+        osctl::osc_inline_typed_strstream os;
+        osctl::raw_buffer buf(&packet.data[0], packet.data.size(), packet.data.size());
+        os << buf;
+        client->send("/lineGraphPacked", os);
     }
 }
 
 calf_plugins::dssi_feedback_sender::~dssi_feedback_sender()
 {
-    if (_context)
-        delete (osc_cairo_control*)_context;
+    if (shm)
+        line_graph_shm::unmap(shm);
+    delete (cairo_params_recorder *)_context;
     if (!is_client_shared)
         delete client;
 }
@@ -455,6 +455,10 @@ void host_session::signal_handler(int signum)
 
 void host_session::on_idle()
 {
+    // connections have changed - until the dependency graph is rebuilt, plugins are processed serially
+    if (client.is_schedule_stale())
+        client.update_schedule();
+
     if (save_file_on_next_idle_call)
     {
         save_file_on_next_idle_call = false;
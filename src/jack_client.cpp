@@ -21,9 +21,12 @@
 
 #include <stdint.h>
 #include <jack/jack.h>
+#include <jack/thread.h>
 #include <calf/giface.h>
 #include <calf/jackhost.h>
 #include <set>
+#include <sched.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace calf_utils;
@@ -37,12 +40,17 @@ jack_client::jack_client()
     midi_name = "midi_%d";
     sample_rate = 0;
     client = NULL;
+    thread_count = -1;
+    graph_version = 0;
+    process_epoch = 0;
+    snapshot = new plugin_snapshot;
 }
 
 void jack_client::add(jack_host *plugin)
 {
     calf_utils::ptlock lock(mutex);
     plugins.push_back(plugin);
+    publish_snapshot();
 }
 
 void jack_client::del(jack_host *plugin)
@@ -53,6 +61,8 @@ void jack_client::del(jack_host *plugin)
         if (plugins[i] == plugin)
         {
             plugins.erase(plugins.begin()+i);
+            // after this, the process callback doesn't use the plugin anymore
+            publish_snapshot();
             return;
         }
     }
@@ -68,6 +78,7 @@ void jack_client::open(const char *client_name)
     sample_rate = jack_get_sample_rate(client);
     jack_set_process_callback(client, do_jack_process, this);
     jack_set_buffer_size_callback(client, do_jack_bufsize, this);
+    jack_set_graph_order_callback(client, do_jack_graph_order, this);
     name = get_name();
 }
 
@@ -78,12 +89,18 @@ std::string jack_client::get_name()
 
 void jack_client::activate()
 {
+    // the worker pool must not change while the process callback may use it
+    int threads = thread_count;
+    if (threads < 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    executor.start(client, threads);
     jack_activate(client);        
 }
 
 void jack_client::deactivate()
 {
     jack_deactivate(client);        
+    executor.stop();
 }
 
 void jack_client::connect(const std::string &p1, const std::string &p2)
@@ -95,6 +112,8 @@ void jack_client::connect(const std::string &p1, const std::string &p2)
 void jack_client::close()
 {
     jack_client_close(client);
+    delete snapshot;
+    snapshot = new plugin_snapshot;
 }
 
 const char **jack_client::get_ports(const char *name_re, const char *type_re, unsigned long flags)
@@ -105,12 +124,25 @@ const char **jack_client::get_ports(const char *name_re, const char *type_re, un
 int jack_client::do_jack_process(jack_nframes_t nframes, void *p)
 {
     jack_client *self = (jack_client *)p;
-    pttrylock lock(self->mutex);
-    if (lock.is_locked())
+    __sync_fetch_and_add(&self->process_epoch, 1);
+    plugin_snapshot *snapshot = self->snapshot;
+    // the schedule is only used if it's up to date with the connections, otherwise
+    // fall back to the serial order until update_schedule is called
+    if (self->executor.get_thread_count() && snapshot->plugins.size() > 1 && snapshot->schedule.version == self->graph_version)
+        self->executor.run(snapshot->schedule, nframes);
+    else
     {
-        for(unsigned int i = 0; i < self->plugins.size(); i++)
-            self->plugins[i]->process(nframes);
+        for(unsigned int i = 0; i < snapshot->plugins.size(); i++)
+            snapshot->plugins[i]->process(nframes);
     }
+    __sync_fetch_and_add(&self->process_epoch, 1);
+    return 0;
+}
+
+int jack_client::do_jack_graph_order(void *p)
+{
+    jack_client *self = (jack_client *)p;
+    __sync_fetch_and_add(&self->graph_version, 1);
     return 0;
 }
 
@@ -126,16 +158,17 @@ int jack_client::do_jack_bufsize(jack_nframes_t numsamples, void *p)
 void jack_client::delete_plugins()
 {
     ptlock lock(mutex);
-    for (unsigned int i = 0; i < plugins.size(); i++) {
-        delete plugins[i];
+    vector<jack_host *> old_plugins;
+    old_plugins.swap(plugins);
+    publish_snapshot();
+    for (unsigned int i = 0; i < old_plugins.size(); i++) {
+        delete old_plugins[i];
     }
-    plugins.clear();
 }
 
-void jack_client::calculate_plugin_order(std::vector<int> &indices)
+void jack_client::get_plugin_dependencies(const std::vector<jack_host *> &plugins, std::multimap<int, int> &run_before)
 {
     map<string, int> port_to_plugin;
-    multimap<int, int> run_before;
     for (unsigned int i = 0; i < plugins.size(); i++)
     {
         vector<jack_host::port *> ports;
@@ -169,6 +202,12 @@ void jack_client::calculate_plugin_order(std::vector<int> &indices)
             jack_free(conns);
         }
     }
+}
+
+void jack_client::calculate_plugin_order(std::vector<int> &indices)
+{
+    multimap<int, int> run_before;
+    get_plugin_dependencies(plugins, run_before);
     
     struct deptracker
     {
@@ -210,6 +249,7 @@ void jack_client::apply_plugin_order(const std::vector<int> &indices)
         plugins_new.push_back(plugins[indices[i]]);
     ptlock lock(mutex);
     plugins.swap(plugins_new);
+    publish_snapshot();
     
     string s;
     for (unsigned int i = 0; i < plugins.size(); i++)    
@@ -221,3 +261,181 @@ void jack_client::apply_plugin_order(const std::vector<int> &indices)
     printf("Order: %s\n", s.c_str());
 }
 
+
+void jack_client::update_schedule()
+{
+    ptlock lock(mutex);
+    publish_snapshot();
+}
+
+void jack_client::publish_snapshot()
+{
+    // a change of connections while this is running will make the new schedule stale right away
+    int version = __sync_add_and_fetch(&graph_version, 1);
+    plugin_snapshot *new_snapshot = new plugin_snapshot;
+    new_snapshot->plugins = plugins;
+    plugin_schedule &schedule = new_snapshot->schedule;
+    multimap<int, int> run_before;
+    get_plugin_dependencies(plugins, run_before);
+    schedule.nodes.resize(plugins.size());
+    for (unsigned int i = 0; i < plugins.size(); i++)
+    {
+        schedule.nodes[i].plugin = plugins[i];
+        schedule.nodes[i].dependencies = 0;
+    }
+    // Any two connected plugins are run in the same order as in the serial case, so that
+    // feedback loops work the same way (with one period of delay).
+    set<pair<int, int> > edges;
+    for (multimap<int, int>::const_iterator i = run_before.begin(); i != run_before.end(); i++)
+    {
+        if (i->first == i->second)
+            continue;
+        int first = std::min(i->first, i->second), second = std::max(i->first, i->second);
+        if (!edges.insert(make_pair(first, second)).second)
+            continue;
+        schedule.nodes[first].successors.push_back(second);
+        schedule.nodes[second].dependencies++;
+    }
+    schedule.ready.resize(schedule.nodes.size(), -1);
+    schedule.version = version;
+    
+    plugin_snapshot *old_snapshot = snapshot;
+    __sync_synchronize();
+    snapshot = new_snapshot;
+    __sync_synchronize();
+    // Grace period: if the process callback is running right now, it may have picked the old
+    // snapshot, so wait until it's done. Any later run will see the new one.
+    unsigned int epoch = process_epoch;
+    if (epoch & 1)
+    {
+        while(process_epoch == epoch)
+            usleep(1000);
+    }
+    delete old_snapshot;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void plugin_schedule::reset()
+{
+    for (unsigned int i = 0; i < nodes.size(); i++)
+    {
+        nodes[i].remaining = nodes[i].dependencies;
+        ready[i] = -1;
+    }
+    ready_head = ready_tail = 0;
+    completed = 0;
+    __sync_synchronize();
+    for (unsigned int i = 0; i < nodes.size(); i++)
+    {
+        if (!nodes[i].dependencies)
+            push(i);
+    }
+}
+
+jack_executor::jack_executor()
+{
+    client = NULL;
+    active = 0;
+    worker_count = 0;
+    quit = false;
+    schedule = NULL;
+    nframes = 0;
+    sem_init(&start_sem, 0, 0);
+}
+
+void jack_executor::start(jack_client_t *_client, int thread_count)
+{
+    client = _client;
+    quit = false;
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_t thread;
+        if (jack_client_create_thread(client, &thread, jack_client_real_time_priority(client), jack_is_realtime(client), thread_func, this))
+        {
+            fprintf(stderr, "Could not create processing thread, using %d extra thread(s)\n", i);
+            break;
+        }
+        threads.push_back(thread);
+    }
+    worker_count = threads.size();
+}
+
+void jack_executor::stop()
+{
+    worker_count = 0;
+    quit = true;
+    for (unsigned int i = 0; i < threads.size(); i++)
+        sem_post(&start_sem);
+    for (unsigned int i = 0; i < threads.size(); i++)
+        pthread_join(threads[i], NULL);
+    threads.clear();
+}
+
+void *jack_executor::thread_func(void *arg)
+{
+    jack_executor *self = (jack_executor *)arg;
+    while(true)
+    {
+        while(sem_wait(&self->start_sem) < 0 && errno == EINTR)
+            ;
+        if (self->quit)
+            break;
+        self->run_nodes();
+        __sync_fetch_and_sub(&self->active, 1);
+    }
+    return NULL;
+}
+
+void jack_executor::run_nodes()
+{
+    plugin_schedule &sched = *schedule;
+    int count = sched.nodes.size();
+    int idle = 0;
+    while(sched.completed < count)
+    {
+        int n = sched.pop();
+        if (n == -1)
+        {
+            // let other threads run if there are more threads than free CPUs
+            if (++idle >= 64)
+            {
+                sched_yield();
+                idle = 0;
+            }
+            continue;
+        }
+        idle = 0;
+        plugin_schedule::node &node = sched.nodes[n];
+        node.plugin->process(nframes);
+        for (unsigned int i = 0; i < node.successors.size(); i++)
+        {
+            int s = node.successors[i];
+            if (__sync_sub_and_fetch(&sched.nodes[s].remaining, 1) == 0)
+                sched.push(s);
+        }
+        __sync_fetch_and_add(&sched.completed, 1);
+    }
+}
+
+void jack_executor::run(plugin_schedule &_schedule, jack_nframes_t _nframes)
+{
+    schedule = &_schedule;
+    nframes = _nframes;
+    schedule->reset();
+    int workers = worker_count;
+    active = workers;
+    __sync_synchronize();
+    for (int i = 0; i < workers; i++)
+        sem_post(&start_sem);
+    run_nodes();
+    // barrier - the workers may still be looking at the schedule
+    while(active)
+        sched_yield();
+}
+
+jack_executor::~jack_executor()
+{
+    stop();
+    sem_destroy(&start_sem);
+}
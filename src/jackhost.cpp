@@ -64,12 +64,14 @@ jack_host::jack_host(audio_module_iface *_module, const std::string &_name, cons
     }
     clear_preset();
     midi_meter = 0;
+    telemetry = telemetry_plane::create(metadata);
     module->set_progress_report_iface(_priface);
     module->post_instantiate();
 }
 
 jack_host::~jack_host()
 {
+    delete telemetry;
     delete []param_values;
     if (client)
         destroy();
@@ -250,6 +252,8 @@ int jack_host::process(jack_nframes_t nframes)
         }
     }
     process_part(time, nframes - time);
+    if (telemetry)
+        telemetry->publish(params, nframes);
     module->params_reset();
     return 0;
 }
@@ -284,7 +288,7 @@ void jack_host::get_all_output_ports(std::vector<port *> &ports)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static const char *short_options = "c:i:l:o:m:M:s:ehv";
+static const char *short_options = "c:i:l:o:m:M:s:t:ehv";
 
 static struct option long_options[] = {
     {"help", 0, 0, 'h'},
@@ -296,6 +300,7 @@ static struct option long_options[] = {
     {"output", 1, 0, 'o'},
     {"state", 1, 0, 's'},
     {"connect-midi", 1, 0, 'M'},
+    {"threads", 1, 0, 't'},
     {0,0,0,0},
 };
 
@@ -303,7 +308,8 @@ void print_help(char *argv[])
 {
     printf("JACK host for Calf effects\n"
         "Syntax: %s [--client <name>] [--input <name>] [--output <name>] [--midi <name>] [--load|state <session>]\n"
-        "       [--connect-midi <name|capture-index>] [--help] [--version] [!] pluginname[:<preset>] [!] ...\n", 
+        "       [--connect-midi <name|capture-index>] [--threads <count>] [--help] [--version] [!] pluginname[:<preset>] [!] ...\n"
+        "--threads sets the number of extra threads for processing independent plugins (default: CPU count - 1)\n", 
         argv[0]);
 }
 
@@ -383,6 +389,9 @@ int main(int argc, char *argv[])
                 else
                     sess.autoconnect_midi = string(optarg);
                 break;
+            case 't':
+                sess.client.thread_count = atoi(optarg);
+                break;
         }
     }
     while(optind < argc) {
@@ -347,7 +347,7 @@ const void *gui_extension(const char *uri)
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
-class ext_plugin_gui: public LV2_External_UI_Widget, public plugin_proxy_base, public osc_message_sink<osc_strstream>, public send_updates_iface
+class ext_plugin_gui: public LV2_External_UI_Widget, public plugin_proxy_base, public osc_message_sink<osc_rawstream>, public send_updates_iface
 {
 public:
     GPid child_pid;
@@ -380,7 +380,7 @@ public:
     }
 
     virtual void send_status(const char *key, const char *value);
-    virtual void receive_osc_message(std::string address, std::string args, osc_strstream &buffer);
+    virtual void receive_osc_message(osc_string_ref address, osc_string_ref args, osc_rawstream &buffer);
     virtual ~ext_plugin_gui();
         
 private:
@@ -481,7 +481,7 @@ void ext_plugin_gui::run_impl()
         feedback_sender->update();
 }
 
-void ext_plugin_gui::receive_osc_message(std::string address, std::string args, osc_strstream &buffer)
+void ext_plugin_gui::receive_osc_message(osc_string_ref address, osc_string_ref args, osc_rawstream &buffer)
 {
     if (address == "/bridge/update" && args == "s")
     {
@@ -520,6 +520,22 @@ void ext_plugin_gui::receive_osc_message(std::string address, std::string args,
             feedback_sender->update();
     }
     else
+    if (address == "/bridge/graph_ack" && args == "i")
+    {
+        uint32_t frame;
+        buffer >> frame;
+        if (feedback_sender)
+            feedback_sender->acked_frame = frame;
+    }
+    else
+    if (address == "/bridge/graph_shm" && args == "s")
+    {
+        string name;
+        buffer >> name;
+        if (feedback_sender)
+            feedback_sender->attach_shm(name.c_str());
+    }
+    else
     if (address == "/bridge/configure" && (args == "s" || args == "ss"))
     {
         string key, value;
@@ -22,6 +22,9 @@
 #include <calf/utils.h>
 #include <memory.h>
 #include <sstream>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 using namespace std;
 using namespace dsp;
@@ -35,6 +38,107 @@ mod_matrix_impl::mod_matrix_impl(dsp::modulation_entry *_matrix, mod_matrix_meta
     matrix_rows = metadata->get_table_rows();
     for (unsigned int i = 0; i < matrix_rows; i++)
         matrix[i].reset();
+    for (int i = 0; i < 3; i++)
+    {
+        compiled.slot(i).rows.resize(matrix_rows);
+        compiled.slot(i).count = 0;
+    }
+}
+
+void mod_matrix_impl::compile()
+{
+    compiled_matrix &cm = compiled.write_slot();
+    compiled_row *rows = &cm.rows[0];
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < matrix_rows; i++)
+    {
+        const modulation_entry &slot = matrix[i];
+        if (!slot.dest || slot.amount == 0)
+            continue;
+        // rows with the same sources and destination add up to a single one
+        unsigned int j;
+        for (j = 0; j < count; j++)
+        {
+            if (rows[j].dest == slot.dest && rows[j].src1 == slot.src1 && rows[j].src2 == slot.src2)
+                break;
+        }
+        if (j == count)
+        {
+            compiled_row &row = rows[count++];
+            row.src1 = slot.src1;
+            row.src2 = slot.src2;
+            row.dest = slot.dest;
+            row.c0 = row.c1 = row.c2 = 0.f;
+        }
+        const float *c = scaling_coeffs[slot.mapping];
+        rows[j].c0 += c[0] * slot.amount;
+        rows[j].c1 += c[1] * slot.amount;
+        rows[j].c2 += c[2] * slot.amount;
+    }
+    // sort by destination, so that all the terms of a destination can be
+    // summed in registers, dropping the rows that cancelled out
+    unsigned int sorted = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        compiled_row row = rows[i];
+        if (row.c0 == 0 && row.c1 == 0 && row.c2 == 0)
+            continue;
+        unsigned int j = sorted++;
+        for (; j > 0 && rows[j - 1].dest > row.dest; j--)
+            rows[j] = rows[j - 1];
+        rows[j] = row;
+    }
+    cm.count = sorted;
+    compiled.publish();
+}
+
+void mod_matrix_impl::calculate_modmatrix(float *moddest, int moddest_count, const float *modsrc, int nvoices, int stride)
+{
+    compiled.fetch();
+    const compiled_matrix &cm = compiled.read_slot();
+    const compiled_row *rows = &cm.rows[0];
+    unsigned int count = cm.count;
+    int dest = 0;
+    for (unsigned int i = 0; i < count; )
+    {
+        for (; dest < rows[i].dest; dest++)
+            memset(moddest + dest * stride, 0, nvoices * sizeof(float));
+        // rows [i, end) all modulate the same destination
+        unsigned int end = i + 1;
+        while(end < count && rows[end].dest == dest)
+            end++;
+        float *out = moddest + dest * stride;
+        int v = 0;
+#ifdef __SSE__
+        for (; v + 4 <= nvoices; v += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (unsigned int r = i; r < end; r++)
+            {
+                const compiled_row &row = rows[r];
+                __m128 x = _mm_loadu_ps(modsrc + row.src1 * stride + v);
+                __m128 poly = _mm_add_ps(_mm_set1_ps(row.c0), _mm_mul_ps(_mm_add_ps(_mm_set1_ps(row.c1), _mm_mul_ps(_mm_set1_ps(row.c2), x)), x));
+                sum = _mm_add_ps(sum, _mm_mul_ps(poly, _mm_loadu_ps(modsrc + row.src2 * stride + v)));
+            }
+            _mm_storeu_ps(out + v, sum);
+        }
+#endif
+        for (; v < nvoices; v++)
+        {
+            float sum = 0.f;
+            for (unsigned int r = i; r < end; r++)
+            {
+                const compiled_row &row = rows[r];
+                float x = modsrc[row.src1 * stride + v];
+                sum += (row.c0 + (row.c1 + row.c2 * x) * x) * modsrc[row.src2 * stride + v];
+            }
+            out[v] = sum;
+        }
+        dest++;
+        i = end;
+    }
+    for (; dest < moddest_count; dest++)
+        memset(moddest + dest * stride, 0, nvoices * sizeof(float));
 }
 
 const float mod_matrix_impl::scaling_coeffs[mod_matrix_metadata::map_type_count][3] = {
@@ -148,6 +252,7 @@ char *mod_matrix_impl::configure(const char *key, const char *value)
         set_cell(row, column, value, error);
         if (!error.empty())
             return strdup(error.c_str());
+        compile();
     }
     return NULL;
 }
@@ -21,7 +21,6 @@
 #include <limits.h>
 #include <memory.h>
 #include <math.h>
-#include <fftw3.h>
 #include <calf/giface.h>
 #include <calf/modules.h>
 #include <calf/modules_dev.h>
@@ -31,7 +30,6 @@ using namespace dsp;
 using namespace calf_plugins;
 
 #define SET_IF_CONNECTED(name) if (params[AM::param_##name] != NULL) *params[AM::param_##name] = name;
-#define sinc(x) (!x) ? 1 : sin(M_PI * x)/(M_PI * x);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -56,6 +54,7 @@ void reverb_audio_module::params_changed()
     reverb.set_type_and_diffusion(fastf2i_drm(*params[par_roomsize]), *params[par_diffusion]);
     reverb.set_time(*params[par_decay]);
     reverb.set_cutoff(*params[par_hfdamp]);
+    reverb.set_quality(fastf2i_drm(*params[par_quality]));
     amount.set_inertia(*params[par_amount]);
     dryamount.set_inertia(*params[par_dry]);
     left_lo.set_lp(dsp::clip(*params[par_treblecut], 20.f, (float)(srate * 0.49f)), srate);
@@ -67,20 +66,23 @@ void reverb_audio_module::params_changed()
 
 uint32_t reverb_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
 {
-    numsamples += offset;
-    clip   -= std::min(clip, numsamples);
-    for (uint32_t i = offset; i < numsamples; i++) {
+    uint32_t end = numsamples + offset;
+    clip   -= std::min(clip, end);
+    // pre delay and filters into the wet buffers, then the whole block through the reverb
+    float wetL[MAX_SAMPLE_RUN], wetR[MAX_SAMPLE_RUN];
+    for (uint32_t i = 0; i < numsamples; i++) {
+        stereo_sample<float> s(ins[0][offset + i], ins[1][offset + i]);
+        stereo_sample<float> s2 = pre_delay.process(s, predelay_amt);
+        wetL[i] = left_lo.process(left_hi.process(s2.left));
+        wetR[i] = right_lo.process(right_hi.process(s2.right));
+    }
+    reverb.process(wetL, wetR, numsamples);
+    for (uint32_t i = offset; i < end; i++) {
         float dry = dryamount.get();
         float wet = amount.get();
-        stereo_sample<float> s(ins[0][i], ins[1][i]);
-        stereo_sample<float> s2 = pre_delay.process(s, predelay_amt);
-        
-        float rl = s2.left, rr = s2.right;
-        rl = left_lo.process(left_hi.process(rl));
-        rr = right_lo.process(right_hi.process(rr));
-        reverb.process(rl, rr);
-        outs[0][i] = dry*s.left + wet*rl;
-        outs[1][i] = dry*s.right + wet*rr;
+        float rl = wetL[i - offset], rr = wetR[i - offset];
+        outs[0][i] = dry*ins[0][i] + wet*rl;
+        outs[1][i] = dry*ins[1][i] + wet*rr;
         meter_wet = std::max(fabs(wet*rl), fabs(wet*rr));
         meter_out = std::max(fabs(outs[0][i]), fabs(outs[1][i]));
         if(outs[0][i] > 1.f or outs[1][i] > 1.f) {
@@ -106,17 +108,159 @@ uint32_t reverb_audio_module::process(uint32_t offset, uint32_t numsamples, uint
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
+convolver_audio_module::convolver_audio_module()
+{
+    engine = NULL;
+    pending = retired = NULL;
+    status_serial = 1;
+    srate = 0;
+    meter_wet = meter_out = 0.f;
+}
+
+convolver_audio_module::~convolver_audio_module()
+{
+    delete engine;
+    delete pending;
+    delete retired;
+}
+
+void convolver_audio_module::activate()
+{
+    if (engine)
+        engine->reset();
+}
+
+void convolver_audio_module::deactivate()
+{
+}
+
+void convolver_audio_module::set_sample_rate(uint32_t sr)
+{
+    srate = sr;
+    wet.set_sample_rate(sr);
+    dry.set_sample_rate(sr);
+    std::string error;
+    if (!ir_file.empty() && !load(error)) {
+        ir_status = error;
+        status_serial++;
+    }
+}
+
+void convolver_audio_module::params_changed()
+{
+    wet.set_inertia(*params[par_wet]);
+    dry.set_inertia(*params[par_dry]);
+}
+
+bool convolver_audio_module::load(std::string &error)
+{
+    dsp::wave_file file;
+    if (!file.open(ir_file.c_str(), error))
+        return false;
+    dsp::convolution_engine *e = new dsp::convolution_engine(file, srate, MAX_IR_SECONDS * srate);
+    // the previous handover is done by now or never will be - in both cases
+    // nothing but this thread is going to touch those
+    delete (dsp::convolution_engine *)__sync_lock_test_and_set(&retired, (dsp::convolution_engine *)NULL);
+    delete (dsp::convolution_engine *)__sync_lock_test_and_set(&pending, e);
+    char buf[64];
+    sprintf(buf, "%d ch, %.2f s", file.get_channels(), e->get_length() / (float)srate);
+    ir_status = buf;
+    return true;
+}
+
+char *convolver_audio_module::configure(const char *key, const char *value)
+{
+    if (!strcmp(key, "ir"))
+    {
+        ir_file = value ? value : "";
+        status_serial++;
+        if (ir_file.empty()) {
+            ir_status = "";
+            delete (dsp::convolution_engine *)__sync_lock_test_and_set(&pending, (dsp::convolution_engine *)NULL);
+            return NULL;
+        }
+        std::string error;
+        // without a sample rate, the file is loaded by set_sample_rate
+        if (srate && !load(error)) {
+            ir_status = error;
+            return strdup(("Cannot load the impulse response: " + error).c_str());
+        }
+    }
+    return NULL;
+}
+
+void convolver_audio_module::send_configures(send_configure_iface *sci)
+{
+    sci->send_configure("ir", ir_file.c_str());
+}
+
+int convolver_audio_module::send_status_updates(send_updates_iface *sui, int last_serial)
+{
+    if (status_serial != last_serial)
+        sui->send_status("ir_status", ir_status.c_str());
+    return status_serial;
+}
+
+uint32_t convolver_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
+{
+    // pick up a new engine, unless the one replaced last time is still waiting to be deleted
+    if (pending && !retired) {
+        dsp::convolution_engine *e = (dsp::convolution_engine *)__sync_lock_test_and_set(&pending, (dsp::convolution_engine *)NULL);
+        if (e) {
+            retired = engine;
+            engine = e;
+        }
+    }
+    uint32_t end = offset + numsamples;
+    float wetL[MAX_SAMPLE_RUN], wetR[MAX_SAMPLE_RUN];
+    if (engine)
+        engine->process(ins[0] + offset, ins[1] + offset, wetL, wetR, numsamples);
+    else {
+        dsp::zero(wetL, numsamples);
+        dsp::zero(wetR, numsamples);
+    }
+    for (uint32_t i = offset; i < end; i++) {
+        float d = dry.get();
+        float w = wet.get();
+        float rl = w * wetL[i - offset], rr = w * wetR[i - offset];
+        outs[0][i] = d * ins[0][i] + rl;
+        outs[1][i] = d * ins[1][i] + rr;
+        meter_wet = std::max(fabs(rl), fabs(rr));
+        meter_out = std::max(fabs(outs[0][i]), fabs(outs[1][i]));
+    }
+    if (params[par_meter_wet] != NULL)
+        *params[par_meter_wet] = meter_wet;
+    if (params[par_meter_out] != NULL)
+        *params[par_meter_out] = meter_out;
+    return outputs_mask;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+const float vintage_delay_audio_module::MAX_DELAY_TIME = 5.9f;
+
 vintage_delay_audio_module::vintage_delay_audio_module()
 {
     old_medium = -1;
-    for (int i = 0; i < MAX_DELAY; i++) {
-        buffers[0][i] = 0.f;
-        buffers[1][i] = 0.f;
-    }
+    buffers[0] = buffers[1] = NULL;
+    buffer_size = 0;
+    ring_mask = 0;
+    max_ring = MIN_RING;
+    bufptr = 0;
+    age = 0;
+    deltime_l = deltime_r = 1;
     _tap_avg = 0;
     _tap_last = 0;
 }
 
+vintage_delay_audio_module::~vintage_delay_audio_module()
+{
+    waveform_builder::remove(&grower);
+    grower.release();
+    free(buffers[0]);
+    free(buffers[1]);
+}
+
 void vintage_delay_audio_module::params_changed()
 {
     if(*params[par_tap] >= .5f) {
@@ -134,13 +278,20 @@ void vintage_delay_audio_module::params_changed()
         _tap_last = _now;
         *params[par_tap] = 0.f;
     }
-    float unit = 60.0 * srate / (*params[par_bpm] * *params[par_divide]);
-    deltime_l = dsp::fastf2i_drm(unit * *params[par_time_l]);
-    deltime_r = dsp::fastf2i_drm(unit * *params[par_time_r]);
+    mixmode = dsp::fastf2i_drm(*params[par_mixmode]);
+    int want_l, want_r;
+    int size = wanted_times(want_l, want_r);
+    if (size > buffer_size && size > grower.request) {
+        grower.request = size;
+        waveform_builder::wake();
+    }
+    // until the bigger ring arrives, the times are clamped to the current one
+    int fit = (mixmode == MIXMODE_LR || mixmode == MIXMODE_RL) ? (buffer_size - 1) / 2 : buffer_size - 1;
+    deltime_l = std::max(1, std::min(want_l, fit));
+    deltime_r = std::max(1, std::min(want_r, fit));
     int deltime_fb = deltime_l + deltime_r;
     float fb = *params[par_feedback];
     dry.set_inertia(*params[par_dryamount]);
-    mixmode = dsp::fastf2i_drm(*params[par_mixmode]);
     medium = dsp::fastf2i_drm(*params[par_medium]);
     switch(mixmode)
     {
@@ -176,20 +327,59 @@ void vintage_delay_audio_module::params_changed()
         calc_filters();
 }
 
+/// The L/R modes feed back over the sum of both times, so in those both have
+/// to fit into the ring at once, in the other modes each of them on its own
+int vintage_delay_audio_module::wanted_times(int &time_l, int &time_r)
+{
+    float unit = 60.0 * srate / (*params[par_bpm] * *params[par_divide]);
+    bool sum = dsp::fastf2i_drm(*params[par_mixmode]) >= MIXMODE_LR;
+    int max_time = sum ? (max_ring - 1) / 2 : max_ring - 1;
+    time_l = std::min(std::max(dsp::fastf2i_drm(unit * *params[par_time_l]), 1), max_time);
+    time_r = std::min(std::max(dsp::fastf2i_drm(unit * *params[par_time_r]), 1), max_time);
+    int lag = sum ? time_l + time_r : std::max(time_l, time_r);
+    int size = MIN_RING;
+    while(size <= lag)
+        size <<= 1;
+    return size;
+}
+
 void vintage_delay_audio_module::activate()
 {
+    // the worker must not be touching the rings while they change hands
+    waveform_builder::remove(&grower);
+    grower.release();
+    int time_l, time_r;
+    int size = wanted_times(time_l, time_r);
+    if (size != buffer_size) {
+        for (int c = 0; c < 2; c++) {
+            free(buffers[c]);
+            buffers[c] = (float *)calloc(size, sizeof(float));
+        }
+        buffer_size = size;
+        ring_mask = size - 1;
+        age = size;
+    }
+    else
+        age = 0;
     bufptr = 0;
-    age = 0;
+    waveform_builder::add(&grower);
 }
 
 void vintage_delay_audio_module::deactivate()
 {
+    waveform_builder::remove(&grower);
+    grower.release();
 }
 
 void vintage_delay_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
     old_medium = -1;
+    // 256k samples at 44.1 kHz like the old fixed buffers, the same time at
+    // higher sample rates; longer delays are clamped in params_changed
+    max_ring = MIN_RING;
+    while(max_ring < MAX_DELAY_TIME * sr)
+        max_ring <<= 1;
     amt_left.set_sample_rate(sr); amt_right.set_sample_rate(sr);
     fb_left.set_sample_rate(sr); fb_right.set_sample_rate(sr);
 }
@@ -204,99 +394,171 @@ void vintage_delay_audio_module::calc_filters()
     biquad_right[1].copy_coeffs(biquad_left[1]);
 }
 
-/// Single delay line with feedback at the same tap
-static inline void delayline_impl(int age, int deltime, float dry_value, const float &delayed_value, float &out, float &del, gain_smoothing &amt, gain_smoothing &fb)
+vintage_delay_audio_module::ring_grower::ring_grower()
+{
+    request = ready = 0;
+    fresh[0] = fresh[1] = retired[0] = retired[1] = NULL;
+    fresh_size = 0;
+}
+
+bool vintage_delay_audio_module::ring_grower::run()
 {
-    // if the buffer hasn't been cleared yet (after activation), pretend we've read zeros
-    if (age <= deltime) {
-        out = 0;
-        del = dry_value;
-        amt.step();
-        fb.step();
+    // the audio thread hasn't taken the last one yet
+    if (ready)
+        return false;
+    for (int c = 0; c < 2; c++) {
+        free(retired[c]);
+        retired[c] = NULL;
     }
-    else
-    {
-        float delayed = delayed_value; // avoid dereferencing the pointer in 'then' branch of the if()
-        dsp::sanitize(delayed);
-        out = delayed * amt.get();
-        del = dry_value + delayed * fb.get();
+    int size = request;
+    if (size > fresh_size) {
+        for (int c = 0; c < 2; c++)
+            fresh[c] = (float *)calloc(size, sizeof(float));
+        fresh_size = size;
+        __sync_synchronize();
+        ready = 1;
     }
+    return false;
 }
 
-/// Single delay line with tap output
-static inline void delayline2_impl(int age, int deltime, float dry_value, const float &delayed_value, const float &delayed_value_for_fb, float &out, float &del, gain_smoothing &amt, gain_smoothing &fb)
+void vintage_delay_audio_module::ring_grower::release()
 {
-    if (age <= deltime) {
-        out = 0;
-        del = dry_value;
-        amt.step();
-        fb.step();
+    for (int c = 0; c < 2; c++) {
+        if (ready)
+            free(fresh[c]);
+        free(retired[c]);
+        fresh[c] = retired[c] = NULL;
     }
-    else
-    {
-        out = delayed_value * amt.get();
-        del = dry_value + delayed_value_for_fb * fb.get();
-        dsp::sanitize(out);
-        dsp::sanitize(del);
+    request = ready = 0;
+    fresh_size = 0;
+}
+
+/// Clear the part of the ring the taps are going to read but hasn't been written
+/// since activation, instead of clearing the whole buffer up front
+void vintage_delay_audio_module::clear_history(int max_delay)
+{
+    if (age >= max_delay)
+        return;
+    int start = (bufptr - max_delay) & ring_mask;
+    int count = max_delay - age;
+    int first = std::min(count, buffer_size - start);
+    dsp::zero(buffers[0] + start, first);
+    dsp::zero(buffers[1] + start, first);
+    dsp::zero(buffers[0], count - first);
+    dsp::zero(buffers[1], count - first);
+    age = max_delay;
+}
+
+/// One run of a delay line with feedback, none of the taps wrapping around
+/// the ring. Plain loop over arrays, so that the compiler can vectorize it.
+static inline void delayline_run(const float *in, const float *tap_out, const float *tap_fb, const float *amt, const float *fb, float *out, float *del, uint32_t len)
+{
+    const float small = small_value<float>();
+    for (uint32_t i = 0; i < len; i++) {
+        float o = tap_out[i] * amt[i];
+        float d = in[i] + tap_fb[i] * fb[i];
+        out[i] = fabsf(o) < small ? 0.f : o;
+        del[i] = fabsf(d) < small ? 0.f : d;
     }
 }
 
-static inline void delay_mix(float dry_left, float dry_right, float &out_left, float &out_right, float dry, float chmix)
+/// Fill buf with len values of a smoothed gain
+static inline void gain_run(gain_smoothing &gain, float *buf, uint32_t len)
 {
-    float tmp_left = lerp(out_left, out_right, chmix);
-    float tmp_right = lerp(out_right, out_left, chmix);
-    out_left = dry_left * dry + tmp_left;
-    out_right = dry_right * dry + tmp_right;
+    if (!gain.active()) {
+        float value = gain.get();
+        for (uint32_t i = 0; i < len; i++)
+            buf[i] = value;
+    }
+    else {
+        for (uint32_t i = 0; i < len; i++)
+            buf[i] = gain.get();
+    }
 }
 
 uint32_t vintage_delay_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
 {
     uint32_t ostate = 3; // XXXKF optimize!
     uint32_t end = offset + numsamples;
+    if (grower.ready) {
+        // the history is lost, the new ring starts silent
+        for (int c = 0; c < 2; c++) {
+            grower.retired[c] = buffers[c];
+            buffers[c] = grower.fresh[c];
+        }
+        buffer_size = grower.fresh_size;
+        ring_mask = buffer_size - 1;
+        bufptr = 0;
+        age = buffer_size;
+        __sync_synchronize();
+        grower.ready = 0;
+        waveform_builder::wake();
+        params_changed();
+    }
     int orig_bufptr = bufptr;
-    float out_left, out_right, del_left, del_right;
     
-    switch(mixmode)
+    // v - which buffer the left channel taps read from,
+    // lag_out/lag_fb - distance of the output and feedback taps per channel
+    int v = (mixmode == MIXMODE_PINGPONG || mixmode == MIXMODE_RL) ? 1 : 0;
+    int lag_out[2], lag_fb[2];
+    if (mixmode == MIXMODE_LR || mixmode == MIXMODE_RL) {
+        int deltime_fb = deltime_l + deltime_r;
+        lag_out[0] = mixmode == MIXMODE_RL ? deltime_fb : deltime_l;
+        lag_out[1] = mixmode == MIXMODE_LR ? deltime_fb : deltime_r;
+        lag_fb[0] = lag_fb[1] = deltime_fb;
+    } else {
+        lag_out[0] = lag_fb[0] = deltime_l;
+        lag_out[1] = lag_fb[1] = deltime_r;
+    }
+    int max_lag = std::max(std::max(lag_out[0], lag_out[1]), lag_fb[0]);
+    max_lag = std::max(max_lag, lag_fb[1]);
+    // with blocks no longer than the shortest delay, nothing read within a
+    // block has been written within the same block
+    int min_lag = std::min(deltime_l, deltime_r);
+    // whatever lies beyond the history reads as silence
+    clear_history(max_lag);
+    
+    float gains[6][MAX_SAMPLE_RUN];
+    float *amt[2] = { gains[0], gains[1] }, *fb[2] = { gains[2], gains[3] };
+    float wet[2][MAX_SAMPLE_RUN];
+    gain_run(amt_left, amt[0], numsamples);
+    gain_run(amt_right, amt[1], numsamples);
+    gain_run(fb_left, fb[0], numsamples);
+    gain_run(fb_right, fb[1], numsamples);
+    gain_run(dry, gains[4], numsamples);
+    gain_run(chmix, gains[5], numsamples);
+    
+    for (uint32_t done = 0; done < numsamples; )
     {
-        case MIXMODE_STEREO:
-        case MIXMODE_PINGPONG:
+        uint32_t block = std::min<uint32_t>(numsamples - done, min_lag);
+        for (int c = 0; c < 2; c++)
         {
-            int v = mixmode == MIXMODE_PINGPONG ? 1 : 0;
-            for(uint32_t i = offset; i < end; i++)
-            {                
-                delayline_impl(age, deltime_l, ins[0][i], buffers[v][(bufptr - deltime_l) & ADDR_MASK], out_left, del_left, amt_left, fb_left);
-                delayline_impl(age, deltime_r, ins[1][i], buffers[1 - v][(bufptr - deltime_r) & ADDR_MASK], out_right, del_right, amt_right, fb_right);
-                delay_mix(ins[0][i], ins[1][i], out_left, out_right, dry.get(), chmix.get());
-                
-                age++;
-                outs[0][i] = out_left; outs[1][i] = out_right; buffers[0][bufptr] = del_left; buffers[1][bufptr] = del_right;
-                bufptr = (bufptr + 1) & (MAX_DELAY - 1);
-            }
-        }
-        break;
-        
-        case MIXMODE_LR:
-        case MIXMODE_RL:
-        {
-            int v = mixmode == MIXMODE_RL ? 1 : 0;
-            int deltime_fb = deltime_l + deltime_r;
-            int deltime_l_corr = mixmode == MIXMODE_RL ? deltime_fb : deltime_l;
-            int deltime_r_corr = mixmode == MIXMODE_LR ? deltime_fb : deltime_r;
-            
-            for(uint32_t i = offset; i < end; i++)
+            const float *src = buffers[c ^ v];
+            for (uint32_t pos = 0; pos < block; )
             {
-                delayline2_impl(age, deltime_l, ins[0][i], buffers[v][(bufptr - deltime_l_corr) & ADDR_MASK], buffers[v][(bufptr - deltime_fb) & ADDR_MASK], out_left, del_left, amt_left, fb_left);
-                delayline2_impl(age, deltime_r, ins[1][i], buffers[1 - v][(bufptr - deltime_r_corr) & ADDR_MASK], buffers[1-v][(bufptr - deltime_fb) & ADDR_MASK], out_right, del_right, amt_right, fb_right);
-                delay_mix(ins[0][i], ins[1][i], out_left, out_right, dry.get(), chmix.get());
-                
-                age++;
-                outs[0][i] = out_left; outs[1][i] = out_right; buffers[0][bufptr] = del_left; buffers[1][bufptr] = del_right;
-                bufptr = (bufptr + 1) & (MAX_DELAY - 1);
+                int w = (bufptr + pos) & ring_mask;
+                int ro = (w - lag_out[c]) & ring_mask;
+                int rf = (w - lag_fb[c]) & ring_mask;
+                uint32_t len = std::min<uint32_t>(block - pos, buffer_size - std::max(w, std::max(ro, rf)));
+                uint32_t k = done + pos;
+                delayline_run(ins[c] + offset + k, src + ro, src + rf, amt[c] + k, fb[c] + k, wet[c] + k, buffers[c] + w, len);
+                pos += len;
             }
         }
+        bufptr = (bufptr + block) & ring_mask;
+        done += block;
+    }
+    age = std::min(age + (int)numsamples, buffer_size);
+    
+    for(uint32_t i = 0; i < numsamples; i++)
+    {
+        float dry_left = ins[0][offset + i], dry_right = ins[1][offset + i];
+        float out_left = lerp(wet[0][i], wet[1][i], gains[5][i]);
+        float out_right = lerp(wet[1][i], wet[0][i], gains[5][i]);
+        outs[0][offset + i] = dry_left * gains[4][i] + out_left;
+        outs[1][offset + i] = dry_right * gains[4][i] + out_right;
     }
-    if (age >= MAX_DELAY)
-        age = MAX_DELAY;
+    
     if (medium > 0) {
         bufptr = orig_bufptr;
         if (medium == 2)
@@ -305,7 +567,7 @@ uint32_t vintage_delay_audio_module::process(uint32_t offset, uint32_t numsample
             {
                 buffers[0][bufptr] = biquad_left[0].process_lp(biquad_left[1].process(buffers[0][bufptr]));
                 buffers[1][bufptr] = biquad_right[0].process_lp(biquad_right[1].process(buffers[1][bufptr]));
-                bufptr = (bufptr + 1) & (MAX_DELAY - 1);
+                bufptr = (bufptr + 1) & ring_mask;
             }
             biquad_left[0].sanitize();biquad_right[0].sanitize();
         } else {
@@ -313,7 +575,7 @@ uint32_t vintage_delay_audio_module::process(uint32_t offset, uint32_t numsample
             {
                 buffers[0][bufptr] = biquad_left[1].process(buffers[0][bufptr]);
                 buffers[1][bufptr] = biquad_right[1].process(buffers[1][bufptr]);
-                bufptr = (bufptr + 1) & (MAX_DELAY - 1);
+                bufptr = (bufptr + 1) & ring_mask;
             }
         }
         biquad_left[1].sanitize();biquad_right[1].sanitize();
@@ -346,7 +608,9 @@ bool filter_audio_module::get_graph(int index, int subindex, float *data, int po
         return false;
     if (index == par_cutoff && !subindex) {
         context->set_line_width(1.5);
-        return ::get_graph(*this, subindex, data, points);
+        response.clear();
+        add_to_response(response);
+        return response.get_graph(data, points, srate);
     }
     return false;
 }
@@ -477,7 +741,9 @@ bool filterclavier_audio_module::get_graph(int index, int subindex, float *data,
     }
     if (!subindex) {
         context->set_line_width(1.5);
-        return ::get_graph(*this, subindex, data, points);
+        response.clear();
+        add_to_response(response);
+        return response.get_graph(data, points, srate);
     }
     return false;
 }
@@ -902,7 +1168,6 @@ analyzer_audio_module::analyzer_audio_module() {
     _smooth_old = -1;
     ppos = 0;
     plength = 0;
-    fpos = 0;
     
     spline_buffer = (int*) calloc(200, sizeof(int));
     memset(spline_buffer, 0, 200 * sizeof(int)); // reset buffer to zero
@@ -910,67 +1175,36 @@ analyzer_audio_module::analyzer_audio_module() {
     phase_buffer = (float*) calloc(max_phase_buffer_size, sizeof(float));
     dsp::zero(phase_buffer, max_phase_buffer_size);
     
-    fft_buffer = (float*) calloc(max_fft_buffer_size, sizeof(float));
-    
-    fft_inL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_outL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_inR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_outR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_smoothL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_smoothR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_fallingL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_fallingR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    dsp::fill(fft_fallingL, 1.f, max_fft_cache_size);
-    dsp::fill(fft_fallingR, 1.f, max_fft_cache_size);
+    settings.accuracy = 0;
+    settings.mode = 0;
+    settings.smoothing = 0;
+    settings.speed = 1;
+    settings.windowing = 0;
+    settings.overlap = 0;
+    settings.accumulate = 0;
+    settings.reset_serial = 0;
     
-    fft_deltaL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_deltaR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_holdL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_holdR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_freezeL = (float*) calloc(max_fft_cache_size, sizeof(float));
-    fft_freezeR = (float*) calloc(max_fft_cache_size, sizeof(float));
-    
-    fft_plan = NULL;
-    
-    ____analyzer_phase_was_drawn_here = 0;
-    ____analyzer_sanitize = 0;
+    bins_points = -1;
+    bins_accuracy = -1;
+    bins_linear = -1;
+    lintrans = -1;
 }
 
 analyzer_audio_module::~analyzer_audio_module()
 {
-    free(fft_freezeR);
-    free(fft_freezeL);
-    free(fft_holdR);
-    free(fft_holdL);
-    free(fft_deltaR);
-    free(fft_deltaL);
-    free(fft_fallingR);
-    free(fft_fallingL);
-    free(fft_smoothR);
-    free(fft_smoothL);
-    free(fft_outR);
-    free(fft_outL);
-    free(fft_inR);
-    free(fft_inL);
+    worker.stop();
     free(phase_buffer);
     free(spline_buffer);
-    if (fft_plan)
-    {
-        fftwf_destroy_plan(fft_plan);
-        fft_plan = NULL;
-    }
 }
 
 void analyzer_audio_module::activate() {
+    worker.start();
     active = true;
 }
 
 void analyzer_audio_module::deactivate() {
     active = false;
+    worker.stop();
 }
 
 void analyzer_audio_module::params_changed() {
@@ -978,11 +1212,7 @@ void analyzer_audio_module::params_changed() {
     if(*params[param_analyzer_accuracy] != _acc_old) {
         _accuracy = 1 << (7 + (int)*params[param_analyzer_accuracy]);
         _acc_old = *params[param_analyzer_accuracy];
-        // recreate fftw plan
-        if (fft_plan) fftwf_destroy_plan (fft_plan);
-        //fft_plan = rfftw_create_plan(_accuracy, FFTW_FORWARD, 0);
-        fft_plan = fftwf_plan_r2r_1d(_accuracy, NULL, NULL, FFTW_R2HC, FFTW_ESTIMATE);
-        lintrans = -1;
+        // the worker recreates its fftw plan on the next reset
         ___sanitize = true;
     }
     if(*params[param_analyzer_hold] != _hold_old) {
@@ -1006,22 +1236,22 @@ void analyzer_audio_module::params_changed() {
         ___sanitize = true;
     }
     if(___sanitize) {
-        // null the overall buffer
-        dsp::zero(fft_inL, max_fft_cache_size);
-        dsp::zero(fft_inR, max_fft_cache_size);
-        dsp::zero(fft_outL, max_fft_cache_size);
-        dsp::zero(fft_outR, max_fft_cache_size);
-        dsp::zero(fft_holdL, max_fft_cache_size);
-        dsp::zero(fft_holdR, max_fft_cache_size);
-        dsp::zero(fft_smoothL, max_fft_cache_size);
-        dsp::zero(fft_smoothR, max_fft_cache_size);
-        dsp::zero(fft_deltaL, max_fft_cache_size);
-        dsp::zero(fft_deltaR, max_fft_cache_size);
-//        memset(fft_fallingL, 1.f, max_fft_cache_size * sizeof(float));
-//        memset(fft_fallingR, 1.f, max_fft_cache_size * sizeof(float));
+        // let the worker null its smoothing and hold buffers
+        settings.reset_serial++;
         dsp::zero(spline_buffer, 200);
-        ____analyzer_phase_was_drawn_here = 0;
     }
+    settings.accuracy = _accuracy;
+    settings.mode = (int)*params[param_analyzer_mode];
+    settings.smoothing = (int)*params[param_analyzer_smoothing];
+    if(settings.mode == 5 and settings.smoothing) {
+        // there's no falling for difference mode, only smoothing
+        settings.smoothing = 2;
+    }
+    settings.speed = 16 - (int)*params[param_analyzer_speed];
+    settings.windowing = (int)*params[param_analyzer_windowing];
+    settings.overlap = (int)*params[param_analyzer_overlap];
+    settings.accumulate = (int)*params[param_analyzer_accumulate];
+    worker.set_settings(settings);
 }
 
 uint32_t analyzer_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask) {
@@ -1048,11 +1278,7 @@ uint32_t analyzer_audio_module::process(uint32_t offset, uint32_t numsamples, ui
         ppos %= (phase_buffer_size - 2);
         
         // analyzer
-        fft_buffer[fpos] = L;
-        fft_buffer[fpos + 1] = R;
-        
-        fpos += 2;
-        fpos %= (max_fft_buffer_size - 2);
+        worker.ring.put(L, R);
         
         // meter
         meter_L = L;
@@ -1062,6 +1288,8 @@ uint32_t analyzer_audio_module::process(uint32_t offset, uint32_t numsamples, ui
         outs[0][i] = L;
         outs[1][i] = R;
     }
+    // hand the new samples over to the analysis thread
+    worker.ring.publish();
     // draw meters
     SET_IF_CONNECTED(clip_L);
     SET_IF_CONNECTED(clip_R);
@@ -1089,18 +1317,137 @@ bool analyzer_audio_module::get_phase_graph(float ** _buffer, int *_length, int
     return false;
 }
 
-bool analyzer_audio_module::get_graph(int index, int subindex, float *data, int points, cairo_iface *context, int *mode) const
+void analyzer_audio_module::update_pixel_bins(int points, int accuracy) const
 {
-    if(____analyzer_sanitize) {
-        // null the overall buffer to feed the fft with if someone requested so
-        // in the last cycle
-        // afterwards quit this call
-        dsp::zero(fft_inL, max_fft_cache_size);
-        dsp::zero(fft_inR, max_fft_cache_size);
-        ____analyzer_sanitize = 0;
-        return false;
+    int linear = *params[param_analyzer_scale] or *params[param_analyzer_view] == 2;
+    if (points == bins_points and accuracy == bins_accuracy and linear == bins_linear)
+        return;
+    bins_points = points;
+    bins_accuracy = accuracy;
+    bins_linear = linear;
+    pixel_bins.resize(points + 1);
+    // recalc linear transition
+    int _lintrans = (int)((float)points * log((20.f + 2.f * \
+        (float)srate / (float)accuracy) / 20.f) / log(1000.f));  
+    lintrans = (int)(_lintrans + points % _lintrans / \
+        floor(points / _lintrans)) / 2; // / 4 was added to see finer bars but breaks low end
+    int _iter = 1;
+    for (int i = 0; i <= points; i++)
+    {
+        // we need to know the exact frequency at this pixel
+        double freq = 20.f * pow (1000.f, (float)i / points);
+        // let's see how many pixels we may want to skip until the drawing
+        // function has to draw a bar/box/line
+        if(linear) {
+            // we have linear view enabled or we want to see tit... erm curves
+            if((i % lintrans == 0 and points - i > lintrans) or i == points - 1) {
+                _iter = std::max(1, (int)floor(freq * \
+                    (float)accuracy / (float)srate));
+            }    
+        } else {
+            // we have logarithmic view enabled
+            _iter = std::max(1, (int)floor(freq * (float)accuracy / (float)srate));
+        }
+        pixel_bins[i] = _iter;
     }
-    
+}
+
+void analyzer_audio_module::postprocess(float *outL, float *outR, int points, int accuracy) const
+{
+    // ################################
+    // Manipulate the fft_out values
+    // according to the post processing
+    // ################################
+    int _param_mode = (int)*params[param_analyzer_mode];
+    int iter = pixel_bins[0];
+    for (int i = 1; i <= points; i++)
+    {
+        int _iter = pixel_bins[i];
+        if(_iter <= iter)
+            continue;
+        int n = 0;
+        float var1L = 0.f; // used later for denoising peaks
+        float var1R = 0.f;
+        float diff_fft;
+        switch(_param_mode) {
+            default:
+                // all normal modes
+                // only if we don't see difference mode
+                switch((int)*params[param_analyzer_post]) {
+                    case 0:
+                        // Analyzer Normalized - nothing to do
+                        break;
+                    case 1:
+                        // Analyzer Additive - cycle through skipped values and
+                        // add them, then normalize
+                        for(int j = iter + 1; j < _iter; j++) {
+                            outL[_iter] += outL[j];
+                            outR[_iter] += outR[j];
+                        }
+                        outL[_iter] /= (_iter - iter);
+                        outR[_iter] /= (_iter - iter);
+                        break;
+                    case 2:
+                        // Analyzer Additive - cycle through skipped values and
+                        // add them
+                        for(int j = iter + 1; j < _iter; j++) {
+                            outL[_iter] += outL[j];
+                            outR[_iter] += outR[j];
+                        }
+                        break;
+                    case 3:
+                        // Analyzer Denoised Peaks - filter out unwanted noise
+                        for(int k = 0; k < std::max(10 , std::min(400 ,\
+                            (int)(2.f*(float)((_iter - iter))))); k++) {
+                            //collect amplitudes in the environment of _iter to
+                            //be able to erase them from signal and leave just
+                            //the peaks
+                            if(_iter - k > 0) {
+                                var1L += outL[_iter - k];
+                                n++;
+                            }
+                            if(k != 0 and _iter + k < accuracy) var1L += outL[_iter + k];
+                            if(_param_mode == 3 or _param_mode == 4) {
+                                if(_iter - k > 0) {
+                                    var1R += outR[_iter - k];
+                                    n++;
+                                }
+                                if(k != 0 and _iter + k < accuracy) var1R += outR[_iter + k];
+                            }
+                            n++;
+                        }
+                        //pumping up actual signal an erase surrounding
+                        // sounds
+                        outL[_iter] = 0.25f * std::max(n * 0.6f * \
+                            outL[_iter] - var1L , 1e-20f);
+                        if(_param_mode == 3 or _param_mode == 4) {
+                            // do the same with R channel if needed
+                            outR[_iter] = 0.25f * std::max(n * \
+                                0.6f * outR[_iter] - var1R , 1e-20f);
+                        }
+                        break;
+                }
+                break;
+            case 5:
+                // Stereo Difference - draw the difference between left
+                // and right channel, recalc the values in left and right if
+                // frequencies are skipped.
+                // this is additive mode - no other mode is available
+                for(int j = iter + 1; j < _iter; j++) {
+                    outL[_iter] += outL[j];
+                    outR[_iter] += outR[j];
+                }
+                //calculate difference between left an right channel                        
+                diff_fft = outL[_iter] - outR[_iter];
+                outL[_iter] = diff_fft / accuracy;
+                break;
+        }
+        iter = _iter;
+    }
+}
+
+bool analyzer_audio_module::get_graph(int index, int subindex, float *data, int points, cairo_iface *context, int *mode) const
+{
     // just for the stoopid
     int _param_mode = (int)*params[param_analyzer_mode];
     bool _param_hold = (bool)*params[param_analyzer_hold];
@@ -1125,209 +1472,27 @@ bool analyzer_audio_module::get_graph(int index, int subindex, float *data, int
         // and hold settings
         return false;
     }
-    bool fftdone = false; // if fft was renewed, this one is set to true
-    double freq; // here the frequency of the actual drawn pixel gets stored
+    bool fftdone = false; // if a new spectrum was picked up, this one is set to true
+    if(subindex == 0) {
+        // take the newest spectrum finished by the analysis thread, a frozen
+        // display simply keeps the one it has got
+        if(!*params[param_analyzer_freeze])
+            fftdone = worker.fetch();
+    }
+    // the frame stays ours until the next fetch, so it can't change while drawing
+    dsp::spectrum_frame &frame = worker.get_frame();
+    if(!frame.accuracy)
+        return false;
+    int _accuracy = frame.accuracy;
     float stereo_coeff = pow(2, 4 * *params[param_analyzer_level] - 2);
     int iter = 0; // this is the pixel we have been drawing the last box/bar/line
     int _iter = 1; // this is the next pixel we want to draw a box/bar/line
-    float posneg = 1;
-    int _param_speed = 16 - (int)*params[param_analyzer_speed];
-    int _param_smooth = (int)*params[param_analyzer_smoothing];
-    if(_param_mode == 5 and _param_smooth) {
-        // there's no falling for difference mode, only smoothing
-        _param_smooth = 2;
-    }
-    if(_param_mode > 5 and _param_mode < 9) {
-        // there's no smoothing for spectralizer mode
-        //_param_smooth = 0;
-    }
     
-    if(subindex == 0) {
-        // #####################################################################
-        // We are doing FFT here, so we first have to setup fft-buffers from
-        // the main buffer and we use this cycle for filling other buffers
-        // like smoothing, delta and hold
-        // #####################################################################
-        if(!((int)____analyzer_phase_was_drawn_here % _param_speed)) {
-            // seems we have to do a fft, so let's read the latest data from the
-            // buffer to send it to fft afterwards
-            // we want to remember old fft_out values for smoothing as well
-            // and we fill the hold buffer in this (extra) cycle
-            for(int i = 0; i < _accuracy; i++) {
-                // go to the right position back in time according to accuracy
-                // settings and cycling in the main buffer
-                int _fpos = (fpos - _accuracy * 2 \
-                    + (i * 2)) % max_fft_buffer_size;
-                if(_fpos < 0)
-                    _fpos = max_fft_buffer_size + _fpos;
-                float L = fft_buffer[_fpos];
-                float R = fft_buffer[_fpos + 1];
-                float win = 0.54 - 0.46 * cos(2 * M_PI * i / _accuracy);
-                L *= win;
-                R *= win;
-                
-                // #######################################
-                // Do some windowing functions on the
-                // buffer
-                // #######################################
-                int _m = 2;
-                float _f = 1.f;
-                float _a, a0, a1, a2, a3;
-                switch((int)*params[param_analyzer_windowing]) {
-                    case 0:
-                    default:
-                        // Linear
-                        _f = 1.f;
-                        break;
-                    case 1:
-                        // Hamming
-                        _f = 0.54 + 0.46 * cos(2 * M_PI * (i - 2 / points));
-                        break;
-                    case 2:
-                        // von Hann
-                        _f = 0.5 * (1 + cos(2 * M_PI * (i - 2 / points)));
-                        break;
-                    case 3:
-                        // Blackman
-                        _a = 0.16;
-                        a0 = 1.f - _a / 2.f;
-                        a1 = 0.5;
-                        a2 = _a / 2.f;
-                        _f = a0 + a1 * cos((2.f * M_PI * i) / points - 1) + \
-                            a2 * cos((4.f * M_PI * i) / points - 1);
-                        break;
-                    case 4:
-                        // Blackman-Harris
-                        a0 = 0.35875;
-                        a1 = 0.48829;
-                        a2 = 0.14128;
-                        a3 = 0.01168;
-                        _f = a0 - a1 * cos((2.f * M_PI * i) / points - 1) + \
-                            a2 * cos((4.f * M_PI * i) / points - 1) - \
-                            a3 * cos((6.f * M_PI * i) / points - 1);
-                        break;
-                    case 5:
-                        // Blackman-Nuttall
-                        a0 = 0.3653819;
-                        a1 = 0.4891775;
-                        a2 = 0.1365995;
-                        a3 = 0.0106411;
-                        _f = a0 - a1 * cos((2.f * M_PI * i) / points - 1) + \
-                            a2 * cos((4.f * M_PI * i) / points - 1) - \
-                            a3 * cos((6.f * M_PI * i) / points - 1);
-                        break;
-                    case 6:
-                        // Sine
-                        _f = sin((M_PI * i) / (points - 1));
-                        break;
-                    case 7:
-                        // Lanczos
-                        _f = sinc((2.f * i) / (points - 1) - 1);
-                        break;
-                    case 8:
-                        // Gauß
-                        _a = 2.718281828459045;
-                        _f = pow(_a, -0.5f * pow((i - (points - 1) / 2) / (0.4 * (points - 1) / 2.f), 2));
-                        break;
-                    case 9:
-                        // Bartlett
-                        _f = (2.f / (points - 1)) * (((points - 1) / 2.f) - \
-                            fabs(i - ((points - 1) / 2.f)));
-                        break;
-                    case 10:
-                        // Triangular
-                        _f = (2.f / points) * ((2.f / points) - fabs(i - ((points - 1) / 2.f)));
-                        break;
-                    case 11:
-                        // Bartlett-Hann
-                        a0 = 0.62;
-                        a1 = 0.48;
-                        a2 = 0.38;
-                        _f = a0 - a1 * fabs((i / (points - 1)) - 0.5) - \
-                            a2 * cos((2 * M_PI * i) / (points - 1));
-                        break;
-                }
-                L *= _f;
-                if(_param_mode > _m)
-                    R *= _f;
-
-                // perhaps we need to compute two FFT's, so store left and right
-                // channel in case we need only one FFT, the left channel is
-                // used as 'standard'"
-                float valL;
-                float valR;
-                
-                switch(_param_mode) {
-                    case 0:
-                    case 6:
-                        // average (mode 0)
-                        valL = (L + R) / 2;
-                        valR = (L + R) / 2;
-                        break;
-                    case 1:
-                    default:
-                        // left channel (mode 1)
-                        // or both channels (mode 3, 4, 5)
-                        valL = L;
-                        valR = R;
-                        break;
-                    case 2:
-                    case 8:
-                        // right channel (mode 2)
-                        valL = R;
-                        valR = L;
-                        break;
-                }
-                // store values in analyzer buffer
-                fft_inL[i] = valL;
-                fft_inR[i] = valR;
-                
-                // fill smoothing & falling buffer
-                if(_param_smooth == 2) {
-                    fft_smoothL[i] = fft_outL[i];
-                    fft_smoothR[i] = fft_outR[i];
-                }
-                if(_param_smooth == 1) {
-                    if(fft_smoothL[i] < fabs(fft_outL[i])) {
-                        fft_smoothL[i] = fabs(fft_outL[i]);
-                        fft_deltaL[i] = 1.f;
-                    }
-                    if(fft_smoothR[i] < fabs(fft_outR[i])) {
-                        fft_smoothR[i] = fabs(fft_outR[i]);
-                        fft_deltaR[i] = 1.f;
-                    }
-                }
-                
-                // fill hold buffer with last out values
-                // before fft is recalced
-                if(fabs(fft_outL[i]) > fft_holdL[i])
-                    fft_holdL[i] = fabs(fft_outL[i]);
-                if(fabs(fft_outR[i]) > fft_holdR[i])
-                    fft_holdR[i] = fabs(fft_outR[i]);
-            }
-            
-            // run fft
-            // this takes our latest buffer and returns an array with
-            // non-normalized
-            if (fft_plan)
-                fftwf_execute_r2r(fft_plan, fft_inL, fft_outL);
-            //run fft for for right channel too. it is needed for stereo image 
-            //and stereo difference modes
-            if(_param_mode >= 3 and fft_plan) {
-                fftwf_execute_r2r(fft_plan, fft_inR, fft_outR);
-            }
-            // ...and set some values for later use
-            ____analyzer_phase_was_drawn_here = 0;     
-            fftdone = true;  
-        }
-        ____analyzer_phase_was_drawn_here ++;
-    }
-    if (lintrans < 0) {
-        // accuracy was changed so we have to recalc linear transition
-        int _lintrans = (int)((float)points * log((20.f + 2.f * \
-            (float)srate / (float)_accuracy) / 20.f) / log(1000.f));  
-        lintrans = (int)(_lintrans + points % _lintrans / \
-            floor(points / _lintrans)) / 2; // / 4 was added to see finer bars but breaks low end
+    update_pixel_bins(points, _accuracy);
+    if(fftdone) {
+        postprocess(frame.outL, frame.outR, points, _accuracy);
+        if(_param_hold and _param_mode != 5)
+            postprocess(frame.holdL, frame.holdR, points, _accuracy);
     }
     for (int i = 0; i <= points; i++)
     {
@@ -1335,240 +1500,26 @@ bool analyzer_audio_module::get_graph(int index, int subindex, float *data, int
         // Real business starts here. We will cycle through all pixels in
         // x-direction of the line-graph and decide what to show
         // #####################################################################
-        // cycle through the points to draw
-        // we need to know the exact frequency at this pixel
-        freq = 20.f * pow (1000.f, (float)i / points);
-        
-        // we need to know the last drawn value over the time
-        float lastoutL = 0.f; 
-        float lastoutR = 0.f;
-        
-        // let's see how many pixels we may want to skip until the drawing
-        // function has to draw a bar/box/line
-        if(*params[param_analyzer_scale] or *params[param_analyzer_view] == 2) {
-            // we have linear view enabled or we want to see tit... erm curves
-            if((i % lintrans == 0 and points - i > lintrans) or i == points - 1) {
-                _iter = std::max(1, (int)floor(freq * \
-                    (float)_accuracy / (float)srate));
-            }    
-        } else {
-            // we have logarithmic view enabled
-            _iter = std::max(1, (int)floor(freq * (float)_accuracy / (float)srate));
-        }
+        _iter = pixel_bins[i];
         if(_iter > iter) {
             // we are flipping one step further in drawing
-            if(fftdone and i) {
-                // ################################
-                // Manipulate the fft_out values
-                // according to the post processing
-                // ################################
-                int n = 0;
-                float var1L = 0.f; // used later for denoising peaks
-                float var1R = 0.f;
-                float diff_fft;
-                switch(_param_mode) {
-                    default:
-                        // all normal modes
-                        posneg = 1;
-                        // only if we don't see difference mode
-                        switch((int)*params[param_analyzer_post]) {
-                            case 0:
-                                // Analyzer Normalized - nothing to do
-                                break;
-                            case 1:
-                                // Analyzer Additive - cycle through skipped values and
-                                // add them
-                                // if fft was renewed, recalc the absolute values if
-                                // frequencies are skipped
-                                for(int j = iter + 1; j < _iter; j++) {
-                                    fft_outL[_iter] += fabs(fft_outL[j]);
-                                    fft_outR[_iter] += fabs(fft_outR[j]);
-                                }
-                                fft_outL[_iter] /= (_iter - iter);
-                                fft_outR[_iter] /= (_iter - iter);
-                                break;
-                            case 2:
-                                // Analyzer Additive - cycle through skipped values and
-                                // add them
-                                // if fft was renewed, recalc the absolute values if
-                                // frequencies are skipped
-                                for(int j = iter + 1; j < _iter; j++) {
-                                    fft_outL[_iter] += fabs(fft_outL[j]);
-                                    fft_outR[_iter] += fabs(fft_outR[j]);
-                                }
-                                break;
-                            case 3:
-                                // Analyzer Denoised Peaks - filter out unwanted noise
-                                for(int k = 0; k < std::max(10 , std::min(400 ,\
-                                    (int)(2.f*(float)((_iter - iter))))); k++) {
-                                    //collect amplitudes in the environment of _iter to
-                                    //be able to erase them from signal and leave just
-                                    //the peaks
-                                    if(_iter - k > 0) {
-                                        var1L += fabs(fft_outL[_iter - k]);
-                                        n++;
-                                    }
-                                    if(k != 0) var1L += fabs(fft_outL[_iter + k]);
-                                    else if(i) var1L += fabs(lastoutL);
-                                    else var1L += fabs(fft_outL[_iter]);
-                                    if(_param_mode == 3 or _param_mode == 4) {
-                                        if(_iter - k > 0) {
-                                            var1R += fabs(fft_outR[_iter - k]);
-                                            n++;
-                                        }
-                                        if(k != 0) var1R += fabs(fft_outR[_iter + k]);
-                                        else if(i) var1R += fabs(lastoutR);
-                                        else var1R += fabs(fft_outR[_iter]);
-                                    }
-                                    n++;
-                                }
-                                //do not forget fft_out[_iter] for the next time
-                                lastoutL = fft_outL[_iter];
-                                //pumping up actual signal an erase surrounding
-                                // sounds
-                                fft_outL[_iter] = 0.25f * std::max(n * 0.6f * \
-                                    fabs(fft_outL[_iter]) - var1L , 1e-20);
-                                if(_param_mode == 3 or _param_mode == 4) {
-                                    // do the same with R channel if needed
-                                    lastoutR = fft_outR[_iter];
-                                    fft_outR[_iter] = 0.25f * std::max(n * \
-                                        0.6f * fabs(fft_outR[_iter]) - var1R , 1e-20);
-                                }
-                                break;
-                        }
-                        break;
-                    case 5:
-                        // Stereo Difference - draw the difference between left
-                        // and right channel if fft was renewed, recalc the
-                        // absolute values in left and right if frequencies are
-                        // skipped.
-                        // this is additive mode - no other mode is available
-                        for(int j = iter + 1; j < _iter; j++) {
-                            fft_outL[_iter] += fabs(fft_outL[j]);
-                            fft_outR[_iter] += fabs(fft_outR[j]);
-                        }
-                        //calculate difference between left an right channel                        
-                        diff_fft = fabs(fft_outL[_iter]) - fabs(fft_outR[_iter]);
-                        posneg = fabs(diff_fft) / diff_fft;
-                        fft_outL[_iter] = diff_fft / _accuracy;
-                        break;
-                }
-            }
             iter = _iter;
             // #######################################
-            // Calculate transitions for falling and
-            // smooting and fill delta buffers if fft
-            // was done above
-            // #######################################
-            if(subindex == 0) {
-                float _fdelta = 0.91;
-                if(_param_mode > 5 and _param_mode < 9)
-                    _fdelta = .99f;
-                float _ffactor = 2000.f;
-                if(_param_mode > 5 and _param_mode < 9)
-                    _ffactor = 50.f;
-                if(_param_smooth == 2) {
-                    // smoothing
-                    if(fftdone) {
-                        // rebuild delta values after fft was done
-                        if(_param_mode < 5 or _param_mode > 5) {
-                            fft_deltaL[iter] = pow(fabs(fft_outL[iter]) / fabs(fft_smoothL[iter]), 1.f / _param_speed);
-                        } else {
-                            fft_deltaL[iter] = (posneg * fabs(fft_outL[iter]) - fft_smoothL[iter]) / _param_speed;
-                        }
-                    } else {
-                        // change fft_smooth according to delta
-                        if(_param_mode < 5 or _param_mode > 5) {
-                            fft_smoothL[iter] *= fft_deltaL[iter];
-                        } else {
-                            fft_smoothL[iter] += fft_deltaL[iter];
-                        }
-                    }
-                } else if(_param_smooth == 1) {
-                    // falling
-                    if(fftdone) {
-                        // rebuild delta values after fft was done
-                        //fft_deltaL[iter] = _fdelta;
-                    }
-                    // change fft_smooth according to delta
-                    fft_smoothL[iter] *= fft_deltaL[iter];
-                    
-                    if(fft_deltaL[iter] > _fdelta) {
-                        fft_deltaL[iter] *= 1.f - (16.f - _param_speed) / _ffactor;
-                    }
-                }
-                
-                if(_param_mode > 2 and _param_mode < 5) {
-                    // we need right buffers, too for stereo image and
-                    // stereo analyzer
-                    if(_param_smooth == 2) {
-                        // smoothing
-                        if(fftdone) {
-                            // rebuild delta values after fft was done
-                            if(_param_mode < 5) {
-                                fft_deltaR[iter] = pow(fabs(fft_outR[iter]) / fabs(fft_smoothR[iter]), 1.f / _param_speed);
-                            } else {
-                                fft_deltaR[iter] = (posneg * fabs(fft_outR[iter]) - fft_smoothR[iter]) / _param_speed;
-                            }
-                        } else {
-                            // change fft_smooth according to delta
-                            if(_param_mode < 5) {
-                                fft_smoothR[iter] *= fft_deltaR[iter];
-                            } else {
-                                fft_smoothR[iter] += fft_deltaR[iter];
-                            }
-                        }
-                    } else if(_param_smooth == 1) {
-                        // falling
-                        if(fftdone) {
-                            // rebuild delta values after fft was done
-                            //fft_deltaR[iter] = _fdelta;
-                        }
-                        // change fft_smooth according to delta
-                        fft_smoothR[iter] *= fft_deltaR[iter];
-                        if(fft_deltaR[iter] > _fdelta)
-                            fft_deltaR[iter] *= 1.f - (16.f - _param_speed) / 2000.f;
-                    }
-                }
-            }
-            // #######################################
             // Choose the L and R value from the right
             // buffer according to view settings
             // #######################################
             float valL = 0.f;
             float valR = 0.f;
-            if (*params[param_analyzer_freeze]) {
-                // freeze enabled
-                valL = fft_freezeL[iter];
-                valR = fft_freezeR[iter];
-            } else if ((subindex == 1 and _param_mode < 3) \
+            if ((subindex == 1 and _param_mode < 3) \
                 or subindex > 1 \
                 or (_param_mode > 5 and *params[param_analyzer_hold])) {
                 // we draw the hold buffer
-                valL = fft_holdL[iter];
-                valR = fft_holdR[iter];
+                valL = frame.holdL[iter];
+                valR = frame.holdR[iter];
             } else {
-                // we draw normally (no freeze)
-                switch(_param_smooth) {
-                    case 0:
-                        // off
-                        valL = fft_outL[iter];
-                        valR = fft_outR[iter];
-                        break;
-                    case 1:
-                        // falling
-                        valL = fft_smoothL[iter];
-                        valR = fft_smoothR[iter];
-                        break;
-                    case 2:
-                        // smoothing
-                        valL = fft_smoothL[iter];
-                        valR = fft_smoothR[iter];
-                        break;
-                }
-                // fill freeze buffer
-                fft_freezeL[iter] = valL;
-                fft_freezeR[iter] = valR;
+                // we draw normally (smoothing and falling are done by the worker)
+                valL = frame.outL[iter];
+                valR = frame.outR[iter];
             }
             if(*params[param_analyzer_view] < 2) {
                 // #####################################
@@ -1788,7 +1739,6 @@ bool analyzer_audio_module::get_graph(int index, int subindex, float *data, int
         *mode = 0;
     }
     } // if (mode)
-    ____analyzer_sanitize = 0;
     return true;
 }
 
@@ -50,12 +50,19 @@ multibandcompressor_audio_module::multibandcompressor_audio_module()
     meter_inR  = 0.f;
     meter_outL = 0.f;
     meter_outR = 0.f;
-    for(int i = 0; i < strips - 1; i ++) {
-        freq_old[i] = -1;
-        sep_old[i] = -1;
-        q_old[i] = -1;
-    }
-    mode_old = -1;
+    // long blocks go through the bands PARALLEL_RUN samples at a time,
+    // on the worker threads if there are any
+    pool = calf_utils::task_pool::get_shared();
+    band_buffer_size = PARALLEL_RUN;
+    band_buffer = new float[strips * 2 * band_buffer_size];
+    for (int i = 0; i < strips * 2; i++)
+        bands[i] = band_buffer + i * band_buffer_size;
+    band_run = 0;
+}
+
+multibandcompressor_audio_module::~multibandcompressor_audio_module()
+{
+    delete []band_buffer;
 }
 
 void multibandcompressor_audio_module::activate()
@@ -90,63 +97,11 @@ void multibandcompressor_audio_module::params_changed()
             *params[param_solo1] > 0.f ||
             *params[param_solo2] > 0.f ||
             *params[param_solo3] > 0.f) ? false : true;
-    int i;
-    int j1;
-    switch(mode) {
-        case 0:
-        default:
-            j1 = 0;
-            break;
-        case 1:
-            j1 = 2;
-            break;
-    }
-    // set the params of all filters
-    if(*params[param_freq0] != freq_old[0] or *params[param_sep0] != sep_old[0] or *params[param_q0] != q_old[0] or *params[param_mode] != mode_old) {
-        lpL[0][0].set_lp_rbj((float)(*params[param_freq0] * (1 - *params[param_sep0])), *params[param_q0], (float)srate);
-        hpL[0][0].set_hp_rbj((float)(*params[param_freq0] * (1 + *params[param_sep0])), *params[param_q0], (float)srate);
-        lpR[0][0].copy_coeffs(lpL[0][0]);
-        hpR[0][0].copy_coeffs(hpL[0][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[0][i].copy_coeffs(lpL[0][0]);
-            hpL[0][i].copy_coeffs(hpL[0][0]);
-            lpR[0][i].copy_coeffs(lpL[0][0]);
-            hpR[0][i].copy_coeffs(hpL[0][0]);
-        }
-        freq_old[0] = *params[param_freq0];
-        sep_old[0]  = *params[param_sep0];
-        q_old[0]    = *params[param_q0];
-    }
-    if(*params[param_freq1] != freq_old[1] or *params[param_sep1] != sep_old[1] or *params[param_q1] != q_old[1] or *params[param_mode] != mode_old) {
-        lpL[1][0].set_lp_rbj((float)(*params[param_freq1] * (1 - *params[param_sep1])), *params[param_q1], (float)srate);
-        hpL[1][0].set_hp_rbj((float)(*params[param_freq1] * (1 + *params[param_sep1])), *params[param_q1], (float)srate);
-        lpR[1][0].copy_coeffs(lpL[1][0]);
-        hpR[1][0].copy_coeffs(hpL[1][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[1][i].copy_coeffs(lpL[1][0]);
-            hpL[1][i].copy_coeffs(hpL[1][0]);
-            lpR[1][i].copy_coeffs(lpL[1][0]);
-            hpR[1][i].copy_coeffs(hpL[1][0]);
-        }
-        freq_old[1] = *params[param_freq1];
-        sep_old[1]  = *params[param_sep1];
-        q_old[1]    = *params[param_q1];
-    }
-    if(*params[param_freq2] != freq_old[2] or *params[param_sep2] != sep_old[2] or *params[param_q2] != q_old[2] or *params[param_mode] != mode_old) {
-        lpL[2][0].set_lp_rbj((float)(*params[param_freq2] * (1 - *params[param_sep2])), *params[param_q2], (float)srate);
-        hpL[2][0].set_hp_rbj((float)(*params[param_freq2] * (1 + *params[param_sep2])), *params[param_q2], (float)srate);
-        lpR[2][0].copy_coeffs(lpL[2][0]);
-        hpR[2][0].copy_coeffs(hpL[2][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[2][i].copy_coeffs(lpL[2][0]);
-            hpL[2][i].copy_coeffs(hpL[2][0]);
-            lpR[2][i].copy_coeffs(lpL[2][0]);
-            hpR[2][i].copy_coeffs(hpL[2][0]);
-        }
-        freq_old[2] = *params[param_freq2];
-        sep_old[2]  = *params[param_sep2];
-        q_old[2]    = *params[param_q2];
-    }
+    // set the params of all filters (the crossover only recomputes the splits that changed)
+    xover.set_mode((int)*params[param_mode]);
+    xover.set_freq(0, *params[param_freq0]);
+    xover.set_freq(1, *params[param_freq1]);
+    xover.set_freq(2, *params[param_freq2]);
     // set the params of all strips
     strip[0].set_params(*params[param_attack0], *params[param_release0], *params[param_threshold0], *params[param_ratio0], *params[param_knee0], *params[param_makeup0], *params[param_detection0], 1.f, *params[param_bypass0], !(solo[0] || no_solo));
     strip[1].set_params(*params[param_attack1], *params[param_release1], *params[param_threshold1], *params[param_ratio1], *params[param_knee1], *params[param_makeup1], *params[param_detection1], 1.f, *params[param_bypass1], !(solo[1] || no_solo));
@@ -157,6 +112,7 @@ void multibandcompressor_audio_module::params_changed()
 void multibandcompressor_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
+    xover.set_sample_rate(srate);
     // set srate of all strips
     for (int j = 0; j < strips; j ++) {
         strip[j].set_sample_rate(srate);
@@ -175,147 +131,102 @@ void multibandcompressor_audio_module::set_sample_rate(uint32_t sr)
     if(params[param_output##index] != NULL) \
         *params[param_output##index] = strip[index].get_output_level();
 
-uint32_t multibandcompressor_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
+void multibandcompressor_audio_module::split(uint32_t offset, uint32_t pos, uint32_t len)
 {
-    bool bypass = *params[param_bypass] > 0.5f;
-    numsamples += offset;
-    for (int i = 0; i < strips; i++)
-        strip[i].update_curve();
-    if(bypass) {
-        // everything bypassed
-        while(offset < numsamples) {
-            outs[0][offset] = ins[0][offset];
-            outs[1][offset] = ins[1][offset];
-            ++offset;
-        }
-        // displays, too
-        clip_inL    = 0.f;
-        clip_inR    = 0.f;
-        clip_outL   = 0.f;
-        clip_outR   = 0.f;
-        meter_inL  = 0.f;
-        meter_inR  = 0.f;
-        meter_outL = 0.f;
-        meter_outR = 0.f;
-    } else {
-        // process all strips
-
-        // let meters fall a bit
-        clip_inL    -= std::min(clip_inL,  numsamples);
-        clip_inR    -= std::min(clip_inR,  numsamples);
-        clip_outL   -= std::min(clip_outL, numsamples);
-        clip_outR   -= std::min(clip_outR, numsamples);
-        meter_inL = 0.f;
-        meter_inR = 0.f;
-        meter_outL = 0.f;
-        meter_outR = 0.f;
-        while(offset < numsamples) {
-            // cycle through samples
-            float inL = ins[0][offset];
-            float inR = ins[1][offset];
-            // in level
-            inR *= *params[param_level_in];
-            inL *= *params[param_level_in];
-            // out vars
-            float outL = 0.f;
-            float outR = 0.f;
-            int j1;
-            for (int i = 0; i < strips; i ++) {
-                // cycle trough strips
-                if (solo[i] || no_solo) {
-                    // strip unmuted
-                    float left  = inL;
-                    float right = inR;
-                    // send trough filters
-                    switch(mode) {
-                        case 0:
-                        default:
-                            j1 = 0;
-                            break;
-                        case 1:
-                            j1 = 2;
-                            break;
-                    }
-                    for (int j = 0; j <= j1; j++){
-                        if(i + 1 < strips) {
-                            left  = lpL[i][j].process(left);
-                            right = lpR[i][j].process(right);
-                            lpL[i][j].sanitize();
-                            lpR[i][j].sanitize();
-                        }
-                        if(i - 1 >= 0) {
-                            left  = hpL[i - 1][j].process(left);
-                            right = hpR[i - 1][j].process(right);
-                            hpL[i - 1][j].sanitize();
-                            hpR[i - 1][j].sanitize();
-                        }
-                    }
-                    // process gain reduction
-                    strip[i].process(left, right);
-                    // sum up output
-                    outL += left;
-                    outR += right;
-                } else {
-                    // strip muted
-
-                }
-
-
-            } // process single strip
-
-            // even out filters gain reduction
-            // 3dB - levelled manually (based on default sep and q settings)
-            switch(mode) {
-                case 0:
-                    outL *= 1.414213562;
-                    outR *= 1.414213562;
-                    break;
-                case 1:
-                    outL *= 0.88;
-                    outR *= 0.88;
-                    break;
-            }
+    // in level, straight into the buffers of the top band (the crossover
+    // splits them in place)
+    float *topL = bands[strips * 2 - 2] + pos, *topR = bands[strips * 2 - 1] + pos;
+    for (uint32_t i = 0; i < len; i++) {
+        topL[i] = ins[0][offset + i] * *params[param_level_in];
+        topR[i] = ins[1][offset + i] * *params[param_level_in];
+    }
+    float *outs[strips * 2];
+    for (int i = 0; i < strips * 2; i++)
+        outs[i] = bands[i] + pos;
+    xover.process(topL, topR, outs, len);
+}
 
-            // out level
-            outL *= *params[param_level_out];
-            outR *= *params[param_level_out];
+void multibandcompressor_audio_module::process_band(int band, uint32_t pos, uint32_t len)
+{
+    // muted strips are not processed at all
+    if (solo[band] || no_solo)
+        strip[band].process_block(bands[band * 2] + pos, bands[band * 2 + 1] + pos, len);
+}
 
-            // send to output
-            outs[0][offset] = outL;
-            outs[1][offset] = outR;
+void multibandcompressor_audio_module::process_band_task(void *arg, int band)
+{
+    multibandcompressor_audio_module *self = (multibandcompressor_audio_module *)arg;
+    dsp::denormal_guard guard;
+    self->process_band(band, 0, self->band_run);
+}
 
-            // clip LED's
-            if(inL > 1.f) {
-                clip_inL  = srate >> 3;
-            }
-            if(inR > 1.f) {
-                clip_inR  = srate >> 3;
-            }
-            if(outL > 1.f) {
-                clip_outL = srate >> 3;
-            }
-            if(outR > 1.f) {
-                clip_outR = srate >> 3;
-            }
-            // set up in / out meters
-            if(inL > meter_inL) {
-                meter_inL = inL;
-            }
-            if(inR > meter_inR) {
-                meter_inR = inR;
-            }
-            if(outL > meter_outL) {
-                meter_outL = outL;
-            }
-            if(outR > meter_outR) {
-                meter_outR = outR;
+void multibandcompressor_audio_module::mix(uint32_t offset, uint32_t pos, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        float inL = ins[0][offset + i] * *params[param_level_in];
+        float inR = ins[1][offset + i] * *params[param_level_in];
+        // sum up the unmuted strips
+        float outL = 0.f;
+        float outR = 0.f;
+        for (int j = 0; j < strips; j ++) {
+            if (solo[j] || no_solo) {
+                outL += bands[j * 2][pos + i];
+                outR += bands[j * 2 + 1][pos + i];
             }
-            // next sample
-            ++offset;
-        } // cycle trough samples
+        }
+
+        // out level
+        outL *= *params[param_level_out];
+        outR *= *params[param_level_out];
+
+        // send to output
+        outs[0][offset + i] = outL;
+        outs[1][offset + i] = outR;
+
+        // clip LED's
+        if(inL > 1.f) {
+            clip_inL  = srate >> 3;
+        }
+        if(inR > 1.f) {
+            clip_inR  = srate >> 3;
+        }
+        if(outL > 1.f) {
+            clip_outL = srate >> 3;
+        }
+        if(outR > 1.f) {
+            clip_outR = srate >> 3;
+        }
+        // set up in / out meters
+        if(inL > meter_inL) {
+            meter_inL = inL;
+        }
+        if(inR > meter_inR) {
+            meter_inR = inR;
+        }
+        if(outL > meter_outL) {
+            meter_outL = outL;
+        }
+        if(outR > meter_outR) {
+            meter_outR = outR;
+        }
+    }
+}
 
-    } // process all strips (no bypass)
+void multibandcompressor_audio_module::begin_meters(uint32_t numsamples)
+{
+    // let meters fall a bit
+    clip_inL    -= std::min(clip_inL,  numsamples);
+    clip_inR    -= std::min(clip_inR,  numsamples);
+    clip_outL   -= std::min(clip_outL, numsamples);
+    clip_outR   -= std::min(clip_outR, numsamples);
+    meter_inL = 0.f;
+    meter_inR = 0.f;
+    meter_outL = 0.f;
+    meter_outR = 0.f;
+}
 
+void multibandcompressor_audio_module::set_meters(bool bypass)
+{
     // draw meters
     SET_IF_CONNECTED(clip_inL);
     SET_IF_CONNECTED(clip_inR);
@@ -326,7 +237,7 @@ uint32_t multibandcompressor_audio_module::process(uint32_t offset, uint32_t num
     SET_IF_CONNECTED(meter_outL);
     SET_IF_CONNECTED(meter_outR);
     // draw strip meters
-    if(bypass > 0.5f) {
+    if(bypass) {
         BYPASSED_COMPRESSION(0)
         BYPASSED_COMPRESSION(1)
         BYPASSED_COMPRESSION(2)
@@ -337,10 +248,67 @@ uint32_t multibandcompressor_audio_module::process(uint32_t offset, uint32_t num
         ACTIVE_COMPRESSION(2)
         ACTIVE_COMPRESSION(3)
     }
+}
+
+uint32_t multibandcompressor_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
+{
+    bool bypass = *params[param_bypass] > 0.5f;
+    numsamples += offset;
+    for (int i = 0; i < strips; i++)
+        strip[i].update_curve();
+    if(bypass) {
+        // everything bypassed
+        while(offset < numsamples) {
+            outs[0][offset] = ins[0][offset];
+            outs[1][offset] = ins[1][offset];
+            ++offset;
+        }
+        // displays, too
+        clip_inL    = 0.f;
+        clip_inR    = 0.f;
+        clip_outL   = 0.f;
+        clip_outR   = 0.f;
+        meter_inL  = 0.f;
+        meter_inR  = 0.f;
+        meter_outL = 0.f;
+        meter_outR = 0.f;
+    } else {
+        // split -> process all strips -> sum up
+        uint32_t len = numsamples - offset;
+        begin_meters(numsamples);
+        split(offset, 0, len);
+        for (int i = 0; i < strips; i++)
+            process_band(i, 0, len);
+        mix(offset, 0, len);
+    }
+    set_meters(bypass);
     // whatever has to be returned x)
     return outputs_mask;
 }
 
+uint32_t multibandcompressor_audio_module::process_slice(uint32_t offset, uint32_t end)
+{
+    if (end - offset < PARALLEL_MIN_RUN || *params[param_bypass] > 0.5f)
+        return audio_module<multibandcompressor_metadata>::process_slice(offset, end);
+    // long blocks: the strips run on the worker threads (if any), each one
+    // over up to PARALLEL_RUN samples at a time
+    dsp::denormal_guard guard;
+    for (int i = 0; i < strips; i++)
+        strip[i].update_curve();
+    begin_meters(end - offset);
+    while(offset < end) {
+        uint32_t len = std::min<uint32_t>(end - offset, band_buffer_size);
+        for (uint32_t pos = 0; pos < len; pos += MAX_SAMPLE_RUN)
+            split(offset + pos, pos, std::min<uint32_t>(len - pos, MAX_SAMPLE_RUN));
+        band_run = len;
+        pool->run(process_band_task, this, strips);
+        mix(offset, 0, len);
+        offset += len;
+    }
+    set_meters(false);
+    return 3;
+}
+
 const gain_reduction_audio_module *multibandcompressor_audio_module::get_strip_by_param_index(int index) const
 {
     // let's handle by the corresponding strip
@@ -579,6 +547,35 @@ sidechaincompressor_audio_module::cfloat sidechaincompressor_audio_module::h_z(c
     }
 }
 
+/// The same sections as h_z
+void sidechaincompressor_audio_module::build_response() const
+{
+    response.clear();
+    switch ((CalfScModes)sc_mode) {
+        default:
+        case WIDEBAND:
+            // no filter in the sidechain, no curve (as with a gain of 0)
+            response.add(0.f, 0.f, 0.f, 0.f, 0.f);
+            break;
+        case DEESSER_WIDE:
+        case DERUMBLER_WIDE:
+        case WEIGHTED_1:
+        case WEIGHTED_2:
+        case WEIGHTED_3:
+        case BANDPASS_2:
+            response.add(f1L);
+            response.add(f2L);
+            break;
+        case DEESSER_SPLIT:
+            response.add(f2L);
+            break;
+        case DERUMBLER_SPLIT:
+        case BANDPASS_1:
+            response.add(f1L);
+            break;
+    }
+}
+
 float sidechaincompressor_audio_module::freq_gain(int index, double freq, uint32_t sr) const
 {
     typedef std::complex<double> cfloat;
@@ -871,7 +868,8 @@ bool sidechaincompressor_audio_module::get_graph(int index, int subindex, float
         return false;
     if (index == param_f1_freq && !subindex) {
         context->set_line_width(1.5);
-        return ::get_graph(*this, subindex, data, points);
+        build_response();
+        return response.get_graph(data, points, srate);
     } else if(index == param_compression) {
         return compressor.get_graph(subindex, data, points, context, mode);
     }
@@ -1133,7 +1131,10 @@ bool deesser_audio_module::get_graph(int index, int subindex, float *data, int p
         return false;
     if (index == param_f1_freq && !subindex) {
         context->set_line_width(1.5);
-        return ::get_graph(*this, subindex, data, points);
+        response.clear();
+        response.add(hpL);
+        response.add(pL);
+        return response.get_graph(data, points, srate);
     }
     return false;
 }
@@ -1363,6 +1364,35 @@ sidechaingate_audio_module::cfloat sidechaingate_audio_module::h_z(const cfloat
     }
 }
 
+/// The same sections as h_z
+void sidechaingate_audio_module::build_response() const
+{
+    response.clear();
+    switch ((CalfScModes)sc_mode) {
+        default:
+        case WIDEBAND:
+            // no filter in the sidechain, no curve (as with a gain of 0)
+            response.add(0.f, 0.f, 0.f, 0.f, 0.f);
+            break;
+        case HIGHGATE_WIDE:
+        case LOWGATE_WIDE:
+        case WEIGHTED_1:
+        case WEIGHTED_2:
+        case WEIGHTED_3:
+        case BANDPASS_2:
+            response.add(f1L);
+            response.add(f2L);
+            break;
+        case HIGHGATE_SPLIT:
+            response.add(f2L);
+            break;
+        case LOWGATE_SPLIT:
+        case BANDPASS_1:
+            response.add(f1L);
+            break;
+    }
+}
+
 float sidechaingate_audio_module::freq_gain(int index, double freq, uint32_t sr) const
 {
     typedef std::complex<double> cfloat;
@@ -1658,7 +1688,8 @@ bool sidechaingate_audio_module::get_graph(int index, int subindex, float *data,
         return false;
     if (index == param_f1_freq && !subindex) {
         context->set_line_width(1.5);
-        return ::get_graph(*this, subindex, data, points);
+        build_response();
+        return response.get_graph(data, points, srate);
     } else if(index == param_gating) {
         return gate.get_graph(subindex, data, points, context, mode);
     }
@@ -1745,12 +1776,19 @@ multibandgate_audio_module::multibandgate_audio_module()
     meter_inR  = 0.f;
     meter_outL = 0.f;
     meter_outR = 0.f;
-    for(int i = 0; i < strips - 1; i ++) {
-        freq_old[i] = -1;
-        sep_old[i] = -1;
-        q_old[i] = -1;
-    }
-    mode_old = -1;
+    // long blocks go through the bands PARALLEL_RUN samples at a time,
+    // on the worker threads if there are any
+    pool = calf_utils::task_pool::get_shared();
+    band_buffer_size = PARALLEL_RUN;
+    band_buffer = new float[strips * 2 * band_buffer_size];
+    for (int i = 0; i < strips * 2; i++)
+        bands[i] = band_buffer + i * band_buffer_size;
+    band_run = 0;
+}
+
+multibandgate_audio_module::~multibandgate_audio_module()
+{
+    delete []band_buffer;
 }
 
 void multibandgate_audio_module::activate()
@@ -1785,63 +1823,11 @@ void multibandgate_audio_module::params_changed()
             *params[param_solo1] > 0.f ||
             *params[param_solo2] > 0.f ||
             *params[param_solo3] > 0.f) ? false : true;
-    int i;
-    int j1;
-    switch(mode) {
-        case 0:
-        default:
-            j1 = 0;
-            break;
-        case 1:
-            j1 = 2;
-            break;
-    }
-    // set the params of all filters
-    if(*params[param_freq0] != freq_old[0] or *params[param_sep0] != sep_old[0] or *params[param_q0] != q_old[0] or *params[param_mode] != mode_old) {
-        lpL[0][0].set_lp_rbj((float)(*params[param_freq0] * (1 - *params[param_sep0])), *params[param_q0], (float)srate);
-        hpL[0][0].set_hp_rbj((float)(*params[param_freq0] * (1 + *params[param_sep0])), *params[param_q0], (float)srate);
-        lpR[0][0].copy_coeffs(lpL[0][0]);
-        hpR[0][0].copy_coeffs(hpL[0][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[0][i].copy_coeffs(lpL[0][0]);
-            hpL[0][i].copy_coeffs(hpL[0][0]);
-            lpR[0][i].copy_coeffs(lpL[0][0]);
-            hpR[0][i].copy_coeffs(hpL[0][0]);
-        }
-        freq_old[0] = *params[param_freq0];
-        sep_old[0]  = *params[param_sep0];
-        q_old[0]    = *params[param_q0];
-    }
-    if(*params[param_freq1] != freq_old[1] or *params[param_sep1] != sep_old[1] or *params[param_q1] != q_old[1] or *params[param_mode] != mode_old) {
-        lpL[1][0].set_lp_rbj((float)(*params[param_freq1] * (1 - *params[param_sep1])), *params[param_q1], (float)srate);
-        hpL[1][0].set_hp_rbj((float)(*params[param_freq1] * (1 + *params[param_sep1])), *params[param_q1], (float)srate);
-        lpR[1][0].copy_coeffs(lpL[1][0]);
-        hpR[1][0].copy_coeffs(hpL[1][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[1][i].copy_coeffs(lpL[1][0]);
-            hpL[1][i].copy_coeffs(hpL[1][0]);
-            lpR[1][i].copy_coeffs(lpL[1][0]);
-            hpR[1][i].copy_coeffs(hpL[1][0]);
-        }
-        freq_old[1] = *params[param_freq1];
-        sep_old[1]  = *params[param_sep1];
-        q_old[1]    = *params[param_q1];
-    }
-    if(*params[param_freq2] != freq_old[2] or *params[param_sep2] != sep_old[2] or *params[param_q2] != q_old[2] or *params[param_mode] != mode_old) {
-        lpL[2][0].set_lp_rbj((float)(*params[param_freq2] * (1 - *params[param_sep2])), *params[param_q2], (float)srate);
-        hpL[2][0].set_hp_rbj((float)(*params[param_freq2] * (1 + *params[param_sep2])), *params[param_q2], (float)srate);
-        lpR[2][0].copy_coeffs(lpL[2][0]);
-        hpR[2][0].copy_coeffs(hpL[2][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[2][i].copy_coeffs(lpL[2][0]);
-            hpL[2][i].copy_coeffs(hpL[2][0]);
-            lpR[2][i].copy_coeffs(lpL[2][0]);
-            hpR[2][i].copy_coeffs(hpL[2][0]);
-        }
-        freq_old[2] = *params[param_freq2];
-        sep_old[2]  = *params[param_sep2];
-        q_old[2]    = *params[param_q2];
-    }
+    // set the params of all filters (the crossover only recomputes the splits that changed)
+    xover.set_mode((int)*params[param_mode]);
+    xover.set_freq(0, *params[param_freq0]);
+    xover.set_freq(1, *params[param_freq1]);
+    xover.set_freq(2, *params[param_freq2]);
     // set the params of all strips
     gate[0].set_params(*params[param_attack0], *params[param_release0], *params[param_threshold0], *params[param_ratio0], *params[param_knee0], *params[param_makeup0], *params[param_detection0], 1.f, *params[param_bypass0], !(solo[0] || no_solo), *params[param_range0]);
     gate[1].set_params(*params[param_attack1], *params[param_release1], *params[param_threshold1], *params[param_ratio1], *params[param_knee1], *params[param_makeup1], *params[param_detection1], 1.f, *params[param_bypass1], !(solo[1] || no_solo), *params[param_range1]);
@@ -1852,6 +1838,7 @@ void multibandgate_audio_module::params_changed()
 void multibandgate_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
+    xover.set_sample_rate(srate);
     // set srate of all strips
     for (int j = 0; j < strips; j ++) {
         gate[j].set_sample_rate(srate);
@@ -1870,147 +1857,102 @@ void multibandgate_audio_module::set_sample_rate(uint32_t sr)
     if(params[param_output##index] != NULL) \
         *params[param_output##index] = gate[index].get_output_level();
 
-uint32_t multibandgate_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
+void multibandgate_audio_module::split(uint32_t offset, uint32_t pos, uint32_t len)
 {
-    bool bypass = *params[param_bypass] > 0.5f;
-    numsamples += offset;
-    for (int i = 0; i < strips; i++)
-        gate[i].update_curve();
-    if(bypass) {
-        // everything bypassed
-        while(offset < numsamples) {
-            outs[0][offset] = ins[0][offset];
-            outs[1][offset] = ins[1][offset];
-            ++offset;
-        }
-        // displays, too
-        clip_inL    = 0.f;
-        clip_inR    = 0.f;
-        clip_outL   = 0.f;
-        clip_outR   = 0.f;
-        meter_inL  = 0.f;
-        meter_inR  = 0.f;
-        meter_outL = 0.f;
-        meter_outR = 0.f;
-    } else {
-        // process all strips
-
-        // let meters fall a bit
-        clip_inL    -= std::min(clip_inL,  numsamples);
-        clip_inR    -= std::min(clip_inR,  numsamples);
-        clip_outL   -= std::min(clip_outL, numsamples);
-        clip_outR   -= std::min(clip_outR, numsamples);
-        meter_inL = 0.f;
-        meter_inR = 0.f;
-        meter_outL = 0.f;
-        meter_outR = 0.f;
-        while(offset < numsamples) {
-            // cycle through samples
-            float inL = ins[0][offset];
-            float inR = ins[1][offset];
-            // in level
-            inR *= *params[param_level_in];
-            inL *= *params[param_level_in];
-            // out vars
-            float outL = 0.f;
-            float outR = 0.f;
-            int j1;
-            for (int i = 0; i < strips; i ++) {
-                // cycle trough strips
-                if (solo[i] || no_solo) {
-                    // strip unmuted
-                    float left  = inL;
-                    float right = inR;
-                    // send trough filters
-                    switch(mode) {
-                        case 0:
-                        default:
-                            j1 = 0;
-                            break;
-                        case 1:
-                            j1 = 2;
-                            break;
-                    }
-                    for (int j = 0; j <= j1; j++){
-                        if(i + 1 < strips) {
-                            left  = lpL[i][j].process(left);
-                            right = lpR[i][j].process(right);
-                            lpL[i][j].sanitize();
-                            lpR[i][j].sanitize();
-                        }
-                        if(i - 1 >= 0) {
-                            left  = hpL[i - 1][j].process(left);
-                            right = hpR[i - 1][j].process(right);
-                            hpL[i - 1][j].sanitize();
-                            hpR[i - 1][j].sanitize();
-                        }
-                    }
-                    // process gain reduction
-                    gate[i].process(left, right);
-                    // sum up output
-                    outL += left;
-                    outR += right;
-                } else {
-                    // strip muted
-
-                }
-
-
-            } // process single strip
-
-            // even out filters gain reduction
-            // 3dB - levelled manually (based on default sep and q settings)
-            switch(mode) {
-                case 0:
-                    outL *= 1.414213562;
-                    outR *= 1.414213562;
-                    break;
-                case 1:
-                    outL *= 0.88;
-                    outR *= 0.88;
-                    break;
-            }
+    // in level, straight into the buffers of the top band (the crossover
+    // splits them in place)
+    float *topL = bands[strips * 2 - 2] + pos, *topR = bands[strips * 2 - 1] + pos;
+    for (uint32_t i = 0; i < len; i++) {
+        topL[i] = ins[0][offset + i] * *params[param_level_in];
+        topR[i] = ins[1][offset + i] * *params[param_level_in];
+    }
+    float *outs[strips * 2];
+    for (int i = 0; i < strips * 2; i++)
+        outs[i] = bands[i] + pos;
+    xover.process(topL, topR, outs, len);
+}
 
-            // out level
-            outL *= *params[param_level_out];
-            outR *= *params[param_level_out];
+void multibandgate_audio_module::process_band(int band, uint32_t pos, uint32_t len)
+{
+    // muted strips are not processed at all
+    if (solo[band] || no_solo)
+        gate[band].process_block(bands[band * 2] + pos, bands[band * 2 + 1] + pos, len);
+}
 
-            // send to output
-            outs[0][offset] = outL;
-            outs[1][offset] = outR;
+void multibandgate_audio_module::process_band_task(void *arg, int band)
+{
+    multibandgate_audio_module *self = (multibandgate_audio_module *)arg;
+    dsp::denormal_guard guard;
+    self->process_band(band, 0, self->band_run);
+}
 
-            // clip LED's
-            if(inL > 1.f) {
-                clip_inL  = srate >> 3;
-            }
-            if(inR > 1.f) {
-                clip_inR  = srate >> 3;
-            }
-            if(outL > 1.f) {
-                clip_outL = srate >> 3;
-            }
-            if(outR > 1.f) {
-                clip_outR = srate >> 3;
-            }
-            // set up in / out meters
-            if(inL > meter_inL) {
-                meter_inL = inL;
-            }
-            if(inR > meter_inR) {
-                meter_inR = inR;
-            }
-            if(outL > meter_outL) {
-                meter_outL = outL;
-            }
-            if(outR > meter_outR) {
-                meter_outR = outR;
+void multibandgate_audio_module::mix(uint32_t offset, uint32_t pos, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        float inL = ins[0][offset + i] * *params[param_level_in];
+        float inR = ins[1][offset + i] * *params[param_level_in];
+        // sum up the unmuted strips
+        float outL = 0.f;
+        float outR = 0.f;
+        for (int j = 0; j < strips; j ++) {
+            if (solo[j] || no_solo) {
+                outL += bands[j * 2][pos + i];
+                outR += bands[j * 2 + 1][pos + i];
             }
-            // next sample
-            ++offset;
-        } // cycle trough samples
+        }
+
+        // out level
+        outL *= *params[param_level_out];
+        outR *= *params[param_level_out];
 
-    } // process all strips (no bypass)
+        // send to output
+        outs[0][offset + i] = outL;
+        outs[1][offset + i] = outR;
 
+        // clip LED's
+        if(inL > 1.f) {
+            clip_inL  = srate >> 3;
+        }
+        if(inR > 1.f) {
+            clip_inR  = srate >> 3;
+        }
+        if(outL > 1.f) {
+            clip_outL = srate >> 3;
+        }
+        if(outR > 1.f) {
+            clip_outR = srate >> 3;
+        }
+        // set up in / out meters
+        if(inL > meter_inL) {
+            meter_inL = inL;
+        }
+        if(inR > meter_inR) {
+            meter_inR = inR;
+        }
+        if(outL > meter_outL) {
+            meter_outL = outL;
+        }
+        if(outR > meter_outR) {
+            meter_outR = outR;
+        }
+    }
+}
+
+void multibandgate_audio_module::begin_meters(uint32_t numsamples)
+{
+    // let meters fall a bit
+    clip_inL    -= std::min(clip_inL,  numsamples);
+    clip_inR    -= std::min(clip_inR,  numsamples);
+    clip_outL   -= std::min(clip_outL, numsamples);
+    clip_outR   -= std::min(clip_outR, numsamples);
+    meter_inL = 0.f;
+    meter_inR = 0.f;
+    meter_outL = 0.f;
+    meter_outR = 0.f;
+}
+
+void multibandgate_audio_module::set_meters(bool bypass)
+{
     // draw meters
     SET_IF_CONNECTED(clip_inL);
     SET_IF_CONNECTED(clip_inR);
@@ -2021,7 +1963,7 @@ uint32_t multibandgate_audio_module::process(uint32_t offset, uint32_t numsample
     SET_IF_CONNECTED(meter_outL);
     SET_IF_CONNECTED(meter_outR);
     // draw strip meters
-    if(bypass > 0.5f) {
+    if(bypass) {
         BYPASSED_GATING(0)
         BYPASSED_GATING(1)
         BYPASSED_GATING(2)
@@ -2032,10 +1974,67 @@ uint32_t multibandgate_audio_module::process(uint32_t offset, uint32_t numsample
         ACTIVE_GATING(2)
         ACTIVE_GATING(3)
     }
+}
+
+uint32_t multibandgate_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
+{
+    bool bypass = *params[param_bypass] > 0.5f;
+    numsamples += offset;
+    for (int i = 0; i < strips; i++)
+        gate[i].update_curve();
+    if(bypass) {
+        // everything bypassed
+        while(offset < numsamples) {
+            outs[0][offset] = ins[0][offset];
+            outs[1][offset] = ins[1][offset];
+            ++offset;
+        }
+        // displays, too
+        clip_inL    = 0.f;
+        clip_inR    = 0.f;
+        clip_outL   = 0.f;
+        clip_outR   = 0.f;
+        meter_inL  = 0.f;
+        meter_inR  = 0.f;
+        meter_outL = 0.f;
+        meter_outR = 0.f;
+    } else {
+        // split -> process all strips -> sum up
+        uint32_t len = numsamples - offset;
+        begin_meters(numsamples);
+        split(offset, 0, len);
+        for (int i = 0; i < strips; i++)
+            process_band(i, 0, len);
+        mix(offset, 0, len);
+    }
+    set_meters(bypass);
     // whatever has to be returned x)
     return outputs_mask;
 }
 
+uint32_t multibandgate_audio_module::process_slice(uint32_t offset, uint32_t end)
+{
+    if (end - offset < PARALLEL_MIN_RUN || *params[param_bypass] > 0.5f)
+        return audio_module<multibandgate_metadata>::process_slice(offset, end);
+    // long blocks: the strips run on the worker threads (if any), each one
+    // over up to PARALLEL_RUN samples at a time
+    dsp::denormal_guard guard;
+    for (int i = 0; i < strips; i++)
+        gate[i].update_curve();
+    begin_meters(end - offset);
+    while(offset < end) {
+        uint32_t len = std::min<uint32_t>(end - offset, band_buffer_size);
+        for (uint32_t pos = 0; pos < len; pos += MAX_SAMPLE_RUN)
+            split(offset + pos, pos, std::min<uint32_t>(len - pos, MAX_SAMPLE_RUN));
+        band_run = len;
+        pool->run(process_band_task, this, strips);
+        mix(offset, 0, len);
+        offset += len;
+    }
+    set_meters(false);
+    return 3;
+}
+
 const expander_audio_module *multibandgate_audio_module::get_strip_by_param_index(int index) const
 {
     // let's handle by the corresponding strip
@@ -2183,6 +2182,14 @@ void gain_reduction_audio_module::process(float &left, float &right, const float
     }
 }
 
+void gain_reduction_audio_module::process_block(float *left, float *right, uint32_t len)
+{
+    if(bypass < 0.5f) {
+        for (uint32_t i = 0; i < len; i++)
+            process(left[i], right[i]);
+    }
+}
+
 float gain_reduction_audio_module::output_level(float slope) const {
     return slope * output_gain(slope, false) * makeup;
 }
@@ -2432,6 +2439,14 @@ void expander_audio_module::process(float &left, float &right, const float *det_
     }
 }
 
+void expander_audio_module::process_block(float *left, float *right, uint32_t len)
+{
+    if(bypass < 0.5f) {
+        for (uint32_t i = 0; i < len; i++)
+            process(left[i], right[i]);
+    }
+}
+
 float expander_audio_module::output_level(float slope) const {
     bool rms = (detection == 0);
     return slope * output_gain(rms ? slope*slope : slope, rms) * makeup;
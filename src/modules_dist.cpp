@@ -43,6 +43,7 @@ saturator_audio_module::saturator_audio_module()
     hp_post_freq_old = -1;
     p_freq_old = -1;
     p_level_old = -1;
+    oversampling = 1;
 }
 
 void saturator_audio_module::activate()
@@ -60,6 +61,9 @@ void saturator_audio_module::deactivate()
 
 void saturator_audio_module::params_changed()
 {
+    int factor = 1 << (int)*params[param_oversampling];
+    if(factor != oversampling)
+        set_oversampling(factor);
     // set the params of all filters
     if(*params[param_lp_pre_freq] != lp_pre_freq_old) {
         lp[0][0].set_lp_rbj(*params[param_lp_pre_freq], 0.707, (float)srate);
@@ -114,12 +118,21 @@ void saturator_audio_module::params_changed()
 void saturator_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
-    dist[0].set_sample_rate(sr);
-    if(in_count > 1 && out_count > 1)
-        dist[1].set_sample_rate(sr);
+    set_oversampling(oversampling);
     meters.set_sample_rate(srate);
 }
 
+void saturator_audio_module::set_oversampling(int factor)
+{
+    // the distortion runs at the oversampled rate, the filters stay at the original one
+    oversampling = factor;
+    for (int i = 0; i < 2; i++) {
+        os[i].set_factor(factor);
+        dist[i].set_sample_rate(srate * factor);
+        dry[i].reset();
+    }
+}
+
 uint32_t saturator_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
 {
     bool bypass = *params[param_bypass] > 0.5f;
@@ -148,73 +161,86 @@ uint32_t saturator_audio_module::process(uint32_t offset, uint32_t numsamples, u
         float in_avg[2] = {0.f, 0.f};
         float out_avg[2] = {0.f, 0.f};
         float tube_avg = 0.f;
-        // process
-        while(offset < numsamples) {
-            // cycle through samples
-            float out[2], in[2] = {0.f, 0.f};
-            int c = 0;
-            
-            if(in_count > 1 && out_count > 1) {
-                // stereo in/stereo out
-                // handle full stereo
-                in[0] = ins[0][offset];
-                in[1] = ins[1][offset];
-                c = 2;
-            } else {
-                // in and/or out mono
-                // handle mono
-                in[0] = ins[0][offset];
-                in[1] = in[0];
-                c = 1;
-            }
-            
-            float proc[2];
-            proc[0] = in[0] * *params[param_level_in];
-            proc[1] = in[1] * *params[param_level_in];
+        int c = (in_count > 1 && out_count > 1) ? 2 : 1;
+        float level_in = *params[param_level_in];
+        float onedivlevelin = 1.0 / level_in;
+        float proc[2][MAX_SAMPLE_RUN];
+        float over[MAX_SAMPLE_RUN * dsp::oversampler::MAX_FACTOR];
+        int latency = os[0].get_latency();
+        // process - the filter chains run over the whole block, the saturation per sample
+        for (int i = 0; i < c; ++i) {
+            float *buf = proc[i];
+            for (uint32_t j = 0; j < orig_numsamples; ++j)
+                buf[j] = ins[i][orig_offset + j] * level_in;
             
-            float onedivlevelin = 1.0 / *params[param_level_in];
+            // all pre filters in chain
+            lp[i][0].process_block(buf, buf, orig_numsamples);
+            lp[i][1].process_block(buf, buf, orig_numsamples);
+            hp[i][0].process_block(buf, buf, orig_numsamples);
+            hp[i][1].process_block(buf, buf, orig_numsamples);
             
-            for (int i = 0; i < c; ++i) {
-                // all pre filters in chain
-                proc[i] = lp[i][1].process(lp[i][0].process(proc[i]));
-                proc[i] = hp[i][1].process(hp[i][0].process(proc[i]));
-                
+            // saturation generates harmonics above Nyquist, run it at the oversampled rate if requested
+            float *sat = buf;
+            uint32_t satlen = orig_numsamples * oversampling;
+            if(oversampling > 1) {
+                os[i].upsample(buf, over, orig_numsamples);
+                sat = over;
+            }
+            for (uint32_t j = 0; j < satlen; ++j) {
                 // get average for display purposes before...
-                in_avg[i] += fabs(pow(proc[i], 2.f));
-
+                in_avg[i] += fabs(pow(sat[j], 2.f));
+                
                 // ...saturate...
-                proc[i] = dist[i].process(proc[i]);
+                sat[j] = dist[i].process(sat[j]);
                 
                 // ...and get average after...
-                out_avg[i] += fabs(pow(proc[i], 2.f));
-                
-                // tone control
-                proc[i] = p[i].process(proc[i]);
-
-                // all post filters in chain
-                proc[i] = lp[i][2].process(lp[i][3].process(proc[i]));
-                proc[i] = hp[i][2].process(hp[i][3].process(proc[i]));
-                
-                //subtract gain
-                proc[i] *= onedivlevelin;
+                out_avg[i] += fabs(pow(sat[j], 2.f));
+            }
+            if(oversampling > 1) {
+                os[i].downsample(over, buf, orig_numsamples);
+                in_avg[i] /= oversampling;
+                out_avg[i] /= oversampling;
             }
             
+            // tone control
+            p[i].process_block(buf, buf, orig_numsamples);
+            
+            // all post filters in chain
+            lp[i][3].process_block(buf, buf, orig_numsamples);
+            lp[i][2].process_block(buf, buf, orig_numsamples);
+            hp[i][3].process_block(buf, buf, orig_numsamples);
+            hp[i][2].process_block(buf, buf, orig_numsamples);
+        }
+        for (uint32_t j = 0; offset < numsamples; ++j) {
+            // cycle through samples
+            float out[2], in[2];
+            in[0] = ins[0][offset];
+            in[1] = (c > 1) ? ins[1][offset] : in[0];
+            if(latency) {
+                in[0] = dry[0].process(in[0], latency);
+                in[1] = (c > 1) ? dry[1].process(in[1], latency) : in[0];
+            }
+            
+            //subtract gain
+            float procL = proc[0][j] * onedivlevelin;
+            float procR = proc[c - 1][j] * onedivlevelin;
+            
             if(in_count > 1 && out_count > 1) {
                 // full stereo
-                out[0] = ((proc[0] * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[0] = ((procL * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[0][offset] = out[0];
-                out[1] = ((proc[1] * *params[param_mix]) + in[1] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[1] = ((procR * *params[param_mix]) + in[1] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[1][offset] = out[1];
             } else if(out_count > 1) {
                 // mono -> pseudo stereo
-                out[0] = ((proc[0] * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[0] = ((procL * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 out[1] = out[0];
                 outs[1][offset] = out[1];
             } else {
                 // stereo -> mono
                 // or full mono
-                out[0] = ((proc[0] * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
+                out[0] = ((procL * *params[param_mix]) + in[0] * (1 - *params[param_mix])) * *params[param_level_out];
                 outs[0][offset] = out[0];
             }
                         
@@ -226,25 +252,6 @@ uint32_t saturator_audio_module::process(uint32_t offset, uint32_t numsamples, u
         tube_avg = (sqrt(std::max(out_avg[0], out_avg[1])) / numsamples) - (sqrt(std::max(in_avg[0], in_avg[1])) / numsamples);
         meter_drive = (5.0f * fabs(tube_avg) * (float(*params[param_blend]) + 30.0f));
         // printf("out:%.6f in: %.6f avg: %.6f drv: %.3f\n", sqrt(std::max(out_avg[0], out_avg[1])) / numsamples, sqrt(std::max(in_avg[0], in_avg[1])) / numsamples, tube_avg, meter_drive);
-        // clean up
-        lp[0][0].sanitize();
-        lp[1][0].sanitize();
-        lp[0][1].sanitize();
-        lp[1][1].sanitize();
-        lp[0][2].sanitize();
-        lp[1][2].sanitize();
-        lp[0][3].sanitize();
-        lp[1][3].sanitize();
-        hp[0][0].sanitize();
-        hp[1][0].sanitize();
-        hp[0][1].sanitize();
-        hp[1][1].sanitize();
-        hp[0][2].sanitize();
-        hp[1][2].sanitize();
-        hp[0][3].sanitize();
-        hp[1][3].sanitize();
-        p[0].sanitize();
-        p[1].sanitize();
     }
     // draw meters
     if(params[param_meter_drive] != NULL) {
@@ -265,6 +272,7 @@ exciter_audio_module::exciter_audio_module()
     is_active = false;
     srate = 0;
     meter_drive = 0.f;
+    oversampling = 1;
 }
 
 void exciter_audio_module::activate()
@@ -281,6 +289,9 @@ void exciter_audio_module::deactivate()
 
 void exciter_audio_module::params_changed()
 {
+    int factor = 1 << (int)*params[param_oversampling];
+    if(factor != oversampling)
+        set_oversampling(factor);
     // set the params of all filters
     if(*params[param_freq] != freq_old) {
         hp[0][0].set_hp_rbj(*params[param_freq], 0.707, (float)srate);
@@ -313,12 +324,21 @@ void exciter_audio_module::params_changed()
 void exciter_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
-    dist[0].set_sample_rate(sr);
-    if(in_count > 1 && out_count > 1)
-        dist[1].set_sample_rate(sr);
+    set_oversampling(oversampling);
     meters.set_sample_rate(srate);
 }
 
+void exciter_audio_module::set_oversampling(int factor)
+{
+    // the distortion runs at the oversampled rate, the filters stay at the original one
+    oversampling = factor;
+    for (int i = 0; i < 2; i++) {
+        os[i].set_factor(factor);
+        dist[i].set_sample_rate(srate * factor);
+        dry[i].reset();
+    }
+}
+
 uint32_t exciter_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
 {
     uint32_t orig_offset = offset;
@@ -349,90 +369,84 @@ uint32_t exciter_audio_module::process(uint32_t offset, uint32_t numsamples, uin
         meter_drive = 0.f;
         
         float in2out = *params[param_listen] > 0.f ? 0.f : 1.f;
+        int c = (in_count > 1 && out_count > 1) ? 2 : 1;
+        float level_in = *params[param_level_in];
+        float amount = *params[param_amount];
+        float proc[2][MAX_SAMPLE_RUN];
+        float over[MAX_SAMPLE_RUN * dsp::oversampler::MAX_FACTOR];
+        int latency = os[0].get_latency();
         
-        // process
-        while(offset < numsamples) {
-            // cycle through samples
-            float out[2], in[2] = {0.f, 0.f};
-            float maxDrive = 0.f;
-            int c = 0;
+        // process - the filter chains run over the whole block, the saturation per sample
+        for (int i = 0; i < c; ++i) {
+            float *buf = proc[i];
+            for (uint32_t j = 0; j < orig_numsamples; ++j)
+                buf[j] = ins[i][orig_offset + j] * level_in;
             
-            if(in_count > 1 && out_count > 1) {
-                // stereo in/stereo out
-                // handle full stereo
-                in[0] = ins[0][offset];
-                in[0] *= *params[param_level_in];
-                in[1] = ins[1][offset];
-                in[1] *= *params[param_level_in];
-                c = 2;
-            } else {
-                // in and/or out mono
-                // handle mono
-                in[0] = ins[0][offset];
-                in[0] *= *params[param_level_in];
-                in[1] = in[0];
-                c = 1;
+            // all pre filters in chain
+            hp[i][0].process_block(buf, buf, orig_numsamples);
+            hp[i][1].process_block(buf, buf, orig_numsamples);
+            
+            // saturate - at the oversampled rate if requested
+            float *sat = buf;
+            uint32_t satlen = orig_numsamples * oversampling;
+            if(oversampling > 1) {
+                os[i].upsample(buf, over, orig_numsamples);
+                sat = over;
             }
+            for (uint32_t j = 0; j < satlen; ++j) {
+                sat[j] = dist[i].process(sat[j]);
+                // set up in / out meters
+                float drive = dist[i].get_distortion_level() * amount;
+                if(drive > meter_drive) {
+                    meter_drive = drive;
+                }
+            }
+            if(oversampling > 1)
+                os[i].downsample(over, buf, orig_numsamples);
             
-            float proc[2];
-            proc[0] = in[0];
-            proc[1] = in[1];
+            // all post filters in chain
+            hp[i][3].process_block(buf, buf, orig_numsamples);
+            hp[i][2].process_block(buf, buf, orig_numsamples);
             
-            for (int i = 0; i < c; ++i) {
-                // all pre filters in chain
-                proc[i] = hp[i][1].process(hp[i][0].process(proc[i]));
-                
-                // saturate
-                proc[i] = dist[i].process(proc[i]);
-
-                // all post filters in chain
-                proc[i] = hp[i][2].process(hp[i][3].process(proc[i]));
-                
-                if(*params[param_ceil_active] > 0.5f) {
-                    // all H/P post filters in chain
-                    proc[i] = lp[i][0].process(lp[i][1].process(proc[i]));
-                    
-                }
+            if(*params[param_ceil_active] > 0.5f) {
+                // all H/P post filters in chain
+                lp[i][1].process_block(buf, buf, orig_numsamples);
+                lp[i][0].process_block(buf, buf, orig_numsamples);
+            }
+        }
+        
+        for (uint32_t j = 0; offset < numsamples; ++j) {
+            // cycle through samples
+            float out[2], in[2];
+            in[0] = ins[0][offset] * level_in;
+            in[1] = (c > 1) ? ins[1][offset] * level_in : in[0];
+            if(latency) {
+                in[0] = dry[0].process(in[0], latency);
+                in[1] = (c > 1) ? dry[1].process(in[1], latency) : in[0];
             }
-            maxDrive = dist[0].get_distortion_level() * *params[param_amount];
             
             if(in_count > 1 && out_count > 1) {
-                maxDrive = std::max(maxDrive, dist[1].get_distortion_level() * *params[param_amount]);
                 // full stereo
-                out[0] = (proc[0] * *params[param_amount] + in2out * in[0]) * *params[param_level_out];
-                out[1] = (proc[1] * *params[param_amount] + in2out * in[1]) * *params[param_level_out];
+                out[0] = (proc[0][j] * amount + in2out * in[0]) * *params[param_level_out];
+                out[1] = (proc[1][j] * amount + in2out * in[1]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 outs[1][offset] = out[1];
             } else if(out_count > 1) {
                 // mono -> pseudo stereo
-                out[1] = out[0] = (proc[0] * *params[param_amount] + in2out * in[0]) * *params[param_level_out];
+                out[1] = out[0] = (proc[0][j] * amount + in2out * in[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 outs[1][offset] = out[1];
             } else {
                 // stereo -> mono
                 // or full mono
-                out[0] = (proc[0] * *params[param_amount] + in2out * in[0]) * *params[param_level_out];
+                out[0] = (proc[0][j] * amount + in2out * in[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
             }
             
-            // set up in / out meters
-            if(maxDrive > meter_drive) {
-                meter_drive = maxDrive;
-            }
-            
             // next sample
             ++offset;
         } // cycle trough samples
         meters.process(params, ins, outs, orig_offset, orig_numsamples);
-        // clean up
-        hp[0][0].sanitize();
-        hp[1][0].sanitize();
-        hp[0][1].sanitize();
-        hp[1][1].sanitize();
-        hp[0][2].sanitize();
-        hp[1][2].sanitize();
-        hp[0][3].sanitize();
-        hp[1][3].sanitize();
     }
     // draw meters
     if(params[param_meter_drive] != NULL) {
@@ -454,6 +468,7 @@ bassenhancer_audio_module::bassenhancer_audio_module()
     srate = 0;
     meters.reset();
     meter_drive = 0.f;
+    oversampling = 1;
 }
 
 void bassenhancer_audio_module::activate()
@@ -470,6 +485,9 @@ void bassenhancer_audio_module::deactivate()
 
 void bassenhancer_audio_module::params_changed()
 {
+    int factor = 1 << (int)*params[param_oversampling];
+    if(factor != oversampling)
+        set_oversampling(factor);
     // set the params of all filters
     if(*params[param_freq] != freq_old) {
         lp[0][0].set_lp_rbj(*params[param_freq], 0.707, (float)srate);
@@ -502,12 +520,21 @@ void bassenhancer_audio_module::params_changed()
 void bassenhancer_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
-    dist[0].set_sample_rate(sr);
-    if(in_count > 1 && out_count > 1)
-        dist[1].set_sample_rate(sr);
+    set_oversampling(oversampling);
     meters.set_sample_rate(srate);
 }
 
+void bassenhancer_audio_module::set_oversampling(int factor)
+{
+    // the distortion runs at the oversampled rate, the filters stay at the original one
+    oversampling = factor;
+    for (int i = 0; i < 2; i++) {
+        os[i].set_factor(factor);
+        dist[i].set_sample_rate(srate * factor);
+        dry[i].reset();
+    }
+}
+
 uint32_t bassenhancer_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
 {
     bool bypass = *params[param_bypass] > 0.5f;
@@ -535,105 +562,86 @@ uint32_t bassenhancer_audio_module::process(uint32_t offset, uint32_t numsamples
         meter_drive = 0.f;
     } else {
         meter_drive = 0.f;
+        int c = (in_count > 1 && out_count > 1) ? 2 : 1;
+        float level_in = *params[param_level_in];
+        float amount = *params[param_amount];
+        float proc[2][MAX_SAMPLE_RUN];
+        float over[MAX_SAMPLE_RUN * dsp::oversampler::MAX_FACTOR];
+        int latency = os[0].get_latency();
         
-        // process
-        while(offset < numsamples) {
-            // cycle through samples
-            float out[2], in[2] = {0.f, 0.f};
-            float maxDrive = 0.f;
-            int c = 0;
+        // process - the filter chains run over the whole block, the saturation per sample
+        for (int i = 0; i < c; ++i) {
+            float *buf = proc[i];
+            for (uint32_t j = 0; j < orig_numsamples; ++j)
+                buf[j] = ins[i][orig_offset + j] * level_in;
             
-            if(in_count > 1 && out_count > 1) {
-                // stereo in/stereo out
-                // handle full stereo
-                in[0] = ins[0][offset];
-                in[0] *= *params[param_level_in];
-                in[1] = ins[1][offset];
-                in[1] *= *params[param_level_in];
-                c = 2;
-            } else {
-                // in and/or out mono
-                // handle mono
-                in[0] = ins[0][offset];
-                in[0] *= *params[param_level_in];
-                in[1] = in[0];
-                c = 1;
+            // all pre filters in chain
+            lp[i][0].process_block(buf, buf, orig_numsamples);
+            lp[i][1].process_block(buf, buf, orig_numsamples);
+            
+            // saturate - at the oversampled rate if requested
+            float *sat = buf;
+            uint32_t satlen = orig_numsamples * oversampling;
+            if(oversampling > 1) {
+                os[i].upsample(buf, over, orig_numsamples);
+                sat = over;
             }
+            for (uint32_t j = 0; j < satlen; ++j) {
+                sat[j] = dist[i].process(sat[j]);
+                // set up in / out meters
+                float drive = dist[i].get_distortion_level() * amount;
+                if(drive > meter_drive) {
+                    meter_drive = drive;
+                }
+            }
+            if(oversampling > 1)
+                os[i].downsample(over, buf, orig_numsamples);
             
-            float proc[2];
-            proc[0] = in[0];
-            proc[1] = in[1];
+            // all post filters in chain
+            lp[i][3].process_block(buf, buf, orig_numsamples);
+            lp[i][2].process_block(buf, buf, orig_numsamples);
             
-            for (int i = 0; i < c; ++i) {
-                // all pre filters in chain
-                proc[i] = lp[i][1].process(lp[i][0].process(proc[i]));
-                
-                // saturate
-                proc[i] = dist[i].process(proc[i]);
-
-                // all post filters in chain
-                proc[i] = lp[i][2].process(lp[i][3].process(proc[i]));
-                
-                if(*params[param_floor_active] > 0.5f) {
-                    // all H/P post filters in chain
-                    proc[i] = hp[i][0].process(hp[i][1].process(proc[i]));
-                    
-                }
+            if(*params[param_floor_active] > 0.5f) {
+                // all H/P post filters in chain
+                hp[i][1].process_block(buf, buf, orig_numsamples);
+                hp[i][0].process_block(buf, buf, orig_numsamples);
+            }
+        }
+        
+        float in2out = *params[param_listen] > 0.f ? 0.f : 1.f;
+        for (uint32_t j = 0; offset < numsamples; ++j) {
+            // cycle through samples
+            float out[2], in[2];
+            in[0] = ins[0][offset] * level_in;
+            in[1] = (c > 1) ? ins[1][offset] * level_in : in[0];
+            if(latency) {
+                in[0] = dry[0].process(in[0], latency);
+                in[1] = (c > 1) ? dry[1].process(in[1], latency) : in[0];
             }
             
             if(in_count > 1 && out_count > 1) {
                 // full stereo
-                if(*params[param_listen] > 0.f)
-                    out[0] = proc[0] * *params[param_amount] * *params[param_level_out];
-                else
-                    out[0] = (proc[0] * *params[param_amount] + in[0]) * *params[param_level_out];
+                out[0] = (proc[0][j] * amount + in2out * in[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
-                if(*params[param_listen] > 0.f)
-                    out[1] = proc[1] * *params[param_amount] * *params[param_level_out];
-                else
-                    out[1] = (proc[1] * *params[param_amount] + in[1]) * *params[param_level_out];
+                out[1] = (proc[1][j] * amount + in2out * in[1]) * *params[param_level_out];
                 outs[1][offset] = out[1];
-                maxDrive = std::max(dist[0].get_distortion_level() * *params[param_amount],
-                                            dist[1].get_distortion_level() * *params[param_amount]);
             } else if(out_count > 1) {
                 // mono -> pseudo stereo
-                if(*params[param_listen] > 0.f)
-                    out[0] = proc[0] * *params[param_amount] * *params[param_level_out];
-                else
-                    out[0] = (proc[0] * *params[param_amount] + in[0]) * *params[param_level_out];
+                out[0] = (proc[0][j] * amount + in2out * in[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
                 out[1] = out[0];
                 outs[1][offset] = out[1];
-                maxDrive = dist[0].get_distortion_level() * *params[param_amount];
             } else {
                 // stereo -> mono
                 // or full mono
-                if(*params[param_listen] > 0.f)
-                    out[0] = proc[0] * *params[param_amount] * *params[param_level_out];
-                else
-                    out[0] = (proc[0] * *params[param_amount] + in[0]) * *params[param_level_out];
+                out[0] = (proc[0][j] * amount + in2out * in[0]) * *params[param_level_out];
                 outs[0][offset] = out[0];
-                maxDrive = dist[0].get_distortion_level() * *params[param_amount];
-            }
-            
-            // set up in / out meters
-            if(maxDrive > meter_drive) {
-                meter_drive = maxDrive;
             }
             
             // next sample
             ++offset;
         } // cycle trough samples
         meters.process(params, ins, outs, orig_offset, orig_numsamples);
-        // clean up
-        lp[0][0].sanitize();
-        lp[1][0].sanitize();
-        lp[0][1].sanitize();
-        lp[1][1].sanitize();
-        lp[0][2].sanitize();
-        lp[1][2].sanitize();
-        lp[0][3].sanitize();
-        lp[1][3].sanitize();
     }
     // draw meters
     if(params[param_meter_drive] != NULL) {
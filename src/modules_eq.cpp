@@ -64,14 +64,6 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::deactivate()
     is_active = false;
 }
 
-static inline void copy_lphp(biquad_d2<float> filters[3][2])
-{
-    for (int i = 0; i < 3; i++)
-        for (int j = 0; j < 2; j++)
-            if (i || j)
-                filters[i][j].copy_coeffs(filters[0][0]);
-}
-
 template<class BaseClass, bool has_lphp>
 void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
 {
@@ -86,13 +78,17 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
         float hpfreq = *params[AM::param_hp_freq], lpfreq = *params[AM::param_lp_freq];
         
         if(hpfreq != hp_freq_old) {
-            hp[0][0].set_hp_rbj(hpfreq, 0.707, (float)srate, 1.0);
-            copy_lphp(hp);
+            biquad_coeffs<float> hp;
+            hp.set_hp_rbj(hpfreq, 0.707, (float)srate, 1.0);
+            for (int i = 0; i < 3; i++)
+                filters.set_coeffs(slot_hp + i, hp);
             hp_freq_old = hpfreq;
         }
         if(lpfreq != lp_freq_old) {
-            lp[0][0].set_lp_rbj(lpfreq, 0.707, (float)srate, 1.0);
-            copy_lphp(lp);
+            biquad_coeffs<float> lp;
+            lp.set_lp_rbj(lpfreq, 0.707, (float)srate, 1.0);
+            for (int i = 0; i < 3; i++)
+                filters.set_coeffs(slot_lp + i, lp);
             lp_freq_old = lpfreq;
         }
     }
@@ -102,14 +98,16 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
     float lsfreq = *params[AM::param_ls_freq], lslevel = *params[AM::param_ls_level];
     
     if(lsfreq != ls_freq_old or lslevel != ls_level_old) {
-        lsL.set_lowshelf_rbj(lsfreq, 0.707, lslevel, (float)srate);
-        lsR.copy_coeffs(lsL);
+        biquad_coeffs<float> ls;
+        ls.set_lowshelf_rbj(lsfreq, 0.707, lslevel, (float)srate);
+        filters.set_coeffs(slot_ls, ls);
         ls_level_old = lslevel;
         ls_freq_old = lsfreq;
     }
     if(hsfreq != hs_freq_old or hslevel != hs_level_old) {
-        hsL.set_highshelf_rbj(hsfreq, 0.707, hslevel, (float)srate);
-        hsR.copy_coeffs(hsL);
+        biquad_coeffs<float> hs;
+        hs.set_highshelf_rbj(hsfreq, 0.707, hslevel, (float)srate);
+        filters.set_coeffs(slot_hs, hs);
         hs_level_old = hslevel;
         hs_freq_old = hsfreq;
     }
@@ -120,56 +118,45 @@ void equalizerNband_audio_module<BaseClass, has_lphp>::params_changed()
         float level = *params[AM::param_p1_level + offset];
         float q = *params[AM::param_p1_q + offset];
         if(freq != p_freq_old[i] or level != p_level_old[i] or q != p_q_old[i]) {
-            pL[i].set_peakeq_rbj(freq, q, level, (float)srate);
-            pR[i].copy_coeffs(pL[i]);
+            biquad_coeffs<float> peak;
+            peak.set_peakeq_rbj(freq, q, level, (float)srate);
+            filters.set_coeffs(slot_p1 + i, peak);
             p_freq_old[i] = freq;
             p_level_old[i] = level;
             p_q_old[i] = q;
         }
     }
+    build_chain();
 }
 
+/// Put the sections of all active bands into the filter chain, in processing order
 template<class BaseClass, bool has_lphp>
-inline void equalizerNband_audio_module<BaseClass, has_lphp>::process_hplp(float &left, float &right)
+void equalizerNband_audio_module<BaseClass, has_lphp>::build_chain()
 {
-    if (!has_lphp)
-        return;
-    if (*params[AM::param_lp_active] > 0.f)
+    filters.clear_chain();
+    if (has_lphp)
     {
-        switch(lp_mode)
+        // 12dB/oct per section
+        if (*params[AM::param_lp_active] > 0.f)
         {
-            case MODE12DB:
-                left = lp[0][0].process(left);
-                right = lp[0][1].process(right);
-                break;
-            case MODE24DB:
-                left = lp[1][0].process(lp[0][0].process(left));
-                right = lp[1][1].process(lp[0][1].process(right));
-                break;
-            case MODE36DB:
-                left = lp[2][0].process(lp[1][0].process(lp[0][0].process(left)));
-                right = lp[2][1].process(lp[1][1].process(lp[0][1].process(right)));
-                break;
+            for (int i = 0; i <= lp_mode - MODE12DB && i < 3; i++)
+                filters.add_to_chain(slot_lp + i);
         }
-    }
-    if (*params[AM::param_hp_active] > 0.f)
-    {
-        switch(hp_mode)
+        if (*params[AM::param_hp_active] > 0.f)
         {
-            case MODE12DB:
-                left = hp[0][0].process(left);
-                right = hp[0][1].process(right);
-                break;
-            case MODE24DB:
-                left = hp[1][0].process(hp[0][0].process(left));
-                right = hp[1][1].process(hp[0][1].process(right));
-                break;
-            case MODE36DB:
-                left = hp[2][0].process(hp[1][0].process(hp[0][0].process(left)));
-                right = hp[2][1].process(hp[1][1].process(hp[0][1].process(right)));
-                break;
+            for (int i = 0; i <= hp_mode - MODE12DB && i < 3; i++)
+                filters.add_to_chain(slot_hp + i);
         }
     }
+    if (*params[AM::param_ls_active] > 0.f)
+        filters.add_to_chain(slot_ls);
+    if (*params[AM::param_hs_active] > 0.f)
+        filters.add_to_chain(slot_hs);
+    for (int i = 0; i < AM::PeakBands; i++)
+    {
+        if (*params[AM::param_p1_active + i * params_per_band] > 0.f)
+            filters.add_to_chain(slot_p1 + i);
+    }
 }
 
 template<class BaseClass, bool has_lphp>
@@ -189,67 +176,49 @@ uint32_t equalizerNband_audio_module<BaseClass, has_lphp>::process(uint32_t offs
         // displays, too
         meters.bypassed(params, orig_numsamples);
     } else {
-        // process
-        while(offset < numsamples) {
-            // cycle through samples
-            float outL = 0.f;
-            float outR = 0.f;
-            float inL = ins[0][offset];
-            float inR = ins[1][offset];
-            // in level
-            inR *= *params[AM::param_level_in];
-            inL *= *params[AM::param_level_in];
-            
-            float procL = inL;
-            float procR = inR;
-            
-            // all filters in chain
-            process_hplp(procL, procR);
-            if(*params[AM::param_ls_active] > 0.f) {
-                procL = lsL.process(procL);
-                procR = lsR.process(procR);
-            }
-            if(*params[AM::param_hs_active] > 0.f) {
-                procL = hsL.process(procL);
-                procR = hsR.process(procR);
-            }
-            for (int i = 0; i < AM::PeakBands; i++)
-            {
-                if(*params[AM::param_p1_active + i * params_per_band] > 0.f) {
-                    procL = pL[i].process(procL);
-                    procR = pR[i].process(procR);
-                }
-            }
-            
-            outL = procL * *params[AM::param_level_out];
-            outR = procR * *params[AM::param_level_out];
-            
-            // send to output
-            outs[0][offset] = outL;
-            outs[1][offset] = outR;
-                        
-            // next sample
-            ++offset;
-        } // cycle trough samples
-        meters.process(params, ins, outs, orig_offset, orig_numsamples);
-        // clean up
-        for(int i = 0; i < 3; ++i) {
-            hp[i][0].sanitize();
-            hp[i][1].sanitize();
-            lp[i][0].sanitize();
-            lp[i][1].sanitize();
+        // process - in level, then the whole chain of active filters over
+        // the block (working in the output buffers), then out level
+        float level_in = *params[AM::param_level_in];
+        float level_out = *params[AM::param_level_out];
+        float *bufs[2] = { outs[0] + orig_offset, outs[1] + orig_offset };
+        for (int c = 0; c < 2; c++) {
+            const float *in = ins[c] + orig_offset;
+            float *buf = bufs[c];
+            for (uint32_t i = 0; i < orig_numsamples; i++)
+                buf[i] = in[i] * level_in;
         }
-        lsL.sanitize();
-        hsR.sanitize();
-        for(int i = 0; i < AM::PeakBands; ++i) {
-            pL[i].sanitize();
-            pR[i].sanitize();
+        
+        // all filters in chain
+        filters.process_block(bufs, orig_numsamples);
+        
+        for (int c = 0; c < 2; c++) {
+            float *buf = bufs[c];
+            for (uint32_t i = 0; i < orig_numsamples; i++)
+                buf[i] *= level_out;
         }
+        meters.process(params, ins, outs, orig_offset, orig_numsamples);
     }
     // whatever has to be returned x)
     return outputs_mask;
 }
 
+static inline void add_lphp_response(biquad_response &response, const float *const *params, int param_active, int param_mode, const biquad_coeffs<float> &filter)
+{
+    if(*params[param_active] > 0.f) {
+        switch((int)*params[param_mode]) {
+            case MODE12DB:
+                response.add(filter, 1);
+                break;
+            case MODE24DB:
+                response.add(filter, 2);
+                break;
+            case MODE36DB:
+                response.add(filter, 3);
+                break;
+        }
+    }
+}
+
 template<class BaseClass, bool has_lphp>
 bool equalizerNband_audio_module<BaseClass, has_lphp>::get_graph(int index, int subindex, float *data, int points, cairo_iface *context, int *mode) const
 {
@@ -257,7 +226,23 @@ bool equalizerNband_audio_module<BaseClass, has_lphp>::get_graph(int index, int
         return false;
     if (index == AM::param_p1_freq && !subindex) {
         context->set_line_width(1.5);
-        return ::get_graph(*this, subindex, data, points, 32, 0);
+        // the same sections as freq_gain, evaluated for the whole graph at once
+        response.clear();
+        if (has_lphp)
+        {
+            add_lphp_response(response, params, AM::param_hp_active, AM::param_hp_mode, filters.get_coeffs(slot_hp));
+            add_lphp_response(response, params, AM::param_lp_active, AM::param_lp_mode, filters.get_coeffs(slot_lp));
+        }
+        if (*params[AM::param_ls_active] > 0.f)
+            response.add(filters.get_coeffs(slot_ls));
+        if (*params[AM::param_hs_active] > 0.f)
+            response.add(filters.get_coeffs(slot_hs));
+        for (int i = 0; i < PeakBands; i++)
+        {
+            if (*params[AM::param_p1_active + i * params_per_band] > 0.f)
+                response.add(filters.get_coeffs(slot_p1 + i));
+        }
+        return response.get_graph(data, points, srate, 32, 0);
     }
     return false;
 }
@@ -305,7 +290,7 @@ int equalizerNband_audio_module<BaseClass, has_lphp>::get_changed_offsets(int in
     return false;
 }
 
-static inline float adjusted_lphp_gain(const float *const *params, int param_active, int param_mode, const biquad_d2<float> &filter, float freq, float srate)
+static inline float adjusted_lphp_gain(const float *const *params, int param_active, int param_mode, const biquad_coeffs<float> &filter, float freq, float srate)
 {
     if(*params[param_active] > 0.f) {
         float gain = filter.freq_gain(freq, srate);
@@ -327,13 +312,13 @@ float equalizerNband_audio_module<BaseClass, use_hplp>::freq_gain(int index, dou
     float ret = 1.f;
     if (use_hplp)
     {
-        ret *= adjusted_lphp_gain(params, AM::param_hp_active, AM::param_hp_mode, hp[0][0], freq, (float)sr);
-        ret *= adjusted_lphp_gain(params, AM::param_lp_active, AM::param_lp_mode, lp[0][0], freq, (float)sr);
+        ret *= adjusted_lphp_gain(params, AM::param_hp_active, AM::param_hp_mode, filters.get_coeffs(slot_hp), freq, (float)sr);
+        ret *= adjusted_lphp_gain(params, AM::param_lp_active, AM::param_lp_mode, filters.get_coeffs(slot_lp), freq, (float)sr);
     }
-    ret *= (*params[AM::param_ls_active] > 0.f) ? lsL.freq_gain(freq, sr) : 1;
-    ret *= (*params[AM::param_hs_active] > 0.f) ? hsL.freq_gain(freq, sr) : 1;
+    ret *= (*params[AM::param_ls_active] > 0.f) ? filters.get_coeffs(slot_ls).freq_gain(freq, sr) : 1;
+    ret *= (*params[AM::param_hs_active] > 0.f) ? filters.get_coeffs(slot_hs).freq_gain(freq, sr) : 1;
     for (int i = 0; i < PeakBands; i++)
-        ret *= (*params[AM::param_p1_active + i * params_per_band] > 0.f) ? pL[i].freq_gain(freq, (float)sr) : 1;
+        ret *= (*params[AM::param_p1_active + i * params_per_band] > 0.f) ? filters.get_coeffs(slot_p1 + i).freq_gain(freq, (float)sr) : 1;
     return ret;
 }
 
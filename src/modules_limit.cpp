@@ -51,6 +51,7 @@ limiter_audio_module::limiter_audio_module()
     attack_old = -1.f;
     limit_old = -1.f;
     asc_old = true;
+    oversampling = 1;
 }
 
 void limiter_audio_module::activate()
@@ -70,6 +71,9 @@ void limiter_audio_module::deactivate()
 void limiter_audio_module::params_changed()
 {
     limiter.set_params(*params[param_limit], *params[param_attack], *params[param_release], 1.f, *params[param_asc], pow(0.5, (*params[param_asc_coeff] - 0.5) * 2 * -1), true);
+    int factor = 1 << (int)*params[param_oversampling];
+    if(factor != oversampling)
+        set_oversampling(factor);
     if( *params[param_attack] != attack_old) {
         attack_old = *params[param_attack];
         limiter.reset();
@@ -84,7 +88,18 @@ void limiter_audio_module::params_changed()
 void limiter_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
-    limiter.set_sample_rate(srate);
+    // allocate the lookahead buffer for the highest rate, changing the oversampling later won't need to
+    limiter.set_sample_rate(srate * dsp::oversampler::MAX_FACTOR);
+    set_oversampling(oversampling);
+}
+
+void limiter_audio_module::set_oversampling(int factor)
+{
+    oversampling = factor;
+    os[0].set_factor(factor);
+    os[1].set_factor(factor);
+    limiter.set_sample_rate(srate * factor);
+    limiter.reset();
 }
 
 uint32_t limiter_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
@@ -120,7 +135,31 @@ uint32_t limiter_audio_module::process(uint32_t offset, uint32_t numsamples, uin
         meter_outR = 0.f;
         asc_led   -= std::min(asc_led, numsamples);
 
-        while(offset < numsamples) {
+        // process gain reduction - at the oversampled rate if requested, so that
+        // the peaks between the samples get limited as well
+        uint32_t len = numsamples - offset;
+        float proc[2][MAX_SAMPLE_RUN];
+        float over[2][MAX_SAMPLE_RUN * dsp::oversampler::MAX_FACTOR];
+        for (uint32_t j = 0; j < len; ++j) {
+            proc[0][j] = ins[0][offset + j] * *params[param_level_in];
+            proc[1][j] = ins[1][offset + j] * *params[param_level_in];
+        }
+        float *procL = proc[0], *procR = proc[1];
+        if(oversampling > 1) {
+            os[0].upsample(proc[0], over[0], len);
+            os[1].upsample(proc[1], over[1], len);
+            procL = over[0];
+            procR = over[1];
+        }
+        limiter.process(procL, procR, NULL, len * oversampling);
+        if(limiter.get_asc())
+            asc_led = srate >> 3;
+        if(oversampling > 1) {
+            os[0].downsample(over[0], proc[0], len);
+            os[1].downsample(over[1], proc[1], len);
+        }
+
+        for (uint32_t j = 0; offset < numsamples; ++j) {
             // cycle through samples
             float inL = ins[0][offset];
             float inR = ins[1][offset];
@@ -128,14 +167,8 @@ uint32_t limiter_audio_module::process(uint32_t offset, uint32_t numsamples, uin
             inR *= *params[param_level_in];
             inL *= *params[param_level_in];
             // out vars
-            float outL = inL;
-            float outR = inR;
-
-            // process gain reduction
-            float fickdich[0];
-            limiter.process(outL, outR, fickdich);
-            if(limiter.get_asc())
-                asc_led = srate >> 3;
+            float outL = proc[0][j];
+            float outR = proc[1][j];
 
             // should never be used. but hackers are paranoid by default.
             // so we make shure NOTHING is above limit
@@ -234,17 +267,10 @@ multibandlimiter_audio_module::multibandlimiter_audio_module()
     meter_outR = 0.f;
     asc_led    = 0.f;
     attack_old = -1.f;
-    channels = 2;
-    buffer_size = 0;
-    overall_buffer_size = 0;
-    _sanitize = false;
     for(int i = 0; i < strips - 1; i ++) {
         freq_old[i] = -1;
-        sep_old[i] = -1;
-        q_old[i] = -1;
     }
-    mode_old = 0;
-    _mode = 0;
+    mode_old = -1;
     for(int i = 0; i < strips; i ++) {
         weight_old[i] = -1.f;
     }
@@ -253,6 +279,21 @@ multibandlimiter_audio_module::multibandlimiter_audio_module()
     asc_old = true;
     last_generation = 0;
     redraw_graph = false;
+    // long blocks go through the bands PARALLEL_RUN samples at a time,
+    // on the worker threads if there are any
+    pool = calf_utils::task_pool::get_shared();
+    band_buffer_size = PARALLEL_RUN;
+    band_buffer = new float[(strips * 2 + 1) * band_buffer_size];
+    for (int i = 0; i < strips * 2; i++)
+        bands[i] = band_buffer + i * band_buffer_size;
+    multi = band_buffer + strips * 2 * band_buffer_size;
+    band_run = 0;
+    batt = 1.f;
+}
+
+multibandlimiter_audio_module::~multibandlimiter_audio_module()
+{
+    delete []band_buffer;
 }
 
 void multibandlimiter_audio_module::activate()
@@ -263,11 +304,8 @@ void multibandlimiter_audio_module::activate()
     // activate all strips
     for (int j = 0; j < strips; j ++) {
         strip[j].activate();
-        strip[j].set_multi(true);
-        strip[j].id = j;
     }
     broadband.activate();
-    pos = 0;
 }
 
 void multibandlimiter_audio_module::deactivate()
@@ -292,67 +330,18 @@ void multibandlimiter_audio_module::params_changed()
             *params[param_solo2] > 0.f ||
             *params[param_solo3] > 0.f) ? false : true;
 
-    mode_old = _mode;
-    _mode = *params[param_mode];
-    int i;
-    int j1;
-    switch(_mode) {
-        case 0:
-        default:
-            j1 = 0;
-            break;
-        case 1:
-            j1 = 2;
-            break;
-    }
-    // set the params of all filters
-    if(*params[param_freq0] != freq_old[0] or *params[param_sep0] != sep_old[0] or *params[param_q0] != q_old[0] or *params[param_mode] != mode_old) {
-        lpL[0][0].set_lp_rbj((float)(*params[param_freq0] * (1 - *params[param_sep0])), *params[param_q0], (float)srate);
-        hpL[0][0].set_hp_rbj((float)(*params[param_freq0] * (1 + *params[param_sep0])), *params[param_q0], (float)srate);
-        lpR[0][0].copy_coeffs(lpL[0][0]);
-        hpR[0][0].copy_coeffs(hpL[0][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[0][i].copy_coeffs(lpL[0][0]);
-            hpL[0][i].copy_coeffs(hpL[0][0]);
-            lpR[0][i].copy_coeffs(lpL[0][0]);
-            hpR[0][i].copy_coeffs(hpL[0][0]);
-        }
-        freq_old[0] = *params[param_freq0];
-        sep_old[0]  = *params[param_sep0];
-        q_old[0]    = *params[param_q0];
-        redraw_graph = true;
-    }
-    if(*params[param_freq1] != freq_old[1] or *params[param_sep1] != sep_old[1] or *params[param_q1] != q_old[1] or *params[param_mode] != mode_old) {
-        lpL[1][0].set_lp_rbj((float)(*params[param_freq1] * (1 - *params[param_sep1])), *params[param_q1], (float)srate);
-        hpL[1][0].set_hp_rbj((float)(*params[param_freq1] * (1 + *params[param_sep1])), *params[param_q1], (float)srate);
-        lpR[1][0].copy_coeffs(lpL[1][0]);
-        hpR[1][0].copy_coeffs(hpL[1][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[1][i].copy_coeffs(lpL[1][0]);
-            hpL[1][i].copy_coeffs(hpL[1][0]);
-            lpR[1][i].copy_coeffs(lpL[1][0]);
-            hpR[1][i].copy_coeffs(hpL[1][0]);
-        }
-        freq_old[1] = *params[param_freq1];
-        sep_old[1]  = *params[param_sep1];
-        q_old[1]    = *params[param_q1];
+    // set the params of all filters (the crossover only recomputes the splits that changed)
+    if(*params[param_mode] != mode_old) {
+        mode_old = *params[param_mode];
+        xover.set_mode(mode_old);
         redraw_graph = true;
     }
-    if(*params[param_freq2] != freq_old[2] or *params[param_sep2] != sep_old[2] or *params[param_q2] != q_old[2] or *params[param_mode] != mode_old) {
-        lpL[2][0].set_lp_rbj((float)(*params[param_freq2] * (1 - *params[param_sep2])), *params[param_q2], (float)srate);
-        hpL[2][0].set_hp_rbj((float)(*params[param_freq2] * (1 + *params[param_sep2])), *params[param_q2], (float)srate);
-        lpR[2][0].copy_coeffs(lpL[2][0]);
-        hpR[2][0].copy_coeffs(hpL[2][0]);
-        for(i = 1; i <= j1; i++) {
-            lpL[2][i].copy_coeffs(lpL[2][0]);
-            hpL[2][i].copy_coeffs(hpL[2][0]);
-            lpR[2][i].copy_coeffs(lpL[2][0]);
-            hpR[2][i].copy_coeffs(hpL[2][0]);
+    for(int i = 0; i < strips - 1; i ++) {
+        if(*params[param_freq0 + i] != freq_old[i]) {
+            freq_old[i] = *params[param_freq0 + i];
+            xover.set_freq(i, freq_old[i]);
+            redraw_graph = true;
         }
-        freq_old[2] = *params[param_freq2];
-        sep_old[2]  = *params[param_sep2];
-        q_old[2]    = *params[param_q2];
-        redraw_graph = true;
     }
     if ((*params[param_bypass] > 0.5) != old_bypass)
     {
@@ -383,13 +372,9 @@ void multibandlimiter_audio_module::params_changed()
     strip[3].set_params(*params[param_limit], *params[param_attack], rel, weight[3], *params[param_asc], pow(0.5, (*params[param_asc_coeff] - 0.5) * 2 * -1));
     *params[param_effrelease3] = rel;
     broadband.set_params(*params[param_limit], *params[param_attack], rel, 1.f, *params[param_asc], pow(0.5, (*params[param_asc_coeff] - 0.5) * 2 * -1));
-    // rebuild multiband buffer
+    // rebuild lookahead buffers
     if( *params[param_attack] != attack_old) {
-        int bs = (int)(srate * (*params[param_attack] / 1000.f) * channels);
-        buffer_size = bs - bs % channels; // buffer size attack rate
         attack_old = *params[param_attack];
-        _sanitize = true;
-        pos = 0;
         for (int j = 0; j < strips; j ++) {
             strip[j].reset();
         }
@@ -412,11 +397,7 @@ void multibandlimiter_audio_module::params_changed()
 void multibandlimiter_audio_module::set_sample_rate(uint32_t sr)
 {
     srate = sr;
-    // rebuild buffer
-    overall_buffer_size = (int)(srate * (100.f / 1000.f) * channels) + channels; // buffer size max attack rate
-    buffer = (float*) calloc(overall_buffer_size, sizeof(float));
-    memset(buffer, 0, overall_buffer_size * sizeof(float)); // reset buffer to zero
-    pos = 0;
+    xover.set_sample_rate(srate);
     // set srate of all strips
     for (int j = 0; j < strips; j ++) {
         strip[j].set_sample_rate(srate);
@@ -433,132 +414,76 @@ void multibandlimiter_audio_module::set_sample_rate(uint32_t sr)
         *params[param_att##index] = strip[index].get_attenuation(); \
 
 
-uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
+void multibandlimiter_audio_module::split(uint32_t offset, uint32_t pos, uint32_t len)
 {
-    bool bypass = *params[param_bypass] > 0.5f;
-    numsamples += offset;
-    float batt = 0.f;
-    if(bypass) {
-        // everything bypassed
-        while(offset < numsamples) {
-            outs[0][offset] = ins[0][offset];
-            outs[1][offset] = ins[1][offset];
-            ++offset;
+    // in level, straight into the buffers of the top band (the crossover
+    // splits them in place)
+    float *topL = bands[strips * 2 - 2] + pos, *topR = bands[strips * 2 - 1] + pos;
+    for (uint32_t i = 0; i < len; i++) {
+        topL[i] = ins[0][offset + i] * *params[param_level_in];
+        topR[i] = ins[1][offset + i] * *params[param_level_in];
+    }
+    float *outs[strips * 2];
+    for (int i = 0; i < strips * 2; i++)
+        outs[i] = bands[i] + pos;
+    xover.process(topL, topR, outs, len);
+    // the limiter strips need the multiband coefficient of all bands
+    for (uint32_t k = 0; k < len; k++) {
+        float sum_left = 0.f;
+        float sum_right = 0.f;
+        for (int i = 0; i < strips; i++) {
+            float left  = outs[i * 2][k];
+            float right = outs[i * 2 + 1][k];
+            // sum up for multiband coefficient
+            sum_left += ((fabs(left) > *params[param_limit]) ? *params[param_limit] * (fabs(left) / left) : left) * weight[i];
+            sum_right += ((fabs(right) > *params[param_limit]) ? *params[param_limit] * (fabs(right) / right) : right) * weight[i];
         }
-        // displays, too
-        clip_inL    = 0.f;
-        clip_inR    = 0.f;
-        clip_outL   = 0.f;
-        clip_outR   = 0.f;
-        meter_inL  = 0.f;
-        meter_inR  = 0.f;
-        meter_outL = 0.f;
-        meter_outR = 0.f;
-        asc_led    = 0.f;
-    } else {
-        // process all strips
+        multi[pos + k] = std::min(*params[param_limit] / std::max(fabs(sum_left), fabs(sum_right)), 1.f);
+    }
+}
 
-        // let meters fall a bit
-        clip_inL    -= std::min(clip_inL,  numsamples);
-        clip_inR    -= std::min(clip_inR,  numsamples);
-        clip_outL   -= std::min(clip_outL, numsamples);
-        clip_outR   -= std::min(clip_outR, numsamples);
-        asc_led     -= std::min(asc_led, numsamples);
-        meter_inL = 0.f;
-        meter_inR = 0.f;
-        meter_outL = 0.f;
-        meter_outR = 0.f;
-        float _tmpL[channels];
-        float _tmpR[channels];
-        while(offset < numsamples) {
-            float inL = 0.f;
-            float inR = 0.f;
-            // cycle through samples
-            if(!_sanitize) {
-                inL = ins[0][offset];
-                inR = ins[1][offset];
-            }
-            // in level
-            inR *= *params[param_level_in];
-            inL *= *params[param_level_in];
-            // even out filters gain reduction
-            // 3dB - levelled manually (based on default sep and q settings)
-            switch(_mode) {
-                case 0:
-                    inL *= 1.414213562;
-                    inR *= 1.414213562;
-                    break;
-                case 1:
-                    inL *= 0.88;
-                    inR *= 0.88;
-                    break;
-            }
-            // out vars
-            float outL = 0.f;
-            float outR = 0.f;
-            int j1;
-            float left;
-            float right;
-            float sum_left = 0.f;
-            float sum_right = 0.f;
-            bool asc_active = false;
-            for (int i = 0; i < strips; i++) {
-                left  = inL;
-                right = inR;
-                // send trough filters
-                switch(_mode) {
-                    // how many filter passes? (12/36dB)
-                    case 0:
-                    default:
-                        j1 = 0;
-                        break;
-                    case 1:
-                        j1 = 2;
-                        break;
-                }
-                for (int j = 0; j <= j1; j++){
-                    if(i + 1 < strips) {
-                        // do lowpass on all bands except most high
-                        left  = lpL[i][j].process(left);
-                        right = lpR[i][j].process(right);
-                        lpL[i][j].sanitize();
-                        lpR[i][j].sanitize();
-                    }
-                    if(i - 1 >= 0) {
-                        // do highpass on all bands except most low
-                        left  = hpL[i - 1][j].process(left);
-                        right = hpR[i - 1][j].process(right);
-                        hpL[i - 1][j].sanitize();
-                        hpR[i - 1][j].sanitize();
-                    }
-                }
+void multibandlimiter_audio_module::process_band(int band, uint32_t pos, uint32_t len)
+{
+    // process gain reduction
+    strip[band].process(bands[band * 2] + pos, bands[band * 2 + 1] + pos, multi + pos, len);
+}
 
-                // remember filtered values for limiting
-                // (we need multiband_coeff before we can call the limiter bands)
-                _tmpL[i] = left;
-                _tmpR[i] = right;
-
-                // sum up for multiband coefficient
-                sum_left += ((fabs(left) > *params[param_limit]) ? *params[param_limit] * (fabs(left) / left) : left) * weight[i];
-                sum_right += ((fabs(right) > *params[param_limit]) ? *params[param_limit] * (fabs(right) / right) : right) * weight[i];
-            } // process single strip with filter
-
-            // write multiband coefficient to buffer
-            buffer[pos] = std::min(*params[param_limit] / std::max(fabs(sum_left), fabs(sum_right)), 1.0);
-
-            for (int i = 0; i < strips; i++) {
-                // process gain reduction
-                strip[i].process(_tmpL[i], _tmpR[i], buffer);
-                // sum up output of limiters
-                if (solo[i] || no_solo) {
-                    outL += _tmpL[i];
-                    outR += _tmpR[i];
+void multibandlimiter_audio_module::process_band_task(void *arg, int band)
+{
+    multibandlimiter_audio_module *self = (multibandlimiter_audio_module *)arg;
+    dsp::denormal_guard guard;
+    self->process_band(band, 0, self->band_run);
+}
+
+void multibandlimiter_audio_module::mix(uint32_t offset, uint32_t pos, uint32_t len)
+{
+    bool asc_active = false;
+    for (int i = 0; i < strips; i++)
+        asc_active = asc_active || strip[i].get_asc();
+    float sumL[MAX_SAMPLE_RUN], sumR[MAX_SAMPLE_RUN];
+    for (uint32_t done = 0; done < len; done += MAX_SAMPLE_RUN) {
+        uint32_t run = std::min<uint32_t>(len - done, MAX_SAMPLE_RUN);
+        // sum up output of limiters
+        for (uint32_t k = 0; k < run; k++) {
+            sumL[k] = 0.f;
+            sumR[k] = 0.f;
+        }
+        for (int i = 0; i < strips; i++) {
+            if (solo[i] || no_solo) {
+                const float *bandL = bands[i * 2] + pos + done, *bandR = bands[i * 2 + 1] + pos + done;
+                for (uint32_t k = 0; k < run; k++) {
+                    sumL[k] += bandL[k];
+                    sumR[k] += bandR[k];
                 }
-                asc_active = asc_active || strip[i].get_asc();
-            } // process single strip again for limiter
-            float fickdich[0];
-            broadband.process(outL, outR, fickdich);
-            asc_active = asc_active || broadband.get_asc();
+            }
+        }
+        broadband.process(sumL, sumR, NULL, run);
+        asc_active = asc_active || broadband.get_asc();
+
+        for (uint32_t k = 0; k < run; ++k) {
+            uint32_t o = offset + done + k;
+            float outL = sumL[k];
+            float outR = sumR[k];
 
             // should never be used. but hackers are paranoid by default.
             // so we make shure NOTHING is above limit
@@ -567,8 +492,6 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
             outR = std::max(outR, -*params[param_limit]);
             outR = std::min(outR, *params[param_limit]);
 
-            batt = broadband.get_attenuation();
-
             // autolevel
             outL /= *params[param_limit];
             outR /= *params[param_limit];
@@ -578,14 +501,14 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
             outR *= *params[param_level_out];
 
             // send to output
-            outs[0][offset] = outL;
-            outs[1][offset] = outR;
+            outs[0][o] = outL;
+            outs[1][o] = outR;
 
             // clip LED's
-            if(ins[0][offset] * *params[param_level_in] > 1.f) {
+            if(ins[0][o] * *params[param_level_in] > 1.f) {
                 clip_inL  = srate >> 3;
             }
-            if(ins[1][offset] * *params[param_level_in] > 1.f) {
+            if(ins[1][o] * *params[param_level_in] > 1.f) {
                 clip_inR  = srate >> 3;
             }
             if(outL > 1.f) {
@@ -595,11 +518,11 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
                 clip_outR = srate >> 3;
             }
             // set up in / out meters
-            if(ins[0][offset] * *params[param_level_in] > meter_inL) {
-                meter_inL = ins[0][offset] * *params[param_level_in];
+            if(ins[0][o] * *params[param_level_in] > meter_inL) {
+                meter_inL = ins[0][o] * *params[param_level_in];
             }
-            if(ins[1][offset] * *params[param_level_in] > meter_inR) {
-                meter_inR = ins[1][offset] * *params[param_level_in];
+            if(ins[1][o] * *params[param_level_in] > meter_inR) {
+                meter_inR = ins[1][o] * *params[param_level_in];
             }
             if(outL > meter_outL) {
                 meter_outL = outL;
@@ -607,17 +530,30 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
             if(outR > meter_outR) {
                 meter_outR = outR;
             }
-            if(asc_active)  {
-                asc_led = srate >> 3;
-            }
-            // next sample
-            ++offset;
-            pos = (pos + channels) % buffer_size;
-            if(pos == 0) _sanitize = false;
         } // cycle trough samples
+    }
+    batt = broadband.get_attenuation();
+    if(asc_active)  {
+        asc_led = srate >> 3;
+    }
+}
 
-    } // process all strips (no bypass)
+void multibandlimiter_audio_module::begin_meters(uint32_t numsamples)
+{
+    // let meters fall a bit
+    clip_inL    -= std::min(clip_inL,  numsamples);
+    clip_inR    -= std::min(clip_inR,  numsamples);
+    clip_outL   -= std::min(clip_outL, numsamples);
+    clip_outR   -= std::min(clip_outR, numsamples);
+    asc_led     -= std::min(asc_led, numsamples);
+    meter_inL = 0.f;
+    meter_inR = 0.f;
+    meter_outL = 0.f;
+    meter_outR = 0.f;
+}
 
+void multibandlimiter_audio_module::set_meters(bool bypass)
+{
     // draw meters
     SET_IF_CONNECTED(clip_inL);
     SET_IF_CONNECTED(clip_inR);
@@ -631,7 +567,7 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
     if (params[param_asc_led] != NULL) *params[param_asc_led] = asc_led;
 
     // draw strip meters
-    if(bypass > 0.5f) {
+    if(bypass) {
         if(params[param_att0] != NULL) *params[param_att0] = 1.0;
         if(params[param_att1] != NULL) *params[param_att1] = 1.0;
         if(params[param_att2] != NULL) *params[param_att2] = 1.0;
@@ -643,41 +579,73 @@ uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsam
         if(params[param_att2] != NULL) *params[param_att2] = strip[2].get_attenuation() * batt;
         if(params[param_att3] != NULL) *params[param_att3] = strip[3].get_attenuation() * batt;
     }
+}
+
+uint32_t multibandlimiter_audio_module::process(uint32_t offset, uint32_t numsamples, uint32_t inputs_mask, uint32_t outputs_mask)
+{
+    bool bypass = *params[param_bypass] > 0.5f;
+    numsamples += offset;
+    if(bypass) {
+        // everything bypassed
+        while(offset < numsamples) {
+            outs[0][offset] = ins[0][offset];
+            outs[1][offset] = ins[1][offset];
+            ++offset;
+        }
+        // displays, too
+        clip_inL    = 0.f;
+        clip_inR    = 0.f;
+        clip_outL   = 0.f;
+        clip_outR   = 0.f;
+        meter_inL  = 0.f;
+        meter_inR  = 0.f;
+        meter_outL = 0.f;
+        meter_outR = 0.f;
+        asc_led    = 0.f;
+    } else {
+        // split -> process all strips -> sum up and limit once more
+        uint32_t len = numsamples - offset;
+        begin_meters(numsamples);
+        split(offset, 0, len);
+        for (int i = 0; i < strips; i++)
+            process_band(i, 0, len);
+        mix(offset, 0, len);
+    }
+    set_meters(bypass);
     // whatever has to be returned x)
     return outputs_mask;
 }
 
+uint32_t multibandlimiter_audio_module::process_slice(uint32_t offset, uint32_t end)
+{
+    if (end - offset < PARALLEL_MIN_RUN || *params[param_bypass] > 0.5f)
+        return audio_module<multibandlimiter_metadata>::process_slice(offset, end);
+    // long blocks: the strips run on the worker threads (if any), each one
+    // over up to PARALLEL_RUN samples at a time
+    dsp::denormal_guard guard;
+    begin_meters(end - offset);
+    while(offset < end) {
+        uint32_t len = std::min<uint32_t>(end - offset, band_buffer_size);
+        for (uint32_t pos = 0; pos < len; pos += MAX_SAMPLE_RUN)
+            split(offset + pos, pos, std::min<uint32_t>(len - pos, MAX_SAMPLE_RUN));
+        band_run = len;
+        pool->run(process_band_task, this, strips);
+        mix(offset, 0, len);
+        offset += len;
+    }
+    set_meters(false);
+    return 3;
+}
+
 bool multibandlimiter_audio_module::get_graph(int index, int subindex, float *data, int points, cairo_iface *context, int *mode) const
 {
     if (!is_active or subindex > 3)
         return false;
-    float ret;
     double freq;
-    int j1;
     for (int i = 0; i < points; i++)
     {
-        ret = 1.f;
         freq = 20.0 * pow (20000.0 / 20.0, i * 1.0 / points);
-        switch(_mode) {
-            case 0:
-            default:
-                j1 = 0;
-                break;
-            case 1:
-                j1 = 2;
-                break;
-        }
-        for(int j = 0; j <= j1; j ++) {
-            if(subindex == 0)
-                ret *= lpL[0][j].freq_gain(freq, (float)srate);
-            if(subindex > 0 and subindex < strips - 1) {
-                ret *= hpL[subindex - 1][j].freq_gain(freq, (float)srate);
-                ret *= lpL[subindex][j].freq_gain(freq, (float)srate);
-            }
-            if(subindex == strips - 1)
-                ret *= hpL[2][j].freq_gain(freq, (float)srate);
-        }
-        data[i] = dB_grid(ret);
+        data[i] = dB_grid(xover.freq_gain(subindex, freq));
     }
     if (*params[param_bypass] > 0.5f)
         context->set_source_rgba(0.35, 0.4, 0.2, 0.3);
@@ -84,20 +84,20 @@ void monosynth_audio_module::precalculate_waves(progress_report_iface *reporter)
     for (int i = 0 ; i < HS; i++)
         data[i] = (float)(i * 1.0 / HS),
         data[i + HS] = (float)(i * 1.0 / HS - 1.0f);
-    waves[wave_saw].make(bl, data);
+    waves[wave_saw].make_lazy(bl, data);
 
     // this one is dummy, fake and sham, we're using a difference of two sawtooths for square wave due to PWM
     for (int i = 0 ; i < S; i++)
         data[i] = (float)(i < HS ? -1.f : 1.f);
-    waves[wave_sqr].make(bl, data, 4);
+    waves[wave_sqr].make_lazy(bl, data, 4);
 
     for (int i = 0 ; i < S; i++)
         data[i] = (float)(i < (64 * S / 2048)? -1.f : 1.f);
-    waves[wave_pulse].make(bl, data);
+    waves[wave_pulse].make_lazy(bl, data);
 
     for (int i = 0 ; i < S; i++)
         data[i] = (float)sin(i * M_PI / HS);
-    waves[wave_sine].make(bl, data);
+    waves[wave_sine].make_lazy(bl, data);
 
     for (int i = 0 ; i < QS; i++) {
         data[i] = i * iQS,
@@ -105,23 +105,23 @@ void monosynth_audio_module::precalculate_waves(progress_report_iface *reporter)
         data[i + HS] = - i * iQS,
         data[i + QS3] = -1 + i * iQS;
     }
-    waves[wave_triangle].make(bl, data);
+    waves[wave_triangle].make_lazy(bl, data);
     
     for (int i = 0, j = 1; i < S; i++) {
         data[i] = -1 + j * 1.0 / HS;
         if (i == j)
             j *= 2;
     }
-    waves[wave_varistep].make(bl, data);
+    waves[wave_varistep].make_lazy(bl, data);
 
     for (int i = 0; i < S; i++) {
         data[i] = (min(1.f, (float)(i / 64.f))) * (1.0 - i * 1.0 / S) * (-1 + fmod (i * i * 8/ (S * S * 1.0), 2.0));
     }
-    waves[wave_skewsaw].make(bl, data);
+    waves[wave_skewsaw].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         data[i] = (min(1.f, (float)(i / 64.f))) * (1.0 - i * 1.0 / S) * (fmod (i * i * 8/ (S * S * 1.0), 2.0) < 1.0 ? -1.0 : +1.0);
     }
-    waves[wave_skewsqr].make(bl, data);
+    waves[wave_skewsqr].make_lazy(bl, data);
 
     if (reporter)
         reporter->report_progress(50, "Precalculating waveforms");
@@ -135,26 +135,26 @@ void monosynth_audio_module::precalculate_waves(progress_report_iface *reporter)
             data[i] = -0.5 * sin(3 * M_PI * p * p);
         }
     }
-    waves[wave_test1].make(bl, data);
+    waves[wave_test1].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         data[i] = exp(-i * 1.0 / HS) * sin(i * M_PI / HS) * cos(2 * M_PI * i / HS);
     }
     normalize_waveform(data, S);
-    waves[wave_test2].make(bl, data);
+    waves[wave_test2].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         //int ii = (i < HS) ? i : S - i;
         int ii = HS;
         data[i] = (ii * 1.0 / HS) * sin(i * 3 * M_PI / HS + 2 * M_PI * sin(M_PI / 4 + i * 4 * M_PI / HS)) * sin(i * 5 * M_PI / HS + 2 * M_PI * sin(M_PI / 8 + i * 6 * M_PI / HS));
     }
-    waves[wave_test3].make(bl, data);
+    waves[wave_test3].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         data[i] = sin(i * 2 * M_PI / HS + sin(i * 2 * M_PI / HS + 0.5 * M_PI * sin(i * 18 * M_PI / HS)) * sin(i * 1 * M_PI / HS + 0.5 * M_PI * sin(i * 11 * M_PI / HS)));
     }
-    waves[wave_test4].make(bl, data);
+    waves[wave_test4].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         data[i] = sin(i * 2 * M_PI / HS + 0.2 * M_PI * sin(i * 13 * M_PI / HS) + 0.1 * M_PI * sin(i * 37 * M_PI / HS)) * sin(i * M_PI / HS + 0.2 * M_PI * sin(i * 15 * M_PI / HS));
     }
-    waves[wave_test5].make(bl, data);
+    waves[wave_test5].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         if (i < HS)
             data[i] = sin(i * 2 * M_PI / HS);
@@ -167,17 +167,17 @@ void monosynth_audio_module::precalculate_waves(progress_report_iface *reporter)
         else
             data[i] = sin(i * 8 * M_PI / HS) * (S - i) / (S / 8);
     }
-    waves[wave_test6].make(bl, data);
+    waves[wave_test6].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         int j = i >> (MONOSYNTH_WAVE_BITS - 11);
         data[i] = (j ^ 0x1D0) * 1.0 / HS - 1;
     }
-    waves[wave_test7].make(bl, data);
+    waves[wave_test7].make_lazy(bl, data);
     for (int i = 0; i < S; i++) {
         int j = i >> (MONOSYNTH_WAVE_BITS - 11);
         data[i] = -1 + 0.66 * (3 & ((j >> 8) ^ (j >> 10) ^ (j >> 6)));
     }
-    waves[wave_test8].make(bl, data);
+    waves[wave_test8].make_lazy(bl, data);
     if (reporter)
         reporter->report_progress(100, "");
     
@@ -22,6 +22,7 @@
 
 #include <calf/giface.h>
 #include <calf/organ.h>
+#include <calf/utils.h>
 #include <iostream>
 
 using namespace std;
@@ -224,7 +225,7 @@ static void padsynth(bandlimiter<ORGAN_WAVE_BITS> blSrc, bandlimiter<ORGAN_BIG_W
     blDest.compute_spectrum(ptmp);
     
     // limit is 1/2 of the number of harmonics of the original wave
-    result.make_from_spectrum(blDest, foldover, ORGAN_WAVE_SIZE >> (1 + ORGAN_BIG_WAVE_SHIFT));
+    result.make_from_spectrum_lazy(blDest, foldover, ORGAN_WAVE_SIZE >> (1 + ORGAN_BIG_WAVE_SHIFT));
     memcpy(result.original, result.begin()->second, sizeof(result.original));
     #if 0
     blDest.compute_waveform(result);
@@ -235,6 +236,247 @@ static void padsynth(bandlimiter<ORGAN_WAVE_BITS> blSrc, bandlimiter<ORGAN_BIG_W
     #endif
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+// On-disk cache of precalculated waves
+//
+// The file is mapped read-only by every organ instance (in any process) and the levels are used
+// directly from the mapping, so the pages are shared instead of each process keeping its own copy.
+// Layout: header, family table, level table, then 64-byte aligned float tables - for each family,
+// the original wave (SIZE values) followed by its levels (SIZE + 1 values each).
+
+/// Bump whenever anything that affects the generated waves changes (wave shapes, bandlimiter,
+/// padsynth parameters, FFT code etc.) - old cache files are then ignored and rewritten.
+#define ORGAN_WAVE_CACHE_VERSION 1
+
+struct organ_wave_cache_header
+{
+    char magic[8];
+    uint32_t version;
+    /// 0x01020304 in the byte order of the machine that wrote the file
+    uint32_t byte_order;
+    uint32_t small_bits, big_bits;
+    uint32_t small_count, big_count;
+    uint32_t level_count;
+    /// checksum of everything following the header
+    uint32_t checksum;
+    uint64_t file_size;
+};
+
+struct organ_wave_cache_family
+{
+    uint32_t first_level, level_count;
+    uint64_t original_offset;
+};
+
+struct organ_wave_cache_level
+{
+    uint32_t key, reserved;
+    uint64_t offset;
+};
+
+static const char organ_wave_cache_magic[8] = { 'C', 'A', 'L', 'F', 'W', 'A', 'V', 'E' };
+
+static inline uint64_t cache_align(uint64_t offset)
+{
+    return (offset + 63) & ~(uint64_t)63;
+}
+
+static uint32_t wave_cache_checksum(const void *data, uint64_t size)
+{
+    // Fletcher-style, works on 32-bit words
+    const uint32_t *words = (const uint32_t *)data;
+    uint64_t a = 1, b = 0;
+    for (uint64_t i = 0; i < size / 4; i++)
+    {
+        a += words[i];
+        b += a;
+    }
+    return (uint32_t)(a ^ (a >> 32) ^ b ^ (b >> 32));
+}
+
+static string organ_wave_cache_file()
+{
+    string dir = calf_utils::get_cache_dir();
+    if (dir.empty())
+        return dir;
+    return dir + "/organ-waves-" + calf_utils::i2s(ORGAN_WAVE_CACHE_VERSION) + ".bin";
+}
+
+/// Append index entries for the families, returns the offset past the last table
+template<class Family>
+static uint64_t layout_wave_cache(Family *families, int count, uint64_t offset, vector<organ_wave_cache_family> &ftab, vector<organ_wave_cache_level> &ltab)
+{
+    for (int i = 0; i < count; i++)
+    {
+        organ_wave_cache_family f;
+        f.first_level = ltab.size();
+        f.level_count = families[i].size();
+        f.original_offset = offset;
+        offset = cache_align(offset + sizeof(families[i].original));
+        for (typename Family::iterator j = families[i].begin(); j != families[i].end(); j++)
+        {
+            organ_wave_cache_level l;
+            l.key = j->first;
+            l.reserved = 0;
+            l.offset = offset;
+            ltab.push_back(l);
+            offset = cache_align(offset + (Family::SIZE + 1) * sizeof(float));
+        }
+        ftab.push_back(f);
+    }
+    return offset;
+}
+
+template<class Family>
+static void fill_wave_cache(Family *families, int count, char *file, const organ_wave_cache_family *ftab, const organ_wave_cache_level *ltab)
+{
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(file + ftab[i].original_offset, families[i].original, sizeof(families[i].original));
+        const organ_wave_cache_level *l = ltab + ftab[i].first_level;
+        for (typename Family::iterator j = families[i].begin(); j != families[i].end(); j++, l++)
+            memcpy(file + l->offset, j->second, (Family::SIZE + 1) * sizeof(float));
+    }
+}
+
+template<class Family>
+static bool check_wave_cache(const Family *families, int count, uint64_t file_size, const organ_wave_cache_family *ftab, const organ_wave_cache_level *ltab, uint32_t level_count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const organ_wave_cache_family &f = ftab[i];
+        if (!f.level_count || f.first_level + f.level_count > level_count || f.original_offset + sizeof(families[i].original) > file_size)
+            return false;
+        for (uint32_t j = 0; j < f.level_count; j++)
+        {
+            if (ltab[f.first_level + j].offset + (Family::SIZE + 1) * sizeof(float) > file_size)
+                return false;
+        }
+    }
+    return true;
+}
+
+/// Point the families into the mapped file, which must have passed check_wave_cache
+template<class Family>
+static void attach_wave_cache(Family *families, int count, const char *file, const organ_wave_cache_family *ftab, const organ_wave_cache_level *ltab)
+{
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(families[i].original, file + ftab[i].original_offset, sizeof(families[i].original));
+        for (uint32_t j = 0; j < ftab[i].level_count; j++)
+        {
+            const organ_wave_cache_level &l = ltab[ftab[i].first_level + j];
+            families[i].attach_level(l.key, (const float *)(file + l.offset));
+        }
+    }
+}
+
+static bool load_wave_cache(organ_voice_base::small_wave_family *waves, organ_voice_base::big_wave_family *big_waves)
+{
+    // kept mapped for the lifetime of the process, the families point into it
+    static calf_utils::mapped_file cache;
+    string filename = organ_wave_cache_file();
+    if (filename.empty() || !cache.map(filename))
+        return false;
+    const char *file = (const char *)cache.get_data();
+    uint64_t file_size = cache.get_size();
+    const organ_wave_cache_header *hdr = (const organ_wave_cache_header *)file;
+    uint64_t index_end = sizeof(organ_wave_cache_header) + (organ_voice_base::wave_count_small + organ_voice_base::wave_count_big) * sizeof(organ_wave_cache_family);
+    if (file_size < index_end
+        || memcmp(hdr->magic, organ_wave_cache_magic, sizeof(hdr->magic))
+        || hdr->version != ORGAN_WAVE_CACHE_VERSION
+        || hdr->byte_order != 0x01020304
+        || hdr->small_bits != ORGAN_WAVE_BITS || hdr->big_bits != ORGAN_BIG_WAVE_BITS
+        || hdr->small_count != (uint32_t)organ_voice_base::wave_count_small || hdr->big_count != (uint32_t)organ_voice_base::wave_count_big
+        || hdr->file_size != file_size
+        || file_size < index_end + hdr->level_count * sizeof(organ_wave_cache_level)
+        || hdr->checksum != wave_cache_checksum(file + sizeof(organ_wave_cache_header), file_size - sizeof(organ_wave_cache_header)))
+    {
+        cache.unmap();
+        return false;
+    }
+    const organ_wave_cache_family *ftab = (const organ_wave_cache_family *)(hdr + 1);
+    const organ_wave_cache_level *ltab = (const organ_wave_cache_level *)(ftab + organ_voice_base::wave_count_small + organ_voice_base::wave_count_big);
+    // check both sets before attaching any, the file mustn't be unmapped once a family points into it
+    if (!check_wave_cache(waves, organ_voice_base::wave_count_small, file_size, ftab, ltab, hdr->level_count)
+        || !check_wave_cache(big_waves, organ_voice_base::wave_count_big, file_size, ftab + organ_voice_base::wave_count_small, ltab, hdr->level_count))
+    {
+        cache.unmap();
+        return false;
+    }
+    attach_wave_cache(waves, organ_voice_base::wave_count_small, file, ftab, ltab);
+    attach_wave_cache(big_waves, organ_voice_base::wave_count_big, file, ftab + organ_voice_base::wave_count_small, ltab);
+    return true;
+}
+
+static void save_wave_cache(organ_voice_base::small_wave_family *waves, organ_voice_base::big_wave_family *big_waves)
+{
+    string filename = organ_wave_cache_file();
+    if (filename.empty())
+        return;
+    vector<organ_wave_cache_family> ftab;
+    vector<organ_wave_cache_level> ltab;
+    uint32_t level_count = 0;
+    for (int i = 0; i < organ_voice_base::wave_count_small; i++)
+        level_count += waves[i].size();
+    for (int i = 0; i < organ_voice_base::wave_count_big; i++)
+        level_count += big_waves[i].size();
+    uint64_t offset = cache_align(sizeof(organ_wave_cache_header) + (organ_voice_base::wave_count_small + organ_voice_base::wave_count_big) * sizeof(organ_wave_cache_family) + level_count * sizeof(organ_wave_cache_level));
+    offset = layout_wave_cache(waves, organ_voice_base::wave_count_small, offset, ftab, ltab);
+    offset = layout_wave_cache(big_waves, organ_voice_base::wave_count_big, offset, ftab, ltab);
+    
+    vector<char> file(offset);
+    fill_wave_cache(waves, organ_voice_base::wave_count_small, &file[0], &ftab[0], &ltab[0]);
+    fill_wave_cache(big_waves, organ_voice_base::wave_count_big, &file[0], &ftab[organ_voice_base::wave_count_small], &ltab[0]);
+    memcpy(&file[sizeof(organ_wave_cache_header)], &ftab[0], ftab.size() * sizeof(organ_wave_cache_family));
+    memcpy(&file[sizeof(organ_wave_cache_header) + ftab.size() * sizeof(organ_wave_cache_family)], &ltab[0], ltab.size() * sizeof(organ_wave_cache_level));
+    
+    organ_wave_cache_header *hdr = (organ_wave_cache_header *)&file[0];
+    memcpy(hdr->magic, organ_wave_cache_magic, sizeof(hdr->magic));
+    hdr->version = ORGAN_WAVE_CACHE_VERSION;
+    hdr->byte_order = 0x01020304;
+    hdr->small_bits = ORGAN_WAVE_BITS;
+    hdr->big_bits = ORGAN_BIG_WAVE_BITS;
+    hdr->small_count = organ_voice_base::wave_count_small;
+    hdr->big_count = organ_voice_base::wave_count_big;
+    hdr->level_count = level_count;
+    hdr->file_size = offset;
+    hdr->checksum = wave_cache_checksum(&file[sizeof(organ_wave_cache_header)], offset - sizeof(organ_wave_cache_header));
+    // failure to write the cache is harmless, the waves will just be calculated again next time
+    calf_utils::write_file_atomic(filename, &file[0], file.size());
+}
+
+/// Waits for the lazily calculated levels to be finished in the background, then writes the cache
+struct organ_wave_cache_writer: public waveform_builder::job
+{
+    organ_voice_base::small_wave_family *waves;
+    organ_voice_base::big_wave_family *big_waves;
+    
+    organ_wave_cache_writer(organ_voice_base::small_wave_family *_waves, organ_voice_base::big_wave_family *_big_waves)
+    : waves(_waves), big_waves(_big_waves)
+    {
+        for (int i = 0; i < organ_voice_base::wave_count_small; i++)
+            waves[i].request_all();
+        for (int i = 0; i < organ_voice_base::wave_count_big; i++)
+            big_waves[i].request_all();
+    }
+    virtual bool run()
+    {
+        for (int i = 0; i < organ_voice_base::wave_count_small; i++)
+            if (!waves[i].is_complete())
+                return false;
+        for (int i = 0; i < organ_voice_base::wave_count_big; i++)
+            if (!big_waves[i].is_complete())
+                return false;
+        save_wave_cache(waves, big_waves);
+        return true;
+    }
+    ~organ_wave_cache_writer()
+    {
+        waveform_builder::remove(this);
+    }
+};
+
 #define LARGE_WAVEFORM_PROGRESS() do { if (reporter) { progress += 100; reporter->report_progress(floor(progress / totalwaves), "Precalculating large waveforms"); } } while(0)
 
 void organ_voice_base::update_pitch()
@@ -254,6 +496,12 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
         organ_voice_base::waves = &waves;
         organ_voice_base::big_waves = &big_waves;
         
+        if (load_wave_cache(waves, big_waves))
+        {
+            inited = true;
+            return;
+        }
+        
         float progress = 0.0;
         int totalwaves = 1 + wave_count_big;
         if (reporter)
@@ -263,62 +511,62 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
         static bandlimiter<ORGAN_BIG_WAVE_BITS> blBig;
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = sin(i * 2 * M_PI / ORGAN_WAVE_SIZE);
-        waves[wave_sine].make(bl, tmp);
+        waves[wave_sine].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = (i < (ORGAN_WAVE_SIZE / 16)) ? 1 : 0;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_pulse].make(bl, tmp);
+        waves[wave_pulse].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = i < (ORGAN_WAVE_SIZE / 2) ? sin(i * 2 * 2 * M_PI / ORGAN_WAVE_SIZE) : 0;
-        waves[wave_sinepl1].make(bl, tmp);
+        waves[wave_sinepl1].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = i < (ORGAN_WAVE_SIZE / 3) ? sin(i * 3 * 2 * M_PI / ORGAN_WAVE_SIZE) : 0;
-        waves[wave_sinepl2].make(bl, tmp);
+        waves[wave_sinepl2].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = i < (ORGAN_WAVE_SIZE / 4) ? sin(i * 4 * 2 * M_PI / ORGAN_WAVE_SIZE) : 0;
-        waves[wave_sinepl3].make(bl, tmp);
+        waves[wave_sinepl3].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = (i < (ORGAN_WAVE_SIZE / 2)) ? 1 : -1;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_sqr].make(bl, tmp);
+        waves[wave_sqr].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = -1 + (i * 2.0 / ORGAN_WAVE_SIZE);
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_saw].make(bl, tmp);
+        waves[wave_saw].make_lazy(bl, tmp);
         
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = (i < (ORGAN_WAVE_SIZE / 2)) ? 1 : -1;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
         smoothen(bl, tmp);
-        waves[wave_ssqr].make(bl, tmp);
+        waves[wave_ssqr].make_lazy(bl, tmp);
         
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = -1 + (i * 2.0 / ORGAN_WAVE_SIZE);
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
         smoothen(bl, tmp);
-        waves[wave_ssaw].make(bl, tmp);
+        waves[wave_ssaw].make_lazy(bl, tmp);
 
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = (i < (ORGAN_WAVE_SIZE / 16)) ? 1 : 0;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
         smoothen(bl, tmp);
-        waves[wave_spls].make(bl, tmp);
+        waves[wave_spls].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = i < (ORGAN_WAVE_SIZE / 1.5) ? sin(i * 1.5 * 2 * M_PI / ORGAN_WAVE_SIZE) : 0;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_sinepl05].make(bl, tmp);
+        waves[wave_sinepl05].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = i < (ORGAN_WAVE_SIZE / 1.5) ? (i < ORGAN_WAVE_SIZE / 3 ? -1 : +1) : 0;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_sqr05].make(bl, tmp);
+        waves[wave_sqr05].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = sin(i * M_PI / ORGAN_WAVE_SIZE);
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_halfsin].make(bl, tmp);
+        waves[wave_halfsin].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = sin(i * 3 * M_PI / ORGAN_WAVE_SIZE);
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_clvg].make(bl, tmp);
+        waves[wave_clvg].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
@@ -326,7 +574,7 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
             tmp[i] = sin(5*ph + fm) + 0.7 * cos(7*ph - fm);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_bell].make(bl, tmp, true);
+        waves[wave_bell].make_lazy(bl, tmp, true);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
@@ -334,7 +582,7 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
             tmp[i] = sin(3*ph + fm) + cos(7*ph - fm);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_bell2].make(bl, tmp, true);
+        waves[wave_bell2].make_lazy(bl, tmp, true);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
@@ -342,81 +590,81 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
             tmp[i] = sin(4*ph + fm) + cos(ph - fm);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w1].make(bl, tmp);
+        waves[wave_w1].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
             tmp[i] = sin(ph) * sin(2 * ph) * sin(4 * ph) * sin(8 * ph);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w2].make(bl, tmp);
+        waves[wave_w2].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
             tmp[i] = sin(ph) * sin(3 * ph) * sin(5 * ph) * sin(7 * ph) * sin(9 * ph);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w3].make(bl, tmp);
+        waves[wave_w3].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
             tmp[i] = sin(ph + 2 * sin(ph + 2 * sin(ph)));
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w4].make(bl, tmp);
+        waves[wave_w4].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
             tmp[i] = ph * sin(ph);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w5].make(bl, tmp);
+        waves[wave_w5].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 2 * M_PI / ORGAN_WAVE_SIZE;
             tmp[i] = ph * sin(ph) + (2 * M_PI - ph) * sin(2 * ph);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w6].make(bl, tmp);
+        waves[wave_w6].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 1.0 / ORGAN_WAVE_SIZE;
             tmp[i] = exp(-ph * ph);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w7].make(bl, tmp);
+        waves[wave_w7].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 1.0 / ORGAN_WAVE_SIZE;
             tmp[i] = exp(-ph * sin(2 * M_PI * ph));
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w8].make(bl, tmp);
+        waves[wave_w8].make_lazy(bl, tmp);
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
         {
             float ph = i * 1.0 / ORGAN_WAVE_SIZE;
             tmp[i] = sin(2 * M_PI * ph * ph);
         }
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
-        waves[wave_w9].make(bl, tmp);
+        waves[wave_w9].make_lazy(bl, tmp);
 
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = -1 + (i * 2.0 / ORGAN_WAVE_SIZE);
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
         phaseshift(bl, tmp);
-        waves[wave_dsaw].make(bl, tmp);
+        waves[wave_dsaw].make_lazy(bl, tmp);
 
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = (i < (ORGAN_WAVE_SIZE / 2)) ? 1 : -1;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
         phaseshift(bl, tmp);
-        waves[wave_dsqr].make(bl, tmp);
+        waves[wave_dsqr].make_lazy(bl, tmp);
 
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
             tmp[i] = (i < (ORGAN_WAVE_SIZE / 16)) ? 1 : 0;
         normalize_waveform(tmp, ORGAN_WAVE_SIZE);
         phaseshift(bl, tmp);
-        waves[wave_dpls].make(bl, tmp);
+        waves[wave_dpls].make_lazy(bl, tmp);
 
         LARGE_WAVEFORM_PROGRESS();
         for (int i = 0; i < ORGAN_WAVE_SIZE; i++)
@@ -495,6 +743,13 @@ void organ_voice_base::precalculate_waves(progress_report_iface *reporter)
         padsynth(bl, blBig, big_waves[wave_choir3 - wave_count_small], 50, 10);
         LARGE_WAVEFORM_PROGRESS();
         
+        // only the levels needed right away are calculated at this point, the cache is written
+        // once the rest is done in the background
+        if (!organ_wave_cache_file().empty())
+        {
+            static organ_wave_cache_writer cache_writer(waves, big_waves);
+            waveform_builder::add(&cache_writer);
+        }
         inited = true;
     }
 }
@@ -698,6 +953,42 @@ void organ_voice::update_pitch()
     dphase.set(dsp::midi_note_to_phase(note, 100 * parameters->global_transpose + parameters->global_detune, sample_rate) * inertia_pitchbend.get_last());
 }
 
+/// Add a block of one drawbar (wave table lookup with linear interpolation)
+/// to a stereo buffer. The phase is 32 bit fixed point with FracBits
+/// fractional bits, the rest is the table index.
+template<int FracBits>
+void organ_voice::render_drawbar(const float *data, uint32_t phase, uint32_t dphase, float ampl, float ampr, float (*out)[Channels])
+{
+    // positions and fractions first, this part vectorizes
+    uint32_t pos[BlockSize];
+    float frac[BlockSize];
+    for (int i = 0; i < (int)BlockSize; i++) {
+        uint32_t ph = phase + i * dphase;
+        pos[i] = ph >> FracBits;
+        frac[i] = (ph & ((1 << FracBits) - 1)) * (1.0f / (1 << FracBits));
+    }
+#ifdef __SSE__
+    // four samples at a time, only the table reads are done one by one
+    __m128 vl = _mm_set1_ps(ampl), vr = _mm_set1_ps(ampr);
+    for (int i = 0; i < (int)BlockSize; i += 4) {
+        __m128 a = _mm_set_ps(data[pos[i + 3]], data[pos[i + 2]], data[pos[i + 1]], data[pos[i]]);
+        __m128 b = _mm_set_ps(data[pos[i + 3] + 1], data[pos[i + 2] + 1], data[pos[i + 1] + 1], data[pos[i] + 1]);
+        __m128 wv = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_loadu_ps(frac + i)));
+        __m128 l = _mm_mul_ps(wv, vl), r = _mm_mul_ps(wv, vr);
+        // interleave back into left/right pairs
+        _mm_storeu_ps(out[i], _mm_add_ps(_mm_loadu_ps(out[i]), _mm_unpacklo_ps(l, r)));
+        _mm_storeu_ps(out[i + 2], _mm_add_ps(_mm_loadu_ps(out[i + 2]), _mm_unpackhi_ps(l, r)));
+    }
+#else
+    for (int i = 0; i < (int)BlockSize; i++) {
+        float a = data[pos[i]];
+        float wv = a + (data[pos[i] + 1] - a) * frac[i];
+        out[i][0] += wv * ampl;
+        out[i][1] += wv * ampr;
+    }
+#endif
+}
+
 void organ_voice::render_block() {
     if (note == -1)
         return;
@@ -714,9 +1005,16 @@ void organ_voice::render_block() {
     inertia_pitchbend.set_inertia(parameters->pitch_bend);
     inertia_pitchbend.step();
     update_pitch();
-    dsp::fixed_point<int, 20> tphase, tdphase;
     unsigned int foldvalue = parameters->foldvalue * inertia_pitchbend.get_last();
     int vibrato_mode = fastf2i_drm(parameters->lfo_mode);
+    // collect the audible drawbars first (as parallel arrays), then render
+    // them one after another, without any per-drawbar decisions inside
+    const float *lane_data[9];
+    uint32_t lane_phase[9], lane_dphase[9];
+    float lane_ampl[9], lane_ampr[9];
+    int lane_route[9];
+    bool lane_big[9];
+    int lanes = 0;
     for (int h = 0; h < 9; h++)
     {
         float amp = parameters->drawbars[h];
@@ -731,23 +1029,15 @@ void organ_voice::render_block() {
         uint32_t rate = (dphase * hm).get();
         if (waveid >= wave_count_small)
         {
-            float *data = (*big_waves)[waveid - wave_count_small].get_level(rate >> (ORGAN_BIG_WAVE_BITS - ORGAN_WAVE_BITS + ORGAN_BIG_WAVE_SHIFT));
+            data = (*big_waves)[waveid - wave_count_small].get_level(rate >> (ORGAN_BIG_WAVE_BITS - ORGAN_WAVE_BITS + ORGAN_BIG_WAVE_SHIFT));
             if (!data)
                 continue;
             hm.set(hm.get() >> ORGAN_BIG_WAVE_SHIFT);
-            dsp::fixed_point<int64_t, 20> tphase, tdphase;
-            tphase.set(((phase * hm).get()) + parameters->phaseshift[h]);
-            tdphase.set(rate >> ORGAN_BIG_WAVE_SHIFT);
-            float ampl = amp * 0.5f * (1 - parameters->pan[h]);
-            float ampr = amp * 0.5f * (1 + parameters->pan[h]);
-            float (*out)[Channels] = aux_buffers[dsp::fastf2i_drm(parameters->routing[h])];
-            
-            for (int i=0; i < (int)BlockSize; i++) {
-                float wv = big_wave(data, tphase);
-                out[i][0] += wv * ampl;
-                out[i][1] += wv * ampr;
-                tphase += tdphase;
-            }
+            // the big wave index has 17 bits, so the phase keeps 15 fractional
+            // bits instead of 20 to fit in 32 bits (and wrap like the mask did)
+            lane_phase[lanes] = (uint32_t)((((phase * hm).get()) + parameters->phaseshift[h]) >> (ORGAN_BIG_WAVE_BITS - ORGAN_WAVE_BITS));
+            lane_dphase[lanes] = rate >> (ORGAN_BIG_WAVE_SHIFT + ORGAN_BIG_WAVE_BITS - ORGAN_WAVE_BITS);
+            lane_big[lanes] = true;
         }
         else
         {
@@ -761,19 +1051,23 @@ void organ_voice::render_block() {
             data = (*waves)[waveid].get_level(rate);
             if (!data)
                 continue;
-            tphase.set((uint32_t)((phase * hm).get()) + parameters->phaseshift[h]);
-            tdphase.set((uint32_t)rate);
-            float ampl = amp * 0.5f * (1 - parameters->pan[h]);
-            float ampr = amp * 0.5f * (1 + parameters->pan[h]);
-            float (*out)[Channels] = aux_buffers[dsp::fastf2i_drm(parameters->routing[h])];
-            
-            for (int i=0; i < (int)BlockSize; i++) {
-                float wv = wave(data, tphase);
-                out[i][0] += wv * ampl;
-                out[i][1] += wv * ampr;
-                tphase += tdphase;
-            }
+            lane_phase[lanes] = (uint32_t)((phase * hm).get()) + parameters->phaseshift[h];
+            lane_dphase[lanes] = rate;
+            lane_big[lanes] = false;
         }
+        lane_data[lanes] = data;
+        lane_ampl[lanes] = amp * 0.5f * (1 - parameters->pan[h]);
+        lane_ampr[lanes] = amp * 0.5f * (1 + parameters->pan[h]);
+        lane_route[lanes] = dsp::fastf2i_drm(parameters->routing[h]);
+        lanes++;
+    }
+    for (int l = 0; l < lanes; l++)
+    {
+        float (*out)[Channels] = aux_buffers[lane_route[l]];
+        if (lane_big[l])
+            render_drawbar<32 - ORGAN_BIG_WAVE_BITS>(lane_data[l], lane_phase[l], lane_dphase[l], lane_ampl[l], lane_ampr[l], out);
+        else
+            render_drawbar<32 - ORGAN_WAVE_BITS>(lane_data[l], lane_phase[l], lane_dphase[l], lane_ampl[l], lane_ampr[l], out);
     }
     
     bool is_quad = parameters->quad_env >= 0.5f;
@@ -983,7 +1277,7 @@ bool drawbar_organ::check_percussion() {
 void drawbar_organ::pitch_bend(int amt)
 {
     parameters->pitch_bend = pow(2.0, (amt * parameters->pitch_bend_range) / (1200.0 * 8192.0));
-    for (list<voice *>::iterator i = active_voices.begin(); i != active_voices.end(); i++)
+    for (voice_array::iterator i = active_voices.begin(); i != active_voices.end(); i++)
     {
         organ_voice *v = dynamic_cast<organ_voice *>(*i);
         v->update_pitch();
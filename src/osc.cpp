@@ -0,0 +1,110 @@
+/* Calf DSP Library
+ * Background calculation of wavetables.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include <calf/primitives.h>
+#include <calf/osc.h>
+#include <calf/utils.h>
+#include <semaphore.h>
+#include <list>
+
+using namespace dsp;
+using namespace std;
+using namespace calf_utils;
+
+namespace {
+
+struct builder_state
+{
+    ptmutex mutex;
+    sem_t wakeup;
+    list<waveform_builder::job *> jobs;
+    pthread_t thread;
+    bool thread_started;
+
+    builder_state() : thread_started(false)
+    {
+        sem_init(&wakeup, 0, 0);
+    }
+
+    static void *thread_func(void *arg)
+    {
+        builder_state *self = (builder_state *)arg;
+        while(true)
+        {
+            while(sem_wait(&self->wakeup) < 0 && errno == EINTR)
+                ;
+            // keep going as long as jobs get finished, another job may be waiting for them
+            bool progress;
+            do {
+                ptlock lock(self->mutex);
+                progress = false;
+                for (list<waveform_builder::job *>::iterator i = self->jobs.begin(); i != self->jobs.end(); )
+                {
+                    if ((*i)->run())
+                    {
+                        i = self->jobs.erase(i);
+                        progress = true;
+                    }
+                    else
+                        i++;
+                }
+            } while(progress);
+        }
+        return NULL;
+    }
+};
+
+/// Never destroyed - families with static storage may still remove their jobs during exit
+builder_state *get_builder()
+{
+    static builder_state *state = new builder_state;
+    return state;
+}
+
+}
+
+void waveform_builder::add(job *j)
+{
+    builder_state *state = get_builder();
+    ptlock lock(state->mutex);
+    state->jobs.push_back(j);
+    if (!state->thread_started)
+    {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        state->thread_started = pthread_create(&state->thread, &attr, builder_state::thread_func, state) == 0;
+        pthread_attr_destroy(&attr);
+    }
+    sem_post(&state->wakeup);
+}
+
+void waveform_builder::remove(job *j)
+{
+    builder_state *state = get_builder();
+    // the worker holds the lock while running the jobs, so this also waits for j to finish running
+    ptlock lock(state->mutex);
+    state->jobs.remove(j);
+}
+
+void waveform_builder::wake()
+{
+    sem_post(&get_builder()->wakeup);
+}
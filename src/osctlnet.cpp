@@ -126,37 +126,98 @@ bool osc_client::send(const std::string &address)
     return ::sendto(socket, hdr.data.data(), hdr.data.length(), 0, (sockaddr *)&addr, sizeof(addr)) == (int)hdr.data.length();
 }
 
+void osc_server::parse_packet(const char *buffer, int len)
+{
+    if (len >= 4 && buffer[0] == '/')
+        parse_message(buffer, len);
+    else if (len >= 16 && !memcmp(buffer, "#bundle", 8))
+        parse_bundle(buffer, len);
+}
+
 void osc_server::parse_message(const char *buffer, int len)
 {
-    osctl::string_buffer buf(string(buffer, len));
-    osc_strstream str(buf);
-    string address, type_tag;
-    str >> address;
-    str >> type_tag;
-    // cout << "Address " << address << " type tag " << type_tag << endl << flush;
-    if (!address.empty() && address[0] == '/'
-      &&!type_tag.empty() && type_tag[0] == ',')
+    // the stream only reads from the buffer, it's never written to
+    raw_buffer buf((uint8_t *)buffer, len, len);
+    osc_rawstream str(buf);
+    osc_string_ref address, type_tag;
+    try {
+        str >> address >> type_tag;
+        // cout << "Address " << address << " type tag " << type_tag << endl << flush;
+        if (!address.empty() && address[0] == '/'
+          &&!type_tag.empty() && type_tag[0] == ',')
+        {
+            sink->receive_osc_message(address, osc_string_ref(type_tag.ptr + 1, type_tag.len - 1), str);
+        }
+    }
+    catch(osc_read_exception &e)
+    {
+        // truncated or malformed message, ignore it
+    }
+}
+
+void osc_server::parse_bundle(const char *buffer, int len)
+{
+    raw_buffer buf((uint8_t *)buffer, len, len);
+    osc_rawstream str(buf);
+    osc_string_ref tag;
+    osc_timetag timetag;
+    str >> tag >> timetag;
+    sink->receive_osc_bundle_start(timetag);
+    // elements are size-prefixed, each is either a message or another bundle
+    while(buf.read_left() >= 4)
     {
-        sink->receive_osc_message(address, type_tag.substr(1), str);
+        uint32_t size;
+        str >> size;
+        if ((size & 3) || size > (uint32_t)buf.read_left())
+            break;
+        parse_packet(buffer + buf.tell(), size);
+        buf.seek(buf.tell() + size);
     }
+    sink->receive_osc_bundle_end();
 }
 
 void osc_server::read_from_socket()
 {
-    do {
-        char buf[65536];
-        int len = recv(socket, buf, 65536, MSG_DONTWAIT);
-        if (len > 0)
-        {
-            if (buf[0] == '/')
+    if (rx_buffer.empty())
+        rx_buffer.resize(RX_PACKET * RX_BATCH);
+#ifdef MSG_WAITFORONE
+    if (use_mmsg)
+    {
+        mmsghdr msgs[RX_BATCH];
+        iovec iov[RX_BATCH];
+        do {
+            for (int i = 0; i < RX_BATCH; i++)
             {
-                parse_message(buf, len);
+                iov[i].iov_base = &rx_buffer[i * RX_PACKET];
+                iov[i].iov_len = RX_PACKET;
+                memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
             }
-            if (buf[0] == '#')
+            int count = recvmmsg(socket, msgs, RX_BATCH, MSG_DONTWAIT, NULL);
+            if (count < 0)
             {
-                // XXXKF bundles are not supported yet
+                if (errno != ENOSYS)
+                    return;
+                // older kernel - fall back to one recv per datagram
+                use_mmsg = false;
+                break;
             }
-        }
+            for (int i = 0; i < count; i++)
+            {
+                if (!(msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+                    parse_packet(&rx_buffer[i * RX_PACKET], msgs[i].msg_len);
+            }
+            // a partial batch means the socket has been drained
+            if (count < RX_BATCH)
+                return;
+        } while(1);
+    }
+#endif
+    do {
+        int len = recv(socket, &rx_buffer[0], RX_PACKET, MSG_DONTWAIT);
+        if (len > 0)
+            parse_packet(&rx_buffer[0], len);
         else
             break;
     } while(1);
@@ -51,6 +51,7 @@ ladspa_instance::ladspa_instance(audio_module_iface *_module, ladspa_plugin_meta
 #if USE_DSSI
     feedback_sender = NULL;
 #endif
+    telemetry = telemetry_plane::create(metadata);
 
     module->set_sample_rate(sample_rate);
     module->post_instantiate();
@@ -87,6 +88,8 @@ void ladspa_instance::run(unsigned long SampleCount)
     }
     module->params_changed();
     module->process_slice(0, SampleCount);
+    if (telemetry)
+        telemetry->publish(params, SampleCount);
 }
 
 #if USE_DSSI
@@ -111,6 +114,8 @@ void ladspa_instance::run_synth(unsigned long SampleCount, snd_seq_event_t *Even
     }
     if (offset != SampleCount)
         module->process_slice(offset, SampleCount);
+    if (telemetry)
+        telemetry->publish(params, SampleCount);
 }
 
 #endif
@@ -142,10 +147,21 @@ char *ladspa_instance::configure(const char *key, const char *value)
         return NULL;
     }
     else 
+    if (!strcmp(key, "OSC:FEEDBACK_SHM"))
+    {
+        if (feedback_sender)
+            feedback_sender->attach_shm(value);
+        return NULL;
+    }
+    else 
     if (!strcmp(key, "OSC:UPDATE"))
     {
         if (feedback_sender)
+        {
+            // the value is the last line graph frame the GUI has applied
+            feedback_sender->acked_frame = value ? strtoul(value, NULL, 10) : 0;
             feedback_sender->update();
+        }
         return NULL;
     }
     else 
@@ -530,8 +546,7 @@ const DSSI_Descriptor *dssi_descriptor(unsigned long Index)
 
 #endif
 
-#if USE_JACK
-
+// used by calfjackhost and calfbenchmark
 extern "C" {
 
 audio_module_iface *create_calf_plugin_by_name(const char *effect_name)
@@ -542,5 +557,3 @@ audio_module_iface *create_calf_plugin_by_name(const char *effect_name)
 }
 
 }
-
-#endif
@@ -25,14 +25,36 @@ using namespace std;
 
 void basic_synth::kill_note(int note, int vel, bool just_one)
 {
-    for (list<dsp::voice *>::iterator it = active_voices.begin(); it != active_voices.end(); it++) {
+    int oldest = -1;
+    for (uint64_t slots = active_voices.get_note_slots(note); slots; slots &= slots - 1) {
+        int slot = __builtin_ctzll(slots);
+        dsp::voice *v = active_voices[slot];
         // preserve sostenuto notes
-        if ((*it)->get_current_note() == note && !(sostenuto && (*it)->sostenuto)) {
-            (*it)->note_off(vel);
-            if (just_one)
-                return;
+        if (v->get_current_note() != note || (sostenuto && v->sostenuto))
+            continue;
+        if (!just_one)
+            v->note_off(vel);
+        else if (oldest == -1 || (int32_t)(active_voices.get_serial(slot) - active_voices.get_serial(oldest)) < 0)
+            oldest = slot;
+    }
+    if (oldest != -1)
+        active_voices[oldest]->note_off(vel);
+}
+
+int basic_synth::find_victim(float max_priority)
+{
+    int found = -1;
+    float priority = max_priority;
+    for (unsigned int i = 0; i < active_voices.size(); i++)
+    {
+        float p = active_voices[i]->get_priority();
+        if (p < priority || (p == priority && found != -1 && (int32_t)(active_voices.get_serial(i) - active_voices.get_serial(found)) < 0))
+        {
+            priority = p;
+            found = i;
         }
     }
+    return found;
 }
 
 dsp::voice *basic_synth::give_voice()
@@ -43,35 +65,38 @@ dsp::voice *basic_synth::give_voice()
         if (stolen)
             return stolen;
     }
-    if (unused_voices.empty())
+    dsp::voice *v;
+    if (unused_count)
+        v = unused_voices[--unused_count];
+    else if (allocated_count < voice_array::MAX_VOICES) {
+        allocated_count++;
         return alloc_voice();
+    }
     else {
-        dsp::voice *v = unused_voices.top();
-        unused_voices.pop();
-        v->reset();
-        return v;
-    }   
+        // every voice is in use, most likely by voices still fading out after
+        // being stolen - cut the oldest of those short, or the least
+        // important voice if there are none
+        int victim = -1;
+        for (unsigned int i = 0; i < active_voices.size(); i++)
+        {
+            if (active_voices[i]->stolen && (victim == -1 || (int32_t)(active_voices.get_serial(i) - active_voices.get_serial(victim)) < 0))
+                victim = i;
+        }
+        if (victim == -1)
+            victim = find_victim(1e30f);
+        v = active_voices.remove(victim);
+    }
+    v->reset();
+    return v;
 }
 
 dsp::voice *basic_synth::steal_voice()
 {
-    std::list<dsp::voice *>::iterator found = active_voices.end();
-    float priority = 10000;
-    //int idx = 0;
-    for(std::list<dsp::voice *>::iterator i = active_voices.begin(); i != active_voices.end(); i++)
-    {
-        //printf("Voice %d priority %f at %p\n", idx++, (*i)->get_priority(), *i);
-        if ((*i)->get_priority() < priority)
-        {
-            priority = (*i)->get_priority();
-            found = i;
-        }
-    }
-    //printf("Found: %p\n\n", *found);
-    if (found == active_voices.end())
+    int found = find_victim(10000);
+    if (found == -1)
         return NULL;
     
-    (*found)->steal();
+    active_voices[found]->steal();
     return NULL;
 }
 
@@ -79,13 +104,12 @@ void basic_synth::trim_voices()
 {
     // count stealable voices
     unsigned int count = 0;
-    for(std::list<dsp::voice *>::iterator i = active_voices.begin(); i != active_voices.end(); i++)
+    for (unsigned int i = 0; i < active_voices.size(); i++)
     {
-        if ((*i)->get_priority() < 10000)
+        if (active_voices[i]->get_priority() < 10000)
             count++;
     }
-    // printf("Count=%d limit=%d\n", count, polyphony_limit);
-    // steal any voices above polyphony limit
+    // steal any voices above polyphony limit, least important first
     if (count > polyphony_limit) {
         for (unsigned int i = 0; i < count - polyphony_limit; i++)
             steal_voice();
@@ -105,7 +129,7 @@ void basic_synth::note_on(int note, int vel)
     v->sostenuto = false;
     gate.set(note);
     v->note_on(note, vel);
-    active_voices.push_back(v);
+    active_voices.push(v, note);
     if (perc) {
         percussion_note_on(note, vel);
     }
@@ -118,7 +142,7 @@ void basic_synth::note_off(int note, int vel)
         kill_note(note, vel, false);
 }
 
-#define for_all_voices(iter) for (std::list<dsp::voice *>::iterator iter = active_voices.begin(); iter != active_voices.end(); iter++)
+#define for_all_voices(iter) for (dsp::voice_array::iterator iter = active_voices.begin(); iter != active_voices.end(); iter++)
     
 void basic_synth::on_pedal_release()
 {
@@ -196,12 +220,12 @@ void basic_synth::control_change(int ctl, int val)
 void basic_synth::render_to(float (*output)[2], int nsamples)
 {
     // render voices, eliminate ones that aren't sounding anymore
-    for (list<dsp::voice *>::iterator i = active_voices.begin(); i != active_voices.end();) {
-        dsp::voice *v = *i;
+    for (unsigned int i = 0; i < active_voices.size();) {
+        dsp::voice *v = active_voices[i];
         v->render_to(output, nsamples);
         if (!v->get_active()) {
-            i = active_voices.erase(i);
-            unused_voices.push(v);
+            // the last voice moves into this slot and gets rendered next
+            unused_voices[unused_count++] = active_voices.remove(i);
             continue;
         }
         i++;
@@ -210,11 +234,8 @@ void basic_synth::render_to(float (*output)[2], int nsamples)
 
 basic_synth::~basic_synth()
 {
-    while(!unused_voices.empty()) {
-        delete unused_voices.top();
-        unused_voices.pop();
-    }
-    for (list<voice *>::iterator i = active_voices.begin(); i != active_voices.end(); i++)
+    for (unsigned int i = 0; i < unused_count; i++)
+        delete unused_voices[i];
+    for_all_voices(i)
         delete *i;
 }
-
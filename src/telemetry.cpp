@@ -0,0 +1,143 @@
+/* Calf DSP Library
+ * Shared memory telemetry of plugin instances.
+ *
+ * Copyright (C) 2001-2010 Krzysztof Foltman, Markus Schmidt and others
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include <calf/giface.h>
+#include <calf/telemetry.h>
+#include <calf/utils.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace calf_plugins;
+using namespace calf_utils;
+
+telemetry_plane::telemetry_plane(telemetry_header *_header, size_t _size, const std::string &_name)
+: header(_header)
+, size(_size)
+, name(_name)
+{
+}
+
+telemetry_plane *telemetry_plane::create(const plugin_metadata_iface *metadata)
+{
+    static const char *enabled = getenv("CALF_TELEMETRY");
+    static volatile int serial = 0;
+    if (!enabled || !atoi(enabled))
+        return NULL;
+    
+    std::string name = "/calf-telemetry-" + i2s(getpid()) + "-" + i2s(__sync_fetch_and_add(&serial, 1));
+    uint32_t count = metadata->get_param_count();
+    size_t size = telemetry_header::size(count);
+    // readable by everyone - monitoring may run as a different user
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return NULL;
+    void *ptr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return NULL;
+    }
+    // the audio thread shouldn't take page faults on the first update
+    mlock(ptr, size);
+    
+    telemetry_header *header = (telemetry_header *)ptr;
+    header->pid = getpid();
+    header->param_count = count;
+    strncpy(header->plugin_id, metadata->get_id(), telemetry_header::NAME_LEN - 1);
+    float *values = header->values();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const parameter_properties *props = metadata->get_param_props(i);
+        values[i] = props->def_value;
+        strncpy((char *)header->param_name(i), props->short_name, telemetry_header::NAME_LEN - 1);
+    }
+    header->version = telemetry_header::LAYOUT_VERSION;
+    // readers check the magic, so it's set last
+    __sync_synchronize();
+    header->magic = telemetry_header::MAGIC;
+    return new telemetry_plane(header, size, name);
+}
+
+telemetry_plane::~telemetry_plane()
+{
+    munmap(header, size);
+    shm_unlink(name.c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+bool telemetry_reader::open(const char *name)
+{
+    close();
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    void *ptr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(telemetry_header))
+        ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED)
+        return false;
+    const telemetry_header *h = (const telemetry_header *)ptr;
+    if (h->magic != telemetry_header::MAGIC || h->version != telemetry_header::LAYOUT_VERSION || (size_t)st.st_size < telemetry_header::size(h->param_count))
+    {
+        munmap(ptr, st.st_size);
+        return false;
+    }
+    header = h;
+    size = st.st_size;
+    return true;
+}
+
+void telemetry_reader::close()
+{
+    if (header)
+        munmap((void *)header, size);
+    header = NULL;
+}
+
+bool telemetry_reader::read(float *values, uint64_t &frames, int attempts) const
+{
+    for (int i = 0; i < attempts; i++)
+    {
+        uint32_t seq = header->sequence;
+        if (!(seq & 1))
+        {
+            __sync_synchronize();
+            memcpy(values, header->values(), header->param_count * sizeof(float));
+            frames = header->frames;
+            __sync_synchronize();
+            if (header->sequence == seq)
+                return true;
+        }
+        // the writer is in the middle of an update, which is short
+        sched_yield();
+    }
+    return false;
+}
@@ -21,7 +21,15 @@
 #include <calf/osctl.h>
 #include <calf/utils.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sstream>
+#include <vector>
 
 using namespace std;
 using namespace osctl;
@@ -130,6 +138,214 @@ std::string indent(const std::string &src, const std::string &indent)
     return dest;
 }
 
+/// Create dir and any missing parents, like mkdir -p
+static void make_dirs(const std::string &dir, mode_t mode)
+{
+    for (size_t pos = dir.find('/', 1); pos != std::string::npos; pos = dir.find('/', pos + 1))
+        mkdir(dir.substr(0, pos).c_str(), mode);
+    mkdir(dir.c_str(), mode);
+}
+
+std::string get_cache_dir()
+{
+    std::string dir;
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg)
+        dir = xdg;
+    else
+    {
+        const char *home = getenv("HOME");
+        if (!home || !*home)
+            return std::string();
+        dir = std::string(home) + "/.cache";
+    }
+    make_dirs(dir, 0700);
+    dir += "/calf";
+    if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+        return std::string();
+    return dir;
+}
+
+bool write_file_atomic(const std::string &filename, const void *data, size_t size)
+{
+    std::string tmpname = filename + ".XXXXXX";
+    std::vector<char> tmpl(tmpname.begin(), tmpname.end());
+    tmpl.push_back('\0');
+    int fd = mkstemp(&tmpl[0]);
+    if (fd < 0)
+        return false;
+    const char *ptr = (const char *)data;
+    size_t left = size;
+    while(left > 0)
+    {
+        ssize_t len = write(fd, ptr, left);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            break;
+        ptr += len;
+        left -= len;
+    }
+    fchmod(fd, 0644);
+    if (close(fd) < 0 || left > 0 || rename(&tmpl[0], filename.c_str()) < 0)
+    {
+        unlink(&tmpl[0]);
+        return false;
+    }
+    return true;
+}
+
+bool mapped_file::map(const std::string &filename)
+{
+    unmap();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return false;
+    data = ptr;
+    size = st.st_size;
+    return true;
+}
+
+void mapped_file::unmap()
+{
+    if (data)
+        munmap(data, size);
+    data = NULL;
+    size = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+task_pool::task_pool(int thread_count)
+{
+    busy = 0;
+    sched_copied = false;
+    quit = false;
+    func = NULL;
+    arg = NULL;
+    task_count = 0;
+    next_task = 0;
+    pending = 0;
+    sem_init(&start_sem, 0, 0);
+    sem_init(&done_sem, 0, 0);
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, thread_func, this))
+            break;
+        threads.push_back(thread);
+    }
+}
+
+task_pool::~task_pool()
+{
+    quit = true;
+    __sync_synchronize();
+    for (size_t i = 0; i < threads.size(); i++)
+        sem_post(&start_sem);
+    for (size_t i = 0; i < threads.size(); i++)
+        pthread_join(threads[i], NULL);
+    sem_destroy(&start_sem);
+    sem_destroy(&done_sem);
+}
+
+void *task_pool::thread_func(void *arg)
+{
+    task_pool *self = (task_pool *)arg;
+    while(true)
+    {
+        while(sem_wait(&self->start_sem) < 0 && errno == EINTR)
+            ;
+        if (self->quit)
+            break;
+        self->do_tasks();
+        if (!__sync_sub_and_fetch(&self->pending, 1))
+            sem_post(&self->done_sem);
+    }
+    return NULL;
+}
+
+void task_pool::do_tasks()
+{
+    int i;
+    while((i = __sync_fetch_and_add(&next_task, 1)) < task_count)
+        func(arg, i);
+}
+
+void task_pool::copy_sched()
+{
+    // the workers are created by a non-realtime thread, give them the
+    // policy of the first realtime thread that uses them (a non-realtime
+    // caller, like an offline render or a warm-up, doesn't count)
+    int policy;
+    sched_param param;
+    if (!pthread_getschedparam(pthread_self(), &policy, &param) && policy != SCHED_OTHER)
+    {
+        for (size_t i = 0; i < threads.size(); i++)
+            pthread_setschedparam(threads[i], policy, &param);
+        sched_copied = true;
+    }
+}
+
+void task_pool::run(task_func f, void *a, int count)
+{
+    if (count < 2 || threads.empty() || !__sync_bool_compare_and_swap(&busy, 0, 1))
+    {
+        for (int i = 0; i < count; i++)
+            f(a, i);
+        return;
+    }
+    if (!sched_copied)
+        copy_sched();
+    func = f;
+    arg = a;
+    task_count = count;
+    next_task = 0;
+    int wake = std::min<int>(count - 1, threads.size());
+    pending = wake;
+    __sync_synchronize();
+    for (int i = 0; i < wake; i++)
+        sem_post(&start_sem);
+    do_tasks();
+    // the workers may still be finishing their last task
+    for (int i = 0; pending && i < SPIN_LIMIT; i++)
+        sched_yield();
+    // the last worker posts once per run, this only sleeps if it hasn't yet
+    while(sem_wait(&done_sem) < 0 && errno == EINTR)
+        ;
+    __sync_synchronize();
+    busy = 0;
+}
+
+task_pool *task_pool::get_shared()
+{
+    static ptmutex mutex;
+    static task_pool *pool = NULL;
+    static bool created = false;
+    ptlock lock(mutex);
+    if (!created)
+    {
+        const char *env = getenv("CALF_WORKER_THREADS");
+        int count = env ? atoi(env) : 0;
+        // extra threads on the same CPU only add switching overhead
+        count = std::min<int>(count, sysconf(_SC_NPROCESSORS_ONLN) - 1);
+        pool = new task_pool(std::max(0, std::min(count, 16)));
+        created = true;
+    }
+    return pool;
+}
+
 //////////////////////////////////////////////////////////////////////////////////
 
 file_exception::file_exception(const std::string &f)
@@ -65,11 +65,14 @@ void wavetable_voice::note_on(int note, int vel)
     }
     float modsrc[wavetable_metadata::modsrc_count] = { 1.f, velocity, parent->inertia_pressure.get_last(), parent->modwheel_value, (float)envs[0].value, (float)envs[1].value, (float)envs[2].value};
     parent->calculate_modmatrix(moddest, md::moddest_count, modsrc);
-    calc_derived_dests();
+    // set up the oscillators, the voice may play before the next control tick
+    set_mod_dests(moddest, 1);
 
     float oscshift[2] = { moddest[md::moddest_o1shift], moddest[md::moddest_o2shift] };
     memcpy(last_oscshift, oscshift, sizeof(oscshift));
     memcpy(last_oscamp, cur_oscamp, sizeof(cur_oscamp));
+    for (int i = 0; i < OscCount; i++)
+        osstep[i] = oastep[i] = 0.f;
 }
 
 void wavetable_voice::note_off(int vel)
@@ -82,26 +85,36 @@ void wavetable_voice::steal()
 {
 }
 
-void wavetable_voice::render_block()
+void wavetable_voice::get_mod_sources(float *modsrc, int stride)
 {
     typedef wavetable_metadata md;
     
-    const float step = 1.f / BlockSize;
-
     float s = 0.001;
-    float scl[EnvCount];
     int espc = md::par_eg2attack - md::par_eg1attack;
     for (int j = 0; j < EnvCount; j++) {
         int o = j*espc;
         envs[j].set(*params[md::par_eg1attack + o] * s, *params[md::par_eg1decay + o] * s, *params[md::par_eg1sustain + o], *params[md::par_eg1release + o] * s, sample_rate / BlockSize, *params[md::par_eg1fade + o] * s); 
-        scl[j] = dsp::lerp(1.f, velocity, *params[md::par_eg1velscl + o]);; 
     }
     
     for (int i = 0; i < EnvCount; i++)
         envs[i].advance();    
     
-    float modsrc[wavetable_metadata::modsrc_count] = { 1.f, velocity, parent->inertia_pressure.get_last(), parent->modwheel_value, (float)envs[0].value, (float)envs[1].value, (float)envs[2].value};
-    parent->calculate_modmatrix(moddest, md::moddest_count, modsrc);
+    modsrc[md::modsrc_none * stride] = 1.f;
+    modsrc[md::modsrc_velocity * stride] = velocity;
+    modsrc[md::modsrc_pressure * stride] = parent->inertia_pressure.get_last();
+    modsrc[md::modsrc_modwheel * stride] = parent->modwheel_value;
+    for (int i = 0; i < EnvCount; i++)
+        modsrc[(md::modsrc_env1 + i) * stride] = envs[i].value;
+}
+
+void wavetable_voice::set_mod_dests(const float *dests, int stride)
+{
+    typedef wavetable_metadata md;
+    
+    const float step = 1.f / BlockSize;
+
+    for (int i = 0; i < md::moddest_count; i++)
+        moddest[i] = dests[i * stride];
     calc_derived_dests();
 
     int ospc = md::par_o2level - md::par_o1level;
@@ -111,9 +124,20 @@ void wavetable_voice::render_block()
     }
         
     float oscshift[2] = { moddest[md::moddest_o1shift], moddest[md::moddest_o2shift] };
-    float osstep[2] = { (oscshift[0] - last_oscshift[0]) * step, (oscshift[1] - last_oscshift[1]) * step };
-    float oastep[2] = { (cur_oscamp[0] - last_oscamp[0]) * step, (cur_oscamp[1] - last_oscamp[1]) * step };
-    for (int i = 0; i < BlockSize; i++) {        
+    for (int j = 0; j < OscCount; j++) {
+        osstep[j] = (oscshift[j] - last_oscshift[j]) * step;
+        oastep[j] = (cur_oscamp[j] - last_oscamp[j]) * step;
+    }
+    if (envs[0].stopped())
+        released = true;
+}
+
+void wavetable_voice::render_to(float (*buf)[2], int nsamples)
+{
+    typedef wavetable_metadata md;
+    
+    int ospc = md::par_o2level - md::par_o1level;
+    for (int i = 0; i < nsamples; i++) {        
         float value = 0.f;
 
         for (int j = 0; j < OscCount; j++) {
@@ -123,12 +147,19 @@ void wavetable_voice::render_block()
             last_oscamp[j] += oastep[j];
         }
         
-        output_buffer[i][0] = output_buffer[i][1] = value;
+        buf[i][0] += value;
+        buf[i][1] += value;
     }
-    if (envs[0].stopped())
-        released = true;
-    memcpy(last_oscshift, oscshift, sizeof(oscshift));
-    memcpy(last_oscamp, cur_oscamp, sizeof(cur_oscamp));
+}
+
+void wavetable_audio_module::control_tick()
+{
+    unsigned int count = active_voices.size();
+    for (unsigned int i = 0; i < count; i++)
+        static_cast<wavetable_voice *>(active_voices[i])->get_mod_sources(&tick_modsrc[0][i], dsp::voice_array::MAX_VOICES);
+    calculate_modmatrix(&tick_moddest[0][0], moddest_count, &tick_modsrc[0][0], count, dsp::voice_array::MAX_VOICES);
+    for (unsigned int i = 0; i < count; i++)
+        static_cast<wavetable_voice *>(active_voices[i])->set_mod_dests(&tick_moddest[0][i], dsp::voice_array::MAX_VOICES);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -169,6 +200,7 @@ wavetable_audio_module::wavetable_audio_module()
 , inertia_pressure(64)
 {
     panic_flag = false;
+    tick_left = 0;
     modwheel_value = 0.;
     for (int i = 0; i < 129; i += 8)
     {